@@ -41,6 +41,7 @@
 
 #include "sagan.h"
 #include "aetas.h"
+#include "util-time.h"
 #include "rules.h"
 
 struct _Rule_Struct *rulestruct;
@@ -72,12 +73,12 @@ int Check_Time(int rule_number)
 
     /* Get current utime / and day of the week */
 
-    t = time(NULL);
+    t = Sagan_Time();
     now_utime=localtime(&t);
     strftime(ct, sizeof(ct), "%s",  now_utime);
     day_current = localtime(&t)->tm_wday;
 
-    time(&now);
+    now = Sagan_Time();
     ts = *localtime(&now);
 
     strftime(hour_tmp, sizeof(buf), "%H", &ts);
@@ -35,6 +35,7 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "sagan-config.h"
 #include "rules.h"
 #include "after.h"
@@ -69,16 +70,12 @@ sbool After_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bits
     sbool after_log_flag = true;
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     int i;
 
     uintmax_t after_oldtime;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     for (i = 0; i < counters_ipc->after_count_by_src; i++ )
         {
@@ -94,7 +91,7 @@ sbool After_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bits
                     afterbysrc_ipc[i].count++;
                     afterbysrc_ipc[i].total_count++;
 
-                    after_oldtime = atol(timet) - afterbysrc_ipc[i].utime;
+                    after_oldtime = t - afterbysrc_ipc[i].utime;
 
                     /* Reset counter if it's expired */
 
@@ -103,7 +100,7 @@ sbool After_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bits
                         {
 
                             afterbysrc_ipc[i].count=1;
-                            afterbysrc_ipc[i].utime = atol(timet);
+                            afterbysrc_ipc[i].utime = t;
 
                             after_log_flag = true;
                         }
@@ -142,7 +139,7 @@ sbool After_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bits
             strlcpy(afterbysrc_ipc[counters_ipc->after_count_by_src].sid, rulestruct[rule_position].s_sid, sizeof(afterbysrc_ipc[counters_ipc->after_count_by_src].sid));
             NULL == selector ? afterbysrc_ipc[counters_ipc->after_count_by_src].selector[0] = '\0' : strlcpy(afterbysrc_ipc[counters_ipc->after_count_by_src].selector, selector, MAXSELECTOR);
             afterbysrc_ipc[counters_ipc->after_count_by_src].count = 1;
-            afterbysrc_ipc[counters_ipc->after_count_by_src].utime = atol(timet);
+            afterbysrc_ipc[counters_ipc->after_count_by_src].utime = t;
             afterbysrc_ipc[counters_ipc->after_count_by_src].expire = rulestruct[rule_position].after_seconds;
 
             counters_ipc->after_count_by_src++;
@@ -165,16 +162,12 @@ sbool After_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bits
     sbool after_log_flag = true;
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     int i;
 
     uintmax_t after_oldtime;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     for (i = 0; i < counters_ipc->after_count_by_dst; i++ )
         {
@@ -190,14 +183,14 @@ sbool After_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bits
                     afterbydst_ipc[i].count++;
                     afterbydst_ipc[i].total_count++;
 
-                    after_oldtime = atol(timet) - afterbydst_ipc[i].utime;
+                    after_oldtime = t - afterbydst_ipc[i].utime;
 
                     if ( after_oldtime > rulestruct[rule_position].after_seconds ||
                             afterbydst_ipc[i].count == 0 )
                         {
 
                             afterbydst_ipc[i].count=1;
-                            afterbydst_ipc[i].utime = atol(timet);
+                            afterbydst_ipc[i].utime = t;
                             after_log_flag = true;
                         }
 
@@ -235,7 +228,7 @@ sbool After_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bits
             strlcpy(afterbydst_ipc[counters_ipc->after_count_by_dst].sid, rulestruct[rule_position].s_sid, sizeof(afterbydst_ipc[counters_ipc->after_count_by_dst].sid));
             NULL == selector ? afterbydst_ipc[counters_ipc->after_count_by_dst].selector[0] = '\0' : strlcpy(afterbydst_ipc[counters_ipc->after_count_by_dst].selector, selector, MAXSELECTOR);
             afterbydst_ipc[counters_ipc->after_count_by_dst].count = 1;
-            afterbydst_ipc[counters_ipc->after_count_by_dst].utime = atol(timet);
+            afterbydst_ipc[counters_ipc->after_count_by_dst].utime = t;
             afterbydst_ipc[counters_ipc->after_count_by_dst].expire = rulestruct[rule_position].after_seconds;
 
             counters_ipc->after_count_by_dst++;
@@ -259,16 +252,12 @@ sbool After_By_Username( int rule_position, char *normalize_username, char *sele
     sbool after_log_flag = true;
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     int i;
 
     uintmax_t after_oldtime;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array for matching username / sid */
 
@@ -295,14 +284,14 @@ sbool After_By_Username( int rule_position, char *normalize_username, char *sele
                     afterbyusername_ipc[i].count++;
                     afterbyusername_ipc[i].total_count++;
 
-                    after_oldtime = atol(timet) - afterbyusername_ipc[i].utime;
+                    after_oldtime = t - afterbyusername_ipc[i].utime;
 
                     if ( after_oldtime > rulestruct[rule_position].after_seconds ||
                             afterbysrc_ipc[i].count == 0 )
                         {
 
                             afterbyusername_ipc[i].count=1;
-                            afterbyusername_ipc[i].utime = atol(timet);
+                            afterbyusername_ipc[i].utime = t;
 
                             after_log_flag = true;
                         }
@@ -340,7 +329,7 @@ sbool After_By_Username( int rule_position, char *normalize_username, char *sele
             strlcpy(afterbyusername_ipc[counters_ipc->after_count_by_username].sid, rulestruct[rule_position].s_sid, sizeof(afterbyusername_ipc[counters_ipc->after_count_by_username].sid));
             NULL == selector ? afterbyusername_ipc[counters_ipc->after_count_by_username].selector[0] = '\0' : strlcpy(afterbyusername_ipc[counters_ipc->after_count_by_username].selector, selector, MAXSELECTOR);
             afterbyusername_ipc[counters_ipc->after_count_by_username].count = 1;
-            afterbyusername_ipc[counters_ipc->after_count_by_username].utime = atol(timet);
+            afterbyusername_ipc[counters_ipc->after_count_by_username].utime = t;
             afterbyusername_ipc[counters_ipc->after_count_by_username].expire = rulestruct[rule_position].after_seconds;
 
             counters_ipc->after_count_by_username++;
@@ -363,16 +352,12 @@ sbool After_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *select
     sbool after_log_flag = true;
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     int i;
 
     uintmax_t after_oldtime;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
 
     for (i = 0; i < counters_ipc->after_count_by_srcport; i++ )
@@ -397,14 +382,14 @@ sbool After_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *select
                     afterbysrcport_ipc[i].count++;
                     afterbysrcport_ipc[i].total_count++;
 
-                    after_oldtime = atol(timet) - afterbysrcport_ipc[i].utime;
+                    after_oldtime = t - afterbysrcport_ipc[i].utime;
 
                     if ( after_oldtime > rulestruct[rule_position].after_seconds ||
                             afterbysrc_ipc[i].count == 0 )
                         {
 
                             afterbysrcport_ipc[i].count=1;
-                            afterbysrcport_ipc[i].utime = atol(timet);
+                            afterbysrcport_ipc[i].utime = t;
                             after_log_flag = true;
                         }
 
@@ -440,7 +425,7 @@ sbool After_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *select
             strlcpy(afterbysrcport_ipc[counters_ipc->after_count_by_srcport].sid, rulestruct[rule_position].s_sid, sizeof(afterbysrcport_ipc[counters_ipc->after_count_by_srcport].sid));
             NULL == selector ? afterbysrcport_ipc[counters_ipc->after_count_by_srcport].selector[0] = '\0' : strlcpy(afterbysrcport_ipc[counters_ipc->after_count_by_srcport].selector, selector, MAXSELECTOR);
             afterbysrcport_ipc[counters_ipc->after_count_by_srcport].count = 1;
-            afterbysrcport_ipc[counters_ipc->after_count_by_srcport].utime = atol(timet);
+            afterbysrcport_ipc[counters_ipc->after_count_by_srcport].utime = t;
             afterbysrcport_ipc[counters_ipc->after_count_by_srcport].expire = rulestruct[rule_position].after_seconds;
 
             counters_ipc->after_count_by_srcport++;
@@ -464,16 +449,12 @@ sbool After_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *select
     sbool after_log_flag = true;
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     int i;
 
     uintmax_t after_oldtime;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
 
     for (i = 0; i < counters_ipc->after_count_by_dstport; i++ )
@@ -498,14 +479,14 @@ sbool After_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *select
                     afterbydstport_ipc[i].count++;
                     afterbydstport_ipc[i].total_count++;
 
-                    after_oldtime = atol(timet) - afterbydstport_ipc[i].utime;
+                    after_oldtime = t - afterbydstport_ipc[i].utime;
 
                     if ( after_oldtime > rulestruct[rule_position].after_seconds ||
                             afterbysrc_ipc[i].count == 0 )
                         {
 
                             afterbydstport_ipc[i].count=1;
-                            afterbydstport_ipc[i].utime = atol(timet);
+                            afterbydstport_ipc[i].utime = t;
                             after_log_flag = true;
 
                         }
@@ -542,7 +523,7 @@ sbool After_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *select
             strlcpy(afterbydstport_ipc[counters_ipc->after_count_by_dstport].sid, rulestruct[rule_position].s_sid, sizeof(afterbydstport_ipc[counters_ipc->after_count_by_dstport].sid));
             NULL == selector ? afterbydstport_ipc[counters_ipc->after_count_by_dstport].selector[0] = '\0' : strlcpy(afterbydstport_ipc[counters_ipc->after_count_by_dstport].selector, selector, MAXSELECTOR);
             afterbydstport_ipc[counters_ipc->after_count_by_dstport].count = 1;
-            afterbydstport_ipc[counters_ipc->after_count_by_dstport].utime = atol(timet);
+            afterbydstport_ipc[counters_ipc->after_count_by_dstport].utime = t;
             afterbydstport_ipc[counters_ipc->after_count_by_dstport].expire = rulestruct[rule_position].after_seconds;
 
             counters_ipc->after_count_by_dstport++;
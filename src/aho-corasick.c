@@ -0,0 +1,349 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* aho-corasick.c
+ *
+ * A multi-pattern search.  Every pattern added is found in a single pass
+ * over the text.  Used to prefilter rules by their content (see
+ * rules-index.c).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "aho-corasick.h"
+#include "lockfile.h"
+
+static uint32_t Aho_Corasick_Node_New( _Aho_Corasick * );
+static uint32_t Aho_Corasick_Child( _Aho_Corasick *, uint32_t, unsigned char );
+
+/****************************************************************************
+ * Aho_Corasick_New - Returns an empty automaton.  Pattern numbers start at
+ * 'base' so several automatons can share one result bit set.
+ ****************************************************************************/
+
+_Aho_Corasick *Aho_Corasick_New( sbool nocase, int base )
+{
+
+    _Aho_Corasick *ac = calloc(1, sizeof(_Aho_Corasick));
+
+    if ( ac == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for Aho-Corasick. Abort!", __FILE__, __LINE__);
+        }
+
+    ac->nocase = nocase;
+    ac->pattern_base = base;
+
+    Aho_Corasick_Node_New(ac);		/* The root is always node 0 */
+
+    return(ac);
+}
+
+/****************************************************************************
+ * Aho_Corasick_Node_New - Adds a node to the trie and returns its number
+ ****************************************************************************/
+
+static uint32_t Aho_Corasick_Node_New( _Aho_Corasick *ac )
+{
+
+    _Aho_Corasick_Node *node;
+
+    if ( ac->node_count == ac->node_size )
+        {
+
+            ac->node_size = ac->node_size == 0 ? 256 : ac->node_size * 2;
+            ac->nodes = realloc(ac->nodes, ac->node_size * sizeof(_Aho_Corasick_Node));
+
+            if ( ac->nodes == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for Aho-Corasick. Abort!", __FILE__, __LINE__);
+                }
+
+        }
+
+    node = &ac->nodes[ac->node_count];
+    memset(node, 0, sizeof(_Aho_Corasick_Node));
+    node->pattern = -1;
+
+    return(ac->node_count++);
+}
+
+/****************************************************************************
+ * Aho_Corasick_Add - Adds a pattern.  Returns its number (plus the base).
+ * Adding the same pattern twice returns the same number.
+ ****************************************************************************/
+
+int Aho_Corasick_Add( _Aho_Corasick *ac, const char *pattern )
+{
+
+    const unsigned char *p = (const unsigned char *)pattern;
+    unsigned char c;
+    uint32_t state = 0;
+    uint32_t next;
+
+    for ( ; *p != '\0'; p++ )
+        {
+
+            c = ac->nocase ? tolower(*p) : *p;
+
+            for ( next = ac->nodes[state].child; next != 0; next = ac->nodes[next].sibling )
+                {
+                    if ( ac->nodes[next].c == c )
+                        {
+                            break;
+                        }
+                }
+
+            if ( next == 0 )
+                {
+                    next = Aho_Corasick_Node_New(ac);
+                    ac->nodes[next].c = c;
+                    ac->nodes[next].sibling = ac->nodes[state].child;
+                    ac->nodes[state].child = next;
+                    ac->nodes[state].child_count++;
+                }
+
+            state = next;
+        }
+
+    if ( ac->nodes[state].pattern == -1 )
+        {
+            ac->nodes[state].pattern = ac->pattern_count++;
+        }
+
+    return(ac->nodes[state].pattern + ac->pattern_base);
+}
+
+/****************************************************************************
+ * Aho_Corasick_Compile - Works out the failure links and packs every
+ * node's children into the sorted edge arrays.  No more patterns can be
+ * added after this.
+ ****************************************************************************/
+
+void Aho_Corasick_Compile( _Aho_Corasick *ac )
+{
+
+    uint32_t *queue;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint32_t edges = 0;
+
+    uint32_t state;
+    uint32_t child;
+    uint32_t fail;
+    uint32_t i;
+    uint32_t j;
+
+    queue = malloc(ac->node_count * sizeof(uint32_t));
+    ac->edge_char = malloc(ac->node_count * sizeof(unsigned char));
+    ac->edge_node = malloc(ac->node_count * sizeof(uint32_t));
+
+    if ( queue == NULL || ac->edge_char == NULL || ac->edge_node == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for Aho-Corasick. Abort!", __FILE__, __LINE__);
+        }
+
+    /* Breadth first,  so a node's fail link always points at a node we've
+     * already finished with.  Edges are packed as we go */
+
+    queue[tail++] = 0;
+
+    while ( head < tail )
+        {
+
+            state = queue[head++];
+
+            i = edges;
+
+            for ( child = ac->nodes[state].child; child != 0; child = ac->nodes[child].sibling )
+                {
+
+                    /* Keep the run sorted by byte (insertion sort.  Runs are short) */
+
+                    for ( j = edges; j > i && ac->edge_char[j - 1] > ac->nodes[child].c; j-- )
+                        {
+                            ac->edge_char[j] = ac->edge_char[j - 1];
+                            ac->edge_node[j] = ac->edge_node[j - 1];
+                        }
+
+                    ac->edge_char[j] = ac->nodes[child].c;
+                    ac->edge_node[j] = child;
+                    edges++;
+
+                    if ( state == 0 )
+                        {
+                            ac->nodes[child].fail = 0;
+                        }
+                    else
+                        {
+
+                            fail = ac->nodes[state].fail;
+
+                            while ( fail != 0 && Aho_Corasick_Child(ac, fail, ac->nodes[child].c) == 0 )
+                                {
+                                    fail = ac->nodes[fail].fail;
+                                }
+
+                            ac->nodes[child].fail = fail == 0 ? ac->root[ac->nodes[child].c] : Aho_Corasick_Child(ac, fail, ac->nodes[child].c);
+                        }
+
+                    fail = ac->nodes[child].fail;
+                    ac->nodes[child].dict = ac->nodes[fail].pattern != -1 ? fail : ac->nodes[fail].dict;
+
+                    queue[tail++] = child;
+                }
+
+            ac->nodes[state].child = i;
+
+            if ( state == 0 )
+                {
+                    for ( j = i; j < edges; j++ )
+                        {
+                            ac->root[ac->edge_char[j]] = ac->edge_node[j];
+                        }
+                }
+        }
+
+    free(queue);
+
+}
+
+/****************************************************************************
+ * Aho_Corasick_Child - Returns the child of a compiled node for a byte,  or
+ * 0 if there isn't one
+ ****************************************************************************/
+
+static uint32_t Aho_Corasick_Child( _Aho_Corasick *ac, uint32_t state, unsigned char c )
+{
+
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    if ( state == 0 )
+        {
+            return(ac->root[c]);
+        }
+
+    lo = ac->nodes[state].child;
+    hi = lo + ac->nodes[state].child_count;
+
+    while ( lo < hi )
+        {
+
+            mid = ( lo + hi ) / 2;
+
+            if ( ac->edge_char[mid] == c )
+                {
+                    return(ac->edge_node[mid]);
+                }
+
+            if ( ac->edge_char[mid] < c )
+                {
+                    lo = mid + 1;
+                }
+            else
+                {
+                    hi = mid;
+                }
+        }
+
+    return(0);
+}
+
+/****************************************************************************
+ * Aho_Corasick_Search - Sets the bit in 'found' for every pattern that
+ * appears in 'text'.  Bits are never cleared,  so the caller can search
+ * several automatons into one set.
+ ****************************************************************************/
+
+void Aho_Corasick_Search( _Aho_Corasick *ac, const char *text, uint64_t *found )
+{
+
+    const unsigned char *p = (const unsigned char *)text;
+    unsigned char c;
+    uint32_t state = 0;
+    uint32_t next;
+    uint32_t out;
+    int pattern;
+
+    if ( ac->pattern_count == 0 )
+        {
+            return;
+        }
+
+    for ( ; *p != '\0'; p++ )
+        {
+
+            c = ac->nocase ? tolower(*p) : *p;
+
+            while ( ( next = Aho_Corasick_Child(ac, state, c) ) == 0 && state != 0 )
+                {
+                    state = ac->nodes[state].fail;
+                }
+
+            state = next;
+
+            /* Everything that ends here */
+
+            for ( out = ac->nodes[state].pattern != -1 ? state : ac->nodes[state].dict; out != 0; out = ac->nodes[out].dict )
+                {
+                    pattern = ac->nodes[out].pattern + ac->pattern_base;
+                    found[pattern >> 6] |= 1ULL << ( pattern & 63 );
+                }
+        }
+
+}
+
+/****************************************************************************
+ * Aho_Corasick_Free - Frees an automaton
+ ****************************************************************************/
+
+void Aho_Corasick_Free( _Aho_Corasick *ac )
+{
+
+    if ( ac == NULL )
+        {
+            return;
+        }
+
+    free(ac->nodes);
+    free(ac->edge_char);
+    free(ac->edge_node);
+    free(ac);
+
+}
+
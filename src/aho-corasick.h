@@ -0,0 +1,70 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* A trie node.  While building,  children are a linked list.  Once
+ * compiled,  they are a sorted run in the automaton's edge arrays */
+
+typedef struct _Aho_Corasick_Node _Aho_Corasick_Node;
+struct _Aho_Corasick_Node
+{
+    uint32_t fail;			/* Longest proper suffix that's also in the trie */
+    uint32_t dict;			/* Next node on the fail chain that ends a pattern,  or 0 */
+    int32_t  pattern;			/* Pattern ending here,  or -1 */
+
+    uint32_t child;			/* Building: first child.  Compiled: first edge */
+    uint32_t sibling;			/* Building only */
+    uint16_t child_count;
+    unsigned char c;
+};
+
+typedef struct _Aho_Corasick _Aho_Corasick;
+struct _Aho_Corasick
+{
+
+    sbool nocase;			/* Patterns are lower case.  Text is folded as we go */
+
+    _Aho_Corasick_Node *nodes;
+    uint32_t node_count;
+    uint32_t node_size;
+
+    unsigned char *edge_char;
+    uint32_t *edge_node;
+
+    uint32_t root[256];			/* The root's transitions,  by byte */
+
+    int pattern_count;
+    int pattern_base;			/* Added to every pattern number on a match */
+
+};
+
+_Aho_Corasick *Aho_Corasick_New( sbool, int );
+int Aho_Corasick_Add( _Aho_Corasick *, const char * );
+void Aho_Corasick_Compile( _Aho_Corasick * );
+void Aho_Corasick_Search( _Aho_Corasick *, const char *, uint64_t * );
+void Aho_Corasick_Free( _Aho_Corasick * );
+
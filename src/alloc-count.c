@@ -0,0 +1,80 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* alloc-count.c
+ *
+ * With --enable-alloc-count,  counts the heap allocations each thread
+ * makes,  so "Heap allocations/event" in the statistics can show that
+ * processing an event doesn't touch the allocator.  malloc(),  calloc()
+ * and realloc() are wrapped around glibc's own,  so every allocation is
+ * seen,  including ones made inside libraries.  Not for production use.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#ifdef WITH_ALLOC_COUNT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "alloc-count.h"
+
+#ifndef __GLIBC__
+#error "--enable-alloc-count needs glibc"
+#endif
+
+extern void *__libc_malloc( size_t );
+extern void *__libc_calloc( size_t, size_t );
+extern void *__libc_realloc( void *, size_t );
+
+static __thread uint64_t Alloc_Count_Local = 0;
+
+void *malloc( size_t size )
+{
+    Alloc_Count_Local++;
+    return( __libc_malloc(size) );
+}
+
+void *calloc( size_t nmemb, size_t size )
+{
+    Alloc_Count_Local++;
+    return( __libc_calloc(nmemb, size) );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+    Alloc_Count_Local++;
+    return( __libc_realloc(ptr, size) );
+}
+
+/****************************************************************************
+ * Alloc_Count - Allocations made by this thread so far
+ ****************************************************************************/
+
+uint64_t Alloc_Count( void )
+{
+    return(Alloc_Count_Local);
+}
+
+#endif
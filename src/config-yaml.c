@@ -39,12 +39,17 @@
 #include "sagan-defs.h"
 #include "config-yaml.h"
 #include "rules.h"
+#include "rules-index.h"
+#include "rule-profile.h"
+#include "rule-pool.h"
 #include "sagan-config.h"
 #include "classifications.h"
 #include "gen-msg.h"
 #include "protocol-map.h"
 #include "references.h"
 #include "parsers/parsers.h"
+#include "input.h"
+#include "input-parse.h"
 
 /* Processors */
 
@@ -85,6 +90,7 @@ struct _SaganVar *var;
 struct _SaganCounters *counters;
 struct _Rules_Loaded *rules_loaded;
 struct _Rule_Struct *rulestruct;
+struct _Sagan_Input *SaganInputs;
 
 #ifndef HAVE_LIBYAML
 ** You must of LIBYAML installed! **
@@ -114,6 +120,8 @@ void Load_YAML_Config( char *yaml_file )
     unsigned char sub_type = 0;
     unsigned char toggle = 0;
 
+    int input_type = 0;
+
     char *tok = NULL;
 
     char tmp[CONFBUF] = { 0 };
@@ -158,6 +166,19 @@ void Load_YAML_Config( char *yaml_file )
             config->sagan_proto = 17;           /* Default to UDP */
             config->max_processor_threads = MAX_PROCESSOR_THREADS;
 
+            config->sagan_queue_depth = DEFAULT_QUEUE_DEPTH;
+            config->sagan_queue_batch = DEFAULT_QUEUE_BATCH;
+            config->sagan_queue_block = false;
+            config->sagan_queue_shard = -1;
+
+            config->rule_profiling_top = RULE_PROFILE_TOP;
+
+            config->dns_cache_size = DEFAULT_DNS_CACHE_SIZE;
+            config->dns_cache_ttl = DEFAULT_DNS_CACHE_TTL;
+            config->dns_negative_ttl = DEFAULT_DNS_NEGATIVE_TTL;
+            config->dns_threads = DEFAULT_DNS_THREADS;
+            config->dns_wait = DEFAULT_DNS_WAIT;
+
             config->eve_fd              = -1;
             config->sagan_alert_fd      = -1;
             config->sagan_fast_fd       = -1;
@@ -595,6 +616,71 @@ void Load_YAML_Config( char *yaml_file )
                                                 }
                                         }
 
+                                    else if (!strcmp(last_pass, "dns-cache-size"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->dns_cache_size = atoi(tmp);
+
+                                            if ( config->dns_cache_size <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'dns-cache-size' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "dns-cache-ttl"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->dns_cache_ttl = atoi(tmp);
+
+                                            if ( config->dns_cache_ttl <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'dns-cache-ttl' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "dns-negative-ttl"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->dns_negative_ttl = atoi(tmp);
+
+                                            if ( config->dns_negative_ttl <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'dns-negative-ttl' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "dns-threads"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->dns_threads = atoi(tmp);
+
+                                            if ( config->dns_threads <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'dns-threads' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "dns-wait"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->dns_wait = atoi(tmp);
+
+                                            if ( config->dns_wait < 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'dns-wait' is invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
 #if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
 
                                     else if (!strcmp(last_pass, "fifo-size"))
@@ -633,6 +719,124 @@ void Load_YAML_Config( char *yaml_file )
 
                                         }
 
+                                    else if (!strcmp(last_pass, "queue-depth"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->sagan_queue_depth = atoi(tmp);
+
+                                            if ( config->sagan_queue_depth <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'queue-depth' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "queue-batch"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->sagan_queue_batch = atoi(tmp);
+
+                                            if ( config->sagan_queue_batch <= 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'queue-batch' is zero/invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "queue-full"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+
+                                            if (!strcasecmp(tmp, "block"))
+                                                {
+                                                    config->sagan_queue_block = true;
+                                                }
+
+                                            else if (!strcasecmp(tmp, "drop"))
+                                                {
+                                                    config->sagan_queue_block = false;
+                                                }
+
+                                            else
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'queue-full' is set to an invalid type '%s'. It must be 'drop' or 'block'. Abort!", __FILE__, __LINE__, tmp);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "queue-shard"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+
+                                            if (!strcasecmp(tmp, "none"))
+                                                {
+                                                    config->sagan_queue_shard = -1;
+                                                }
+
+                                            else
+                                                {
+
+                                                    config->sagan_queue_shard = Input_Field_Lookup(tmp);
+
+                                                    if ( config->sagan_queue_shard == -1 || config->sagan_queue_shard == INPUT_FIELD_DATE ||
+                                                            config->sagan_queue_shard == INPUT_FIELD_TIME || config->sagan_queue_shard == INPUT_FIELD_MESSAGE )
+                                                        {
+                                                            Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'queue-shard' is set to an invalid field '%s'. It must be 'none', 'host', 'program', 'facility', 'priority', 'level' or 'tag'. Abort!", __FILE__, __LINE__, tmp);
+                                                        }
+
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "fast-pattern-sample"))
+                                        {
+                                            Var_To_Value(value, config->fast_pattern_sample, sizeof(config->fast_pattern_sample));
+                                        }
+
+                                    else if (!strcmp(last_pass, "pcre-perf-map"))
+                                        {
+
+                                            if (!strcasecmp(value, "yes") || !strcasecmp(value, "true") )
+                                                {
+                                                    config->pcre_perf_map = true;
+                                                }
+                                        }
+
+                                    else if (!strcmp(last_pass, "rule-profiling"))
+                                        {
+
+                                            if (!strcasecmp(value, "yes") || !strcasecmp(value, "true") )
+                                                {
+                                                    config->rule_profiling = true;
+                                                }
+                                        }
+
+                                    else if (!strcmp(last_pass, "rule-adaptive"))
+                                        {
+
+                                            if (!strcasecmp(value, "yes") || !strcasecmp(value, "true") )
+                                                {
+                                                    config->rule_adaptive = true;
+                                                }
+                                        }
+
+                                    else if (!strcmp(last_pass, "rule-profiling-top"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            config->rule_profiling_top = atoi(tmp);
+
+                                            if ( config->rule_profiling_top < 0 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] sagan:core 'rule-profiling-top' is invalid. Abort!", __FILE__, __LINE__);
+                                                }
+
+                                        }
+
                                     else if (!strcmp(last_pass, "classification"))
                                         {
 
@@ -2041,6 +2245,143 @@ void Load_YAML_Config( char *yaml_file )
 #endif
                         } /* else if ype == YAML_TYPE_OUTPUT */
 
+                    /* Inputs can't be changed on a reload.  The reader threads are already
+                     * running */
+
+                    else if ( type == YAML_TYPE_INPUTS && config->sagan_reload == false )
+                        {
+
+                            if (!strcmp(value, "fifo") || !strcmp(value, "file") ||
+                                    !strcmp(value, "udp") || !strcmp(value, "tcp"))
+                                {
+
+                                    if (!strcmp(value, "fifo"))
+                                        {
+                                            sub_type = YAML_INPUT_FIFO;
+                                            input_type = INPUT_TYPE_FIFO;
+                                        }
+
+                                    else if (!strcmp(value, "file"))
+                                        {
+                                            sub_type = YAML_INPUT_FILE;
+                                            input_type = INPUT_TYPE_FILE;
+                                        }
+
+                                    else if (!strcmp(value, "udp"))
+                                        {
+                                            sub_type = YAML_INPUT_UDP;
+                                            input_type = INPUT_TYPE_UDP;
+                                        }
+
+                                    else
+                                        {
+                                            sub_type = YAML_INPUT_TCP;
+                                            input_type = INPUT_TYPE_TCP;
+                                        }
+
+                                    SaganInputs = (_Sagan_Input *) realloc(SaganInputs, (counters->input_count+1) * sizeof(_Sagan_Input));
+
+                                    if ( SaganInputs == NULL )
+                                        {
+                                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to reallocate memory for SaganInputs. Abort!", __FILE__, __LINE__);
+                                        }
+
+                                    memset(&SaganInputs[counters->input_count], 0, sizeof(_Sagan_Input));
+                                    SaganInputs[counters->input_count].type = input_type;
+                                    SaganInputs[counters->input_count].port = DEFAULT_INPUT_PORT;
+                                    strlcpy(SaganInputs[counters->input_count].address, DEFAULT_INPUT_ADDRESS, sizeof(SaganInputs[counters->input_count].address));
+
+                                    counters->input_count++;
+
+                                }
+
+                            else if ( sub_type == YAML_INPUT_FIFO || sub_type == YAML_INPUT_FILE )
+                                {
+
+                                    if (!strcmp(last_pass, "enabled"))
+                                        {
+
+                                            if ( !strcasecmp(value, "yes") || !strcasecmp(value, "true") )
+                                                {
+                                                    SaganInputs[counters->input_count-1].enabled = true;
+                                                }
+                                        }
+
+                                    else if (!strcmp(last_pass, "filename"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            strlcpy(SaganInputs[counters->input_count-1].path, tmp, sizeof(SaganInputs[counters->input_count-1].path));
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "format"))
+                                        {
+
+                                            if (( SaganInputs[counters->input_count-1].format = Input_Parse_Format(value) ) == -1 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] Input 'format' %s is invalid. Valid formats are 'sagan', 'rfc3164', 'rfc5424' and 'auto'. Abort!", __FILE__, __LINE__, value);
+                                                }
+
+                                        }
+
+                                } /* sub_type == YAML_INPUT_FIFO || sub_type == YAML_INPUT_FILE */
+
+                            else if ( sub_type == YAML_INPUT_UDP || sub_type == YAML_INPUT_TCP )
+                                {
+
+                                    if (!strcmp(last_pass, "enabled"))
+                                        {
+
+                                            if ( !strcasecmp(value, "yes") || !strcasecmp(value, "true") )
+                                                {
+                                                    SaganInputs[counters->input_count-1].enabled = true;
+                                                }
+                                        }
+
+                                    else if (!strcmp(last_pass, "address"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            strlcpy(SaganInputs[counters->input_count-1].address, tmp, sizeof(SaganInputs[counters->input_count-1].address));
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "port"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            SaganInputs[counters->input_count-1].port = atoi(tmp);
+
+                                            if ( SaganInputs[counters->input_count-1].port <= 0 || SaganInputs[counters->input_count-1].port > 65535 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] Input 'port' %s is invalid. Abort!", __FILE__, __LINE__, value);
+                                                }
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "buffer-size"))
+                                        {
+
+                                            Var_To_Value(value, tmp, sizeof(tmp));
+                                            SaganInputs[counters->input_count-1].socket_buffer = atoi(tmp);
+
+                                        }
+
+                                    else if (!strcmp(last_pass, "format"))
+                                        {
+
+                                            if (( SaganInputs[counters->input_count-1].format = Input_Parse_Format(value) ) == -1 )
+                                                {
+                                                    Sagan_Log(S_ERROR, "[%s, line %d] Input 'format' %s is invalid. Valid formats are 'sagan', 'rfc3164', 'rfc5424' and 'auto'. Abort!", __FILE__, __LINE__, value);
+                                                }
+
+                                        }
+
+                                } /* sub_type == YAML_INPUT_UDP || sub_type == YAML_INPUT_TCP */
+
+                        } /* else if ( type == YAML_TYPE_INPUTS */
+
                     else if ( type == YAML_TYPE_RULES )
                         {
 
@@ -2169,6 +2510,23 @@ void Load_YAML_Config( char *yaml_file )
 
                         } /* tag: outputs: */
 
+                    /****************/
+                    /**** Inputs ****/
+                    /****************/
+
+                    else if (!strcmp(value, "inputs"))
+                        {
+
+                            if ( debug->debugload )
+                                {
+                                    Sagan_Log(S_DEBUG, "[%s, line %d] **** Found Inputs ****", __FILE__, __LINE__);
+                                }
+
+                            type = YAML_TYPE_INPUTS;
+                            toggle = 0;
+
+                        } /* tag: inputs: */
+
                     /****************/
                     /**** Rules *****/
                     /****************/
@@ -2238,9 +2596,86 @@ void Load_YAML_Config( char *yaml_file )
         }
 
 
-    if ( config->sagan_is_file == false && config->sagan_fifo[0] == '\0' )
+    if ( config->sagan_reload == false )
         {
-            Sagan_Log(S_ERROR, "[%s, line %d] No FIFO option found which is required! Aborting!", __FILE__, __LINE__);
+
+            /* -F on the command line over rides any configured inputs */
+
+            if ( config->sagan_is_file == true )
+                {
+                    counters->input_count = 0;
+                }
+
+            /* Throw away disabled inputs */
+
+            check = 0;
+
+            for (a = 0; a < counters->input_count; a++)
+                {
+
+                    if ( SaganInputs[a].enabled == false )
+                        {
+                            continue;
+                        }
+
+                    /* Listeners are known by where they listen */
+
+                    if ( SaganInputs[a].type == INPUT_TYPE_UDP || SaganInputs[a].type == INPUT_TYPE_TCP )
+                        {
+                            snprintf(SaganInputs[a].path, sizeof(SaganInputs[a].path), "%s:%d", SaganInputs[a].address, SaganInputs[a].port);
+                        }
+
+                    if ( SaganInputs[a].path[0] == '\0' )
+                        {
+                            Sagan_Log(S_ERROR, "[%s, line %d] An input is enabled but has no 'filename'. Abort!", __FILE__, __LINE__);
+                        }
+
+                    SaganInputs[check++] = SaganInputs[a];
+                }
+
+            counters->input_count = check;
+
+            /* No inputs configured.  Fall back to $FIFO (or the -F file) */
+
+            if ( counters->input_count == 0 )
+                {
+
+                    if ( config->sagan_fifo[0] == '\0' )
+                        {
+                            Sagan_Log(S_ERROR, "[%s, line %d] No FIFO option found which is required! Aborting!", __FILE__, __LINE__);
+                        }
+
+                    SaganInputs = (_Sagan_Input *) realloc(SaganInputs, sizeof(_Sagan_Input));
+
+                    if ( SaganInputs == NULL )
+                        {
+                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to reallocate memory for SaganInputs. Abort!", __FILE__, __LINE__);
+                        }
+
+                    memset(&SaganInputs[0], 0, sizeof(_Sagan_Input));
+                    strlcpy(SaganInputs[0].path, config->sagan_fifo, sizeof(SaganInputs[0].path));
+                    SaganInputs[0].type = config->sagan_is_file == true ? INPUT_TYPE_FILE : INPUT_TYPE_FIFO;
+                    SaganInputs[0].enabled = true;
+
+                    counters->input_count = 1;
+                }
+
+            /* Two readers on the same FIFO would split its lines between them.  Two
+             * listeners on the same port won't bind */
+
+            for (a = 0; a < counters->input_count; a++)
+                {
+
+                    for ( check = a+1; check < counters->input_count; check++)
+                        {
+
+                            if ( SaganInputs[check].type == SaganInputs[a].type && !strcmp(SaganInputs[check].path, SaganInputs[a].path))
+                                {
+                                    Sagan_Log(S_ERROR, "[%s, line %d] The input '%s' is listed more than once.  Please correct this.", __FILE__, __LINE__, SaganInputs[a].path);
+                                }
+                        }
+                }
+
         }
 
     if ( config->sagan_host[0] == '\0' )
@@ -2315,6 +2750,13 @@ void Load_YAML_Config( char *yaml_file )
 
 #endif
 
+    Rule_Index_Build();
+
+    if ( debug->debugload )
+        {
+            Rule_Pool_Report();
+        }
+
     reload_rules = false;
 
 }
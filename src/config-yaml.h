@@ -41,6 +41,7 @@
 #define		YAML_TYPE_OUTPUT	4
 #define		YAML_TYPE_RULES		5
 #define		YAML_TYPE_INCLUDES	6
+#define		YAML_TYPE_INPUTS	7
 
 /*******************/
 /* Secondary types */
@@ -77,6 +78,13 @@
 #define		YAML_OUTPUT_ALERT		19
 #define		YAML_OUTPUT_EVE			20
 
+/* Inputs */
+
+#define		YAML_INPUT_FIFO			21
+#define		YAML_INPUT_FILE			22
+#define		YAML_INPUT_UDP			23
+#define		YAML_INPUT_TCP			24
+
 void Load_YAML_Config( char * );
 
 #endif
@@ -0,0 +1,404 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* dns-cache.c
+ *
+ * Hostname -> IP cache used when "source-lookup" is enabled.  Entries live
+ * in a fixed size table (hashed,  so a hit doesn't scan the cache) and
+ * expire after a TTL,  with a shorter TTL for failed lookups.  Lookups are
+ * never done by the thread asking for them.  A miss is queued for a pool
+ * of resolver threads,  and the caller waits up to "dns-wait" milliseconds
+ * for the answer before going on with the default host.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "lockfile.h"
+#include "dns-cache.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+
+pthread_mutex_t SaganDNSCacheMutex;
+
+static pthread_cond_t DNSCacheRequest = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DNSCacheResolved = PTHREAD_COND_INITIALIZER;
+
+static _Sagan_DNS_Entry *dns_entries = NULL;
+static _Sagan_DNS_Entry **dns_buckets = NULL;
+static uint32_t dns_bucket_mask = 0;
+static int dns_size = 0;
+static int dns_clock = 0;		/* Next entry to consider for eviction */
+
+static _Sagan_DNS_Entry *dns_request_head = NULL;
+static _Sagan_DNS_Entry *dns_request_tail = NULL;
+
+static void DNS_Cache_Resolver( void );
+static _Sagan_DNS_Entry *DNS_Cache_Find( const char *, uint32_t );
+static _Sagan_DNS_Entry *DNS_Cache_New( const char *, uint32_t );
+static void DNS_Cache_Request( _Sagan_DNS_Entry * );
+
+/****************************************************************************
+ * DNS_Cache_Init - Allocates the cache and starts the resolver threads.
+ ****************************************************************************/
+
+void DNS_Cache_Init( void )
+{
+
+    pthread_t resolver_id;
+    pthread_attr_t resolver_attr;
+    uint32_t buckets = 2;
+    int rc;
+    int i;
+
+    dns_size = config->dns_cache_size;
+
+    while ( buckets < (uint32_t)dns_size )
+        {
+            buckets <<= 1;
+        }
+
+    dns_entries = calloc(dns_size, sizeof(_Sagan_DNS_Entry));
+    dns_buckets = calloc(buckets, sizeof(_Sagan_DNS_Entry *));
+
+    if ( dns_entries == NULL || dns_buckets == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the DNS cache. Abort!", __FILE__, __LINE__);
+        }
+
+    dns_bucket_mask = buckets - 1;
+
+    pthread_attr_init(&resolver_attr);
+    pthread_attr_setdetachstate(&resolver_attr, PTHREAD_CREATE_DETACHED);
+
+    Sagan_Log(S_NORMAL, "DNS cache holds %d entries.  Spawning %d DNS Resolver Thread(s).", dns_size, config->dns_threads);
+
+    for ( i = 0; i < config->dns_threads; i++ )
+        {
+
+            rc = pthread_create( &resolver_id, &resolver_attr, (void *)DNS_Cache_Resolver, NULL );
+
+            if ( rc != 0 )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Could not pthread_create() for DNS resolvers [error: %d]. Abort!", __FILE__, __LINE__, rc);
+                }
+        }
+
+}
+
+/****************************************************************************
+ * DNS_Cache_Lookup - Copies the IP address for 'host' into 'str' and
+ * returns 0.  If the host can't be resolved,  or isn't resolved within
+ * "dns-wait",  'str' is set to config->sagan_host and -1 is returned.
+ ****************************************************************************/
+
+int DNS_Cache_Lookup( const char *host, char *str, size_t size )
+{
+
+    int rc = 0;
+
+    _Sagan_DNS_Entry *entry = NULL;
+    uint32_t hash = Djb2_Hash((char *)host);
+    time_t now = time(NULL);
+
+    struct timeval tv;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&SaganDNSCacheMutex);
+
+    counters->dns_request_count++;
+
+    entry = DNS_Cache_Find(host, hash);
+
+    if ( entry == NULL )
+        {
+
+            entry = DNS_Cache_New(host, hash);
+
+            if ( entry != NULL )
+                {
+                    DNS_Cache_Request(entry);
+                }
+        }
+
+    else if ( entry->state != DNS_CACHE_PENDING && entry->expires <= now )
+        {
+            DNS_Cache_Request(entry);		/* Expired,  look it up again */
+        }
+
+    else if ( entry->state != DNS_CACHE_PENDING )
+        {
+            counters->dns_hit_count++;
+        }
+
+    if ( entry != NULL && entry->state == DNS_CACHE_PENDING && config->dns_wait > 0 )
+        {
+
+            gettimeofday(&tv, NULL);
+            deadline.tv_sec = tv.tv_sec + config->dns_wait / 1000;
+            deadline.tv_nsec = ( tv.tv_usec + ( config->dns_wait % 1000 ) * 1000 ) * 1000;
+
+            if ( deadline.tv_nsec >= 1000000000 )
+                {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000;
+                }
+
+            while ( entry->state == DNS_CACHE_PENDING )
+                {
+                    if ( pthread_cond_timedwait(&DNSCacheResolved, &SaganDNSCacheMutex, &deadline) != 0 )
+                        {
+                            break;
+                        }
+                }
+
+            /* Could have been evicted and reused while we slept */
+
+            if ( entry->in_use == false || strcmp(entry->hostname, host) )
+                {
+                    entry = NULL;
+                }
+        }
+
+    if ( entry != NULL && entry->state == DNS_CACHE_RESOLVED )
+        {
+            strlcpy(str, entry->src_ip, size);
+        }
+    else
+        {
+
+            if ( entry == NULL || entry->state == DNS_CACHE_PENDING )
+                {
+                    counters->dns_timeout_count++;
+                }
+
+            strlcpy(str, config->sagan_host, size);
+            rc = -1;
+        }
+
+    pthread_mutex_unlock(&SaganDNSCacheMutex);
+
+    return(rc);
+}
+
+/****************************************************************************
+ * DNS_Cache_Find - Hash table lookup.  Caller holds SaganDNSCacheMutex.
+ ****************************************************************************/
+
+static _Sagan_DNS_Entry *DNS_Cache_Find( const char *host, uint32_t hash )
+{
+
+    _Sagan_DNS_Entry *entry;
+
+    for ( entry = dns_buckets[hash & dns_bucket_mask]; entry != NULL; entry = entry->next )
+        {
+            if ( entry->hash == hash && !strcmp(entry->hostname, host) )
+                {
+                    return(entry);
+                }
+        }
+
+    return(NULL);
+}
+
+/****************************************************************************
+ * DNS_Cache_New - Takes an entry for 'host'.  When the table is full the
+ * oldest entry that isn't waiting on a resolver is thrown out.  Returns
+ * NULL if every entry is pending.  Caller holds SaganDNSCacheMutex.
+ ****************************************************************************/
+
+static _Sagan_DNS_Entry *DNS_Cache_New( const char *host, uint32_t hash )
+{
+
+    _Sagan_DNS_Entry *entry = NULL;
+    _Sagan_DNS_Entry **link;
+    int i;
+
+    for ( i = 0; i < dns_size; i++ )
+        {
+
+            entry = &dns_entries[dns_clock];
+            dns_clock = ( dns_clock + 1 ) % dns_size;
+
+            if ( entry->in_use == false || entry->state != DNS_CACHE_PENDING )
+                {
+                    break;
+                }
+
+            entry = NULL;
+        }
+
+    if ( entry == NULL )
+        {
+            return(NULL);
+        }
+
+    if ( entry->in_use == true )
+        {
+
+            for ( link = &dns_buckets[entry->hash & dns_bucket_mask]; *link != entry; link = &(*link)->next );
+
+            *link = entry->next;
+
+            counters->dns_evict_count++;
+            counters->dns_cache_count--;
+        }
+
+    strlcpy(entry->hostname, host, sizeof(entry->hostname));
+    entry->hash = hash;
+    entry->in_use = true;
+    entry->src_ip[0] = '\0';
+
+    entry->next = dns_buckets[hash & dns_bucket_mask];
+    dns_buckets[hash & dns_bucket_mask] = entry;
+
+    counters->dns_cache_count++;
+
+    return(entry);
+}
+
+/****************************************************************************
+ * DNS_Cache_Request - Marks an entry pending and queues it for a resolver.
+ * Caller holds SaganDNSCacheMutex.
+ ****************************************************************************/
+
+static void DNS_Cache_Request( _Sagan_DNS_Entry *entry )
+{
+
+    entry->state = DNS_CACHE_PENDING;
+    entry->next_request = NULL;
+
+    if ( dns_request_tail == NULL )
+        {
+            dns_request_head = entry;
+        }
+    else
+        {
+            dns_request_tail->next_request = entry;
+        }
+
+    dns_request_tail = entry;
+
+    counters->dns_lookup_count++;
+
+    pthread_cond_signal(&DNSCacheRequest);
+
+}
+
+/****************************************************************************
+ * DNS_Cache_Resolver - Resolver thread.  DNS_Lookup() is called without
+ * the cache lock held.
+ ****************************************************************************/
+
+static void DNS_Cache_Resolver( void )
+{
+
+    _Sagan_DNS_Entry *entry;
+
+    char hostname[64] = { 0 };
+    char src_ip[MAXIP] = { 0 };
+
+    struct timeval start;
+    struct timeval end;
+    uintmax_t usec;
+    int rc;
+
+    (void)SetThreadName("SaganDNS");
+
+    for (;;)
+        {
+
+            pthread_mutex_lock(&SaganDNSCacheMutex);
+
+            while ( dns_request_head == NULL )
+                {
+                    pthread_cond_wait(&DNSCacheRequest, &SaganDNSCacheMutex);
+                }
+
+            entry = dns_request_head;
+            dns_request_head = entry->next_request;
+
+            if ( dns_request_head == NULL )
+                {
+                    dns_request_tail = NULL;
+                }
+
+            strlcpy(hostname, entry->hostname, sizeof(hostname));
+
+            pthread_mutex_unlock(&SaganDNSCacheMutex);
+
+            gettimeofday(&start, NULL);
+            rc = DNS_Lookup(hostname, src_ip, sizeof(src_ip));
+            gettimeofday(&end, NULL);
+
+            usec = ( end.tv_sec - start.tv_sec ) * 1000000 + ( end.tv_usec - start.tv_usec );
+
+            pthread_mutex_lock(&SaganDNSCacheMutex);
+
+            /* Pending entries are never evicted,  so 'entry' is still ours */
+
+            if ( rc == 0 )
+                {
+                    strlcpy(entry->src_ip, src_ip, sizeof(entry->src_ip));
+                    entry->state = DNS_CACHE_RESOLVED;
+                    entry->expires = time(NULL) + config->dns_cache_ttl;
+                }
+            else
+                {
+                    entry->state = DNS_CACHE_FAILED;
+                    entry->expires = time(NULL) + config->dns_negative_ttl;
+                    counters->dns_miss_count++;
+                }
+
+            counters->dns_lookup_usec += usec;
+
+            if ( usec > counters->dns_lookup_max_usec )
+                {
+                    counters->dns_lookup_max_usec = usec;
+                }
+
+            pthread_cond_broadcast(&DNSCacheResolved);
+            pthread_mutex_unlock(&SaganDNSCacheMutex);
+
+        }
+
+}
@@ -0,0 +1,50 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+#define DNS_CACHE_PENDING	0	/* Waiting on a resolver thread */
+#define DNS_CACHE_RESOLVED	1
+#define DNS_CACHE_FAILED	2
+
+typedef struct _Sagan_DNS_Entry _Sagan_DNS_Entry;
+struct _Sagan_DNS_Entry
+{
+
+    char	hostname[64];
+    char	src_ip[MAXIP];
+    uint32_t	hash;
+    int		state;
+    sbool	in_use;
+    time_t	expires;
+
+    _Sagan_DNS_Entry *next;		/* Hash bucket chain */
+    _Sagan_DNS_Entry *next_request;	/* Resolver queue */
+
+};
+
+void DNS_Cache_Init( void );
+int DNS_Cache_Lookup( const char *, char *, size_t );
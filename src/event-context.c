@@ -0,0 +1,352 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* event-context.c
+ *
+ * Fields the engine pulls out of an event,  worked out once per event
+ * no matter how many rules ask for them.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "event-context.h"
+
+#include "parsers/parsers.h"
+
+#ifdef HAVE_LIBLOGNORM
+#include "liblognormalize.h"
+
+static __thread struct _SaganNormalizeLiblognorm Event_Context_Liblognorm;
+#endif
+
+struct _SaganConfig *config;
+
+/****************************************************************************
+ * Event_Context_Init - Start a new event.  Nothing is parsed until a rule
+ * asks for it
+ ****************************************************************************/
+
+void Event_Context_Init( _Sagan_Event_Context *ctx, struct _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, size_t message_len )
+{
+
+    ctx->syslog = SaganProcSyslog_LOCAL;
+    ctx->message_len = message_len;
+    ctx->parsed = 0;
+    ctx->ip_bits_count = 0;
+
+    memset(ctx->lookup_cache, 0, sizeof(ctx->lookup_cache));
+
+    ctx->normalize = NULL;
+    ctx->json_normalize = NULL;
+    ctx->normalize_status = 0;
+
+}
+
+/****************************************************************************
+ * Event_Context_Free - Release anything the event held on to
+ ****************************************************************************/
+
+void Event_Context_Free( _Sagan_Event_Context *ctx )
+{
+
+#ifdef HAVE_LIBLOGNORM
+
+    if ( ctx->json_normalize != NULL )
+        {
+            json_object_put(ctx->json_normalize);
+            ctx->json_normalize = NULL;
+        }
+
+#endif
+
+}
+
+/****************************************************************************
+ * Event_Context_IP - The 'pos'th IP address in the message,  or "" if
+ * there isn't one.  Loopback addresses come back as sagan_host
+ ****************************************************************************/
+
+char *Event_Context_IP( _Sagan_Event_Context *ctx, int pos )
+{
+
+    if ( pos < 1 )
+        {
+            return("");
+        }
+
+    if ( pos > MAX_PARSE_IP )
+        {
+            Parse_IP(ctx->syslog->syslog_message, pos, ctx->ip, sizeof(ctx->ip), NULL, 0);
+            return(ctx->ip);
+        }
+
+    if ( ctx->lookup_cache[pos-1].searched == false )
+        {
+            Parse_IP(ctx->syslog->syslog_message, pos, NULL, sizeof(ctx->lookup_cache[pos-1].ip), ctx->lookup_cache, MAX_PARSE_IP);
+        }
+
+    return(ctx->lookup_cache[pos-1].ip);
+}
+
+/****************************************************************************
+ * Event_Context_IP_Bits - IP2Bit(),  remembered for the rest of the event
+ ****************************************************************************/
+
+sbool Event_Context_IP_Bits( _Sagan_Event_Context *ctx, const char *ip, unsigned char *bits )
+{
+
+    int i;
+    _Sagan_Event_Context_IP *entry = NULL;
+
+    if ( ip == NULL || ip[0] == '\0' )
+        {
+            return(false);
+        }
+
+    for ( i = 0; i < ctx->ip_bits_count; i++ )
+        {
+
+            if ( !strcmp(ctx->ip_bits[i].ip, ip) )
+                {
+
+                    if ( ctx->ip_bits[i].valid )
+                        {
+                            memcpy(bits, ctx->ip_bits[i].bits, MAXIPBIT);
+                        }
+
+                    return(ctx->ip_bits[i].valid);
+                }
+        }
+
+    /* Out of room.  This only happens with a lot of "parse_src_ip" positions */
+
+    if ( ctx->ip_bits_count == EVENT_CONTEXT_IP_BITS )
+        {
+            return(IP2Bit((char *)ip, bits));
+        }
+
+    entry = &ctx->ip_bits[ctx->ip_bits_count++];
+
+    strlcpy(entry->ip, ip, sizeof(entry->ip));
+    memset(entry->bits, 0, sizeof(entry->bits));
+
+    entry->valid = IP2Bit(entry->ip, entry->bits);
+
+    if ( entry->valid )
+        {
+            memcpy(bits, entry->bits, MAXIPBIT);
+        }
+
+    return(entry->valid);
+}
+
+/****************************************************************************
+ * Event_Context_Src_Port/Event_Context_Dst_Port - "parse_port"
+ ****************************************************************************/
+
+int Event_Context_Src_Port( _Sagan_Event_Context *ctx )
+{
+
+    if ( !( ctx->parsed & EVENT_CONTEXT_SRC_PORT ) )
+        {
+            ctx->src_port = Parse_Src_Port(ctx->syslog->syslog_message);
+            ctx->parsed |= EVENT_CONTEXT_SRC_PORT;
+        }
+
+    return(ctx->src_port);
+}
+
+int Event_Context_Dst_Port( _Sagan_Event_Context *ctx )
+{
+
+    if ( !( ctx->parsed & EVENT_CONTEXT_DST_PORT ) )
+        {
+            ctx->dst_port = Parse_Dst_Port(ctx->syslog->syslog_message);
+            ctx->parsed |= EVENT_CONTEXT_DST_PORT;
+        }
+
+    return(ctx->dst_port);
+}
+
+/****************************************************************************
+ * Event_Context_Proto/Event_Context_Proto_Program - "parse_proto" and
+ * "parse_proto_program"
+ ****************************************************************************/
+
+int Event_Context_Proto( _Sagan_Event_Context *ctx )
+{
+
+    if ( !( ctx->parsed & EVENT_CONTEXT_PROTO ) )
+        {
+            ctx->proto = Parse_Proto(ctx->syslog->syslog_message);
+            ctx->parsed |= EVENT_CONTEXT_PROTO;
+        }
+
+    return(ctx->proto);
+}
+
+int Event_Context_Proto_Program( _Sagan_Event_Context *ctx )
+{
+
+    if ( !( ctx->parsed & EVENT_CONTEXT_PROTO_PROGRAM ) )
+        {
+            ctx->proto_program = Parse_Proto_Program(ctx->syslog->syslog_program);
+            ctx->parsed |= EVENT_CONTEXT_PROTO_PROGRAM;
+        }
+
+    return(ctx->proto_program);
+}
+
+/****************************************************************************
+ * Event_Context_Hash - "parse_hash".  Returns "" if the message has no
+ * hash of that type
+ ****************************************************************************/
+
+char *Event_Context_Hash( _Sagan_Event_Context *ctx, int type )
+{
+
+    switch ( type )
+        {
+
+        case PARSE_HASH_MD5:
+
+            if ( !( ctx->parsed & EVENT_CONTEXT_MD5 ) )
+                {
+                    Parse_Hash(ctx->syslog->syslog_message, PARSE_HASH_MD5, ctx->md5, sizeof(ctx->md5));
+                    ctx->parsed |= EVENT_CONTEXT_MD5;
+                }
+
+            return(ctx->md5);
+
+        case PARSE_HASH_SHA1:
+
+            if ( !( ctx->parsed & EVENT_CONTEXT_SHA1 ) )
+                {
+                    Parse_Hash(ctx->syslog->syslog_message, PARSE_HASH_SHA1, ctx->sha1, sizeof(ctx->sha1));
+                    ctx->parsed |= EVENT_CONTEXT_SHA1;
+                }
+
+            return(ctx->sha1);
+
+        case PARSE_HASH_SHA256:
+
+            if ( !( ctx->parsed & EVENT_CONTEXT_SHA256 ) )
+                {
+                    Parse_Hash(ctx->syslog->syslog_message, PARSE_HASH_SHA256, ctx->sha256, sizeof(ctx->sha256));
+                    ctx->parsed |= EVENT_CONTEXT_SHA256;
+                }
+
+            return(ctx->sha256);
+
+        }
+
+    return("");
+}
+
+/****************************************************************************
+ * Event_Context_Lower - The message in lower case.  For processors that
+ * search it for (already lower case) values without caring about case
+ ****************************************************************************/
+
+const char *Event_Context_Lower( _Sagan_Event_Context *ctx )
+{
+
+    size_t i;
+    size_t len;
+
+    if ( !( ctx->parsed & EVENT_CONTEXT_LOWER ) )
+        {
+
+            len = ctx->message_len < sizeof(ctx->message_lower) ? ctx->message_len : sizeof(ctx->message_lower) - 1;
+
+            for ( i = 0; i < len; i++ )
+                {
+                    ctx->message_lower[i] = tolower((unsigned char)ctx->syslog->syslog_message[i]);
+                }
+
+            ctx->message_lower[len] = '\0';
+            ctx->parsed |= EVENT_CONTEXT_LOWER;
+        }
+
+    return(ctx->message_lower);
+}
+
+/****************************************************************************
+ * Event_Context_Normalize - Run the message through liblognorm.  Returns
+ * 1 if liblognorm found something we use,  -1 if it didn't (or Sagan was
+ * built without it)
+ ****************************************************************************/
+
+int Event_Context_Normalize( _Sagan_Event_Context *ctx )
+{
+
+#ifdef HAVE_LIBLOGNORM
+
+    struct _SaganNormalizeLiblognorm *normalize = &Event_Context_Liblognorm;
+
+    if ( ctx->parsed & EVENT_CONTEXT_NORMALIZE )
+        {
+            return(ctx->normalize_status);
+        }
+
+    ctx->parsed |= EVENT_CONTEXT_NORMALIZE;
+    ctx->normalize_status = -1;
+
+    memset(normalize, 0, sizeof(struct _SaganNormalizeLiblognorm));
+
+    ctx->json_normalize = Normalize_Liblognorm(ctx->syslog->syslog_message, normalize);
+    ctx->normalize = normalize;
+
+    if ( normalize->ip_src[0] != '0'  ||
+            normalize->ip_dst[0] != '0'  ||
+            normalize->src_port != 0  ||
+            normalize->dst_port != 0  ||
+            normalize->hash_md5[0] != '\0'  ||
+            normalize->hash_sha1[0] != '\0'  ||
+            normalize->hash_sha256[0] != '\0'  ||
+            normalize->username[0] != '\0'  ||
+            ( config->selector_flag && normalize->selector[0] != '\0' ) ||
+            normalize->http_uri[0] != '\0'  ||
+            normalize->filename[0] != '\0' )
+        {
+            ctx->normalize_status = 1;
+        }
+
+    return(ctx->normalize_status);
+
+#else
+
+    return(-1);
+
+#endif
+
+}
@@ -0,0 +1,102 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+
+/* Things the engine pulls out of an event (IP addresses,  ports,  hashes,
+ * etc) used to be worked out again for every rule that asked for them.
+ * They are now worked out the first time a rule asks and kept here
+ * until the next event.  Each field has a bit in 'parsed' */
+
+#define EVENT_CONTEXT_SRC_PORT		0x0001
+#define EVENT_CONTEXT_DST_PORT		0x0002
+#define EVENT_CONTEXT_PROTO		0x0004
+#define EVENT_CONTEXT_PROTO_PROGRAM	0x0008
+#define EVENT_CONTEXT_MD5		0x0010
+#define EVENT_CONTEXT_SHA1		0x0020
+#define EVENT_CONTEXT_SHA256		0x0040
+#define EVENT_CONTEXT_LOWER		0x0080
+#define EVENT_CONTEXT_NORMALIZE		0x0100
+
+/* IP addresses we've turned into bits.  The same few (parse_src_ip,
+ * parse_dst_ip,  sagan_host) come up over and over */
+
+#define EVENT_CONTEXT_IP_BITS		16
+
+typedef struct _Sagan_Event_Context_IP _Sagan_Event_Context_IP;
+struct _Sagan_Event_Context_IP
+{
+    char ip[MAXIP];
+    unsigned char bits[MAXIPBIT];
+    sbool valid;
+};
+
+typedef struct _Sagan_Event_Context _Sagan_Event_Context;
+struct _Sagan_Event_Context
+{
+
+    struct _Sagan_Proc_Syslog *syslog;
+    size_t message_len;
+
+    uint32_t parsed;
+
+    /* parse_src_ip/parse_dst_ip,  by position (see Parse_IP()) */
+
+    _Sagan_Lookup_Cache_Entry lookup_cache[MAX_PARSE_IP];
+    char ip[MAXIP];			/* Positions past MAX_PARSE_IP */
+
+    _Sagan_Event_Context_IP ip_bits[EVENT_CONTEXT_IP_BITS];
+    int ip_bits_count;
+
+    int src_port;
+    int dst_port;
+    int proto;
+    int proto_program;
+
+    char md5[MD5_HASH_SIZE+1];
+    char sha1[SHA1_HASH_SIZE+1];
+    char sha256[SHA256_HASH_SIZE+1];
+
+    char message_lower[MAX_SYSLOGMSG];
+
+    /* liblognorm.  'normalize_status' is 1 if liblognorm found anything
+     * we use,  -1 if it didn't */
+
+    struct _SaganNormalizeLiblognorm *normalize;
+    json_object *json_normalize;
+    int normalize_status;
+
+};
+
+void Event_Context_Init( _Sagan_Event_Context *, struct _Sagan_Proc_Syslog *, size_t );
+void Event_Context_Free( _Sagan_Event_Context * );
+char *Event_Context_IP( _Sagan_Event_Context *, int );
+sbool Event_Context_IP_Bits( _Sagan_Event_Context *, const char *, unsigned char * );
+int Event_Context_Src_Port( _Sagan_Event_Context * );
+int Event_Context_Dst_Port( _Sagan_Event_Context * );
+int Event_Context_Proto( _Sagan_Event_Context * );
+int Event_Context_Proto_Program( _Sagan_Event_Context * );
+char *Event_Context_Hash( _Sagan_Event_Context *, int );
+const char *Event_Context_Lower( _Sagan_Event_Context * );
+int Event_Context_Normalize( _Sagan_Event_Context * );
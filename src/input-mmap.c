@@ -0,0 +1,884 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* input-mmap.c
+ *
+ * -P/--parallel processing of files.  The file is mapped and cut into line
+ * aligned chunks,  and the worker threads parse and run the events
+ * themselves.  There is no reader thread or work queue in between.
+ *
+ * "chunk" - Each worker takes the next chunk.  Fastest,  but events from
+ *           one host can be split across workers (and run out of order).
+ *
+ * "host"  - Each chunk is scanned once (by whichever worker gets to it
+ *           first) and its lines grouped by the worker their host hashes
+ *           to.  Every worker then runs its own lines of every chunk,  so
+ *           each host's events are seen in file order by one thread.
+ *
+ * after/threshold/xbit state is keyed on IPs,  ports and usernames from the
+ * message (or sagan_host),  not the syslog host,  and dynamic rules can load
+ * any of them.  Split across workers,  what those rules fire on would
+ * depend on timing.  If any are loaded the file is run by one worker,
+ * which gives the same answer as reading it without -P.
+ *
+ * With -O/--ordered,  alerts are held until every chunk before them has
+ * been processed,  then written in the order of the lines that fired them.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#ifdef HAVE_LIBLOGNORM
+#include <json.h>
+#endif
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "lockfile.h"
+#include "output.h"
+#include "processor.h"
+#include "input.h"
+#include "input-parse.h"
+#include "input-mmap.h"
+#include "rules.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+struct _Rule_Struct *rulestruct;
+
+pthread_mutex_t SaganInputMutex;
+
+/* Set for a -P worker thread when alerts are being held (-O) */
+
+static __thread _Sagan_Input_Mmap_Worker *mmap_worker = NULL;
+
+/* Files being run with -O.  Their held alerts point at rules by number */
+
+static int mmap_ordered = 0;
+
+static void Input_Mmap_Worker( _Sagan_Input_Mmap_Worker * );
+static void Input_Mmap_Chunk( _Sagan_Input_Mmap_Worker *, _Sagan_Input_Chunk *, struct _Sagan_Proc_Syslog * );
+static void Input_Mmap_Line( _Sagan_Input_Mmap_Worker *, const char *, size_t, struct _Sagan_Proc_Syslog * );
+static void Input_Mmap_Scan_Wait( _Sagan_Input_Mmap_Worker *, int );
+static void Input_Mmap_Scan( _Sagan_Input_Mmap_Worker *, _Sagan_Input_Chunk * );
+static void Input_Mmap_Chunk_Done( _Sagan_Input_Mmap_Worker *, _Sagan_Input_Chunk * );
+static int Input_Mmap_Partition( _Sagan_Input *, const char *, size_t, int );
+static int Input_Mmap_Stateful( void );
+static int Input_Mmap_Alert_Compare( const void *, const void * );
+static void Input_Mmap_Alert_Strings( _Sagan_Event *, char *** );
+static void Input_Mmap_Alert_Free( _Sagan_Input_Alert * );
+
+/****************************************************************************
+ * Input_Mmap_Reader - Maps a file,  splits it into chunks and runs
+ * config->max_processor_threads workers over it.  Takes the place of
+ * Input_Reader() for files when -P is used.
+ ****************************************************************************/
+
+void Input_Mmap_Reader( _Sagan_Input *input )
+{
+
+    _Sagan_Input_Mmap mmap_input;
+    _Sagan_Input_Mmap_Worker *workers = NULL;
+    pthread_t *worker_id = NULL;
+
+    struct stat st;
+    const char *newline;
+    size_t offset;
+    size_t end;
+    int stateful;
+    int error;
+    int rc;
+    int i;
+
+    SetThreadName("SaganMmap");
+
+    memset(&mmap_input, 0, sizeof(mmap_input));
+    mmap_input.input = input;
+
+    Sagan_Log(S_NORMAL, "Attempting to open syslog FILE (%s).", input->path);
+
+    if (( input->fd = open(input->path, O_RDONLY) ) == -1 || fstat(input->fd, &st) == -1 )
+        {
+            error = errno;
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Could not open file '%s': %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+        }
+
+    mmap_input.size = st.st_size;
+
+    if ( mmap_input.size == 0 )
+        {
+            Input_Finished(input);
+            return;
+        }
+
+    mmap_input.map = mmap(NULL, mmap_input.size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+
+    if ( mmap_input.map == MAP_FAILED )
+        {
+            error = errno;
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Could not mmap() '%s': %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+        }
+
+#ifdef MADV_SEQUENTIAL
+    madvise((void *)mmap_input.map, mmap_input.size, MADV_SEQUENTIAL);
+#endif
+
+    /* Line aligned chunks */
+
+    mmap_input.chunks = malloc(( mmap_input.size / INPUT_MMAP_CHUNK + 1 ) * sizeof(_Sagan_Input_Chunk));
+
+    if ( mmap_input.chunks == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input chunks. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( offset = 0; offset < mmap_input.size; offset = end )
+        {
+
+            end = offset + INPUT_MMAP_CHUNK;
+
+            if ( end >= mmap_input.size )
+                {
+                    end = mmap_input.size;
+                }
+            else
+                {
+                    newline = memchr(mmap_input.map + end, '\n', mmap_input.size - end);
+                    end = newline != NULL ? (size_t)( newline - mmap_input.map ) + 1 : mmap_input.size;
+                }
+
+            mmap_input.chunks[mmap_input.chunk_count].offset = offset;
+            mmap_input.chunks[mmap_input.chunk_count].length = end - offset;
+            mmap_input.chunks[mmap_input.chunk_count].alerts = NULL;
+            mmap_input.chunk_count++;
+        }
+
+    mmap_input.workers = config->max_processor_threads;
+
+    stateful = Input_Mmap_Stateful();
+
+    if ( stateful > 0 && mmap_input.workers > 1 )
+        {
+            Sagan_Log(S_WARN, "-P/--parallel: %d rule(s) use after,  threshold,  xbits or dynamic rules,  which depend on the order events are seen in.  Running %s with one worker.", stateful, input->path);
+            mmap_input.workers = 1;
+        }
+
+    /* One worker has nothing to split by host */
+
+    mmap_input.by_host = config->parallel_by_host && mmap_input.workers > 1;
+
+    if ( mmap_input.by_host == false && mmap_input.workers > mmap_input.chunk_count )
+        {
+            mmap_input.workers = mmap_input.chunk_count;
+        }
+
+    for ( i = 0; i < mmap_input.chunk_count; i++ )
+        {
+            mmap_input.chunks[i].pending = mmap_input.by_host ? mmap_input.workers : 1;
+            mmap_input.chunks[i].unread = mmap_input.workers;
+            mmap_input.chunks[i].scanned = false;
+            mmap_input.chunks[i].lines = NULL;
+            mmap_input.chunks[i].first = NULL;
+        }
+
+    pthread_mutex_init(&mmap_input.mutex, NULL);
+    pthread_cond_init(&mmap_input.scanned, NULL);
+
+    workers = calloc(mmap_input.workers, sizeof(_Sagan_Input_Mmap_Worker));
+    worker_id = calloc(mmap_input.workers, sizeof(pthread_t));
+
+    if ( workers == NULL || worker_id == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input workers. Abort!", __FILE__, __LINE__);
+        }
+
+    if ( config->parallel_ordered )
+        {
+            __atomic_add_fetch(&mmap_ordered, 1, __ATOMIC_SEQ_CST);
+        }
+
+    Sagan_Log(S_NORMAL, "Processing %s in %d chunk(s) with %d thread(s),  split by %s%s.", input->path, mmap_input.chunk_count, mmap_input.workers, mmap_input.by_host ? "host" : "chunk", config->parallel_ordered ? ",  alerts in input order" : "");
+
+    for ( i = 0; i < mmap_input.workers; i++ )
+        {
+
+            workers[i].mmap = &mmap_input;
+            workers[i].id = i;
+
+            rc = pthread_create( &worker_id[i], NULL, (void *)Input_Mmap_Worker, &workers[i] );
+
+            if ( rc != 0 )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Could not pthread_create() for input workers [error: %d]. Abort!", __FILE__, __LINE__, rc);
+                }
+        }
+
+    for ( i = 0; i < mmap_input.workers; i++ )
+        {
+            pthread_join(worker_id[i], NULL);
+        }
+
+    if ( config->parallel_ordered )
+        {
+            __atomic_sub_fetch(&mmap_ordered, 1, __ATOMIC_SEQ_CST);
+        }
+
+    munmap((void *)mmap_input.map, mmap_input.size);
+    pthread_mutex_destroy(&mmap_input.mutex);
+    pthread_cond_destroy(&mmap_input.scanned);
+
+    free(mmap_input.chunks);
+    free(workers);
+    free(worker_id);
+
+    Input_Finished(input);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Worker - Runs chunks until there are none left.
+ ****************************************************************************/
+
+static void Input_Mmap_Worker( _Sagan_Input_Mmap_Worker *worker )
+{
+
+    _Sagan_Input_Mmap *mmap_input = worker->mmap;
+    _Sagan_Input *input = &worker->input;
+    struct _Sagan_Proc_Syslog *event = NULL;
+
+    uintmax_t lines;
+    uintmax_t malformed;
+    uintmax_t dropped;
+
+    time_t t;
+    struct tm now;
+    int next = 0;
+    int chunk;
+
+    SetThreadName("SaganWorker");
+
+    /* Each worker counts into its own copy of the input,  and adds its
+     * numbers to the real one as chunks are finished */
+
+    memcpy(input, mmap_input->input, sizeof(_Sagan_Input));
+    input->lines = 0;
+    input->malformed = 0;
+    input->dropped = 0;
+    input->dynamic_line_count = 0;
+    input->replay_date[0] = '\0';
+    input->replay_last = 0;
+
+    event = malloc(sizeof(struct _Sagan_Proc_Syslog));
+
+    if ( event == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input worker event. Abort!", __FILE__, __LINE__);
+        }
+
+    if ( config->parallel_ordered )
+        {
+            worker->alerts = NULL;
+            worker->alerts_tail = &worker->alerts;
+            mmap_worker = worker;
+        }
+
+    for (;;)
+        {
+
+            if ( mmap_input->by_host )
+                {
+                    chunk = next++;
+                }
+            else
+                {
+                    chunk = __atomic_fetch_add(&mmap_input->next_chunk, 1, __ATOMIC_RELAXED);
+                }
+
+            if ( chunk >= mmap_input->chunk_count )
+                {
+                    break;
+                }
+
+            t = time(NULL);
+            localtime_r(&t, &now);
+            input->year = now.tm_year + 1900;
+            input->month = now.tm_mon + 1;
+
+            lines = input->lines;
+            malformed = input->malformed;
+            dropped = input->dropped;
+
+            if ( mmap_input->by_host )
+                {
+                    Input_Mmap_Scan_Wait(worker, chunk);
+                }
+
+            Input_Mmap_Chunk(worker, &mmap_input->chunks[chunk], event);
+
+            /* The last worker through frees the grouping */
+
+            if ( mmap_input->by_host && __atomic_sub_fetch(&mmap_input->chunks[chunk].unread, 1, __ATOMIC_ACQ_REL) == 0 )
+                {
+                    free(mmap_input->chunks[chunk].lines);
+                    free(mmap_input->chunks[chunk].first);
+                    mmap_input->chunks[chunk].lines = NULL;
+                    mmap_input->chunks[chunk].first = NULL;
+                }
+
+            pthread_mutex_lock(&SaganInputMutex);
+            mmap_input->input->lines += input->lines - lines;
+            mmap_input->input->malformed += input->malformed - malformed;
+            mmap_input->input->dropped += input->dropped - dropped;
+            counters->sagantotal += input->lines - lines;
+            counters->sagan_log_drop += input->dropped - dropped;
+            pthread_mutex_unlock(&SaganInputMutex);
+
+            Input_Mmap_Chunk_Done(worker, &mmap_input->chunks[chunk]);
+
+        }
+
+    mmap_worker = NULL;
+    free(event);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Chunk - Runs the lines of a chunk through the engine.  By
+ * host,  only the lines Input_Mmap_Scan() gave this worker.
+ ****************************************************************************/
+
+static void Input_Mmap_Chunk( _Sagan_Input_Mmap_Worker *worker, _Sagan_Input_Chunk *chunk, struct _Sagan_Proc_Syslog *event )
+{
+
+    _Sagan_Input_Mmap *mmap_input = worker->mmap;
+    const char *base = mmap_input->map + chunk->offset;
+    const char *line = base;
+    const char *end = base + chunk->length;
+    const char *newline;
+    uint32_t i;
+
+    if ( mmap_input->by_host )
+        {
+
+            for ( i = chunk->first[worker->id]; i < chunk->first[worker->id + 1]; i++ )
+                {
+
+                    line = base + chunk->lines[i];
+                    newline = memchr(line, '\n', end - line);
+
+                    Input_Mmap_Line(worker, line, ( newline != NULL ? newline : end ) - line, event);
+                }
+
+        }
+    else
+        {
+
+            while ( line < end )
+                {
+
+                    newline = memchr(line, '\n', end - line);
+
+                    if ( newline == NULL )
+                        {
+                            newline = end;
+                        }
+
+                    /* Blank lines aren't events */
+
+                    if ( newline != line )
+                        {
+                            Input_Mmap_Line(worker, line, newline - line, event);
+                        }
+
+                    line = newline + 1;
+                }
+
+        }
+
+    if ( worker->batch != 0 )
+        {
+            Processor_Work_Done();
+            worker->batch = 0;
+        }
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Line - Runs one line through the engine.  Like Processor(),
+ * the rules are only held for queue-batch lines at a time,  so a reload
+ * doesn't wait on a whole chunk
+ ****************************************************************************/
+
+static void Input_Mmap_Line( _Sagan_Input_Mmap_Worker *worker, const char *line, size_t length, struct _Sagan_Proc_Syslog *event )
+{
+
+    if ( worker->batch == 0 )
+        {
+            Processor_Work_Start();
+        }
+
+    worker->offset = line - worker->mmap->map;
+
+    Input_Process_Line(&worker->input, line, length, NULL, event);
+    Processor_Event(event);
+
+    if ( ++worker->batch >= config->sagan_queue_batch )
+        {
+            Processor_Work_Done();
+            worker->batch = 0;
+        }
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Scan_Wait - Returns once 'chunk' has been grouped by host.
+ * Rather than sit idle,  a worker groups the next chunk nobody has taken
+ * yet,  staying no more than one chunk per worker ahead.
+ ****************************************************************************/
+
+static void Input_Mmap_Scan_Wait( _Sagan_Input_Mmap_Worker *worker, int chunk )
+{
+
+    _Sagan_Input_Mmap *mmap_input = worker->mmap;
+    int scan;
+
+    pthread_mutex_lock(&mmap_input->mutex);
+
+    while ( mmap_input->chunks[chunk].scanned == false )
+        {
+
+            if ( mmap_input->next_scan < mmap_input->chunk_count && mmap_input->next_scan <= chunk + mmap_input->workers )
+                {
+
+                    scan = mmap_input->next_scan++;
+
+                    pthread_mutex_unlock(&mmap_input->mutex);
+                    Input_Mmap_Scan(worker, &mmap_input->chunks[scan]);
+                    pthread_mutex_lock(&mmap_input->mutex);
+
+                    mmap_input->chunks[scan].scanned = true;
+                    pthread_cond_broadcast(&mmap_input->scanned);
+                }
+            else
+                {
+                    pthread_cond_wait(&mmap_input->scanned, &mmap_input->mutex);
+                }
+        }
+
+    pthread_mutex_unlock(&mmap_input->mutex);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Scan - Finds the host of every line in a chunk,  once,  and
+ * groups the line offsets by the worker each belongs to.
+ ****************************************************************************/
+
+static void Input_Mmap_Scan( _Sagan_Input_Mmap_Worker *worker, _Sagan_Input_Chunk *chunk )
+{
+
+    _Sagan_Input_Mmap *mmap_input = worker->mmap;
+    const char *base = mmap_input->map + chunk->offset;
+    const char *line = base;
+    const char *end = base + chunk->length;
+    const char *newline;
+
+    uint32_t *offset = NULL;
+    int *owner = NULL;
+    uint32_t *next = NULL;
+    uint32_t count = 1;
+    uint32_t used = 0;
+    uint32_t i;
+
+    /* Upper bound on the lines */
+
+    for ( newline = base; ( newline = memchr(newline, '\n', end - newline) ) != NULL; newline++ )
+        {
+            count++;
+        }
+
+    offset = malloc(count * sizeof(uint32_t));
+    owner = malloc(count * sizeof(int));
+    next = malloc(mmap_input->workers * sizeof(uint32_t));
+    chunk->lines = malloc(count * sizeof(uint32_t));
+    chunk->first = calloc(mmap_input->workers + 1, sizeof(uint32_t));
+
+    if ( offset == NULL || owner == NULL || next == NULL || chunk->lines == NULL || chunk->first == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input lines. Abort!", __FILE__, __LINE__);
+        }
+
+    while ( line < end )
+        {
+
+            newline = memchr(line, '\n', end - line);
+
+            if ( newline == NULL )
+                {
+                    newline = end;
+                }
+
+            /* Blank lines aren't events */
+
+            if ( newline != line )
+                {
+                    offset[used] = line - base;
+                    owner[used] = Input_Mmap_Partition(&worker->input, line, newline - line, mmap_input->workers);
+                    chunk->first[owner[used] + 1]++;
+                    used++;
+                }
+
+            line = newline + 1;
+        }
+
+    for ( i = 0; i < (uint32_t)mmap_input->workers; i++ )
+        {
+            chunk->first[i + 1] += chunk->first[i];
+            next[i] = chunk->first[i];
+        }
+
+    /* Still in file order within each worker's lines */
+
+    for ( i = 0; i < used; i++ )
+        {
+            chunk->lines[next[owner[i]]++] = offset[i];
+        }
+
+    free(offset);
+    free(owner);
+    free(next);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Chunk_Done - With -O,  hands this worker's alerts for the
+ * chunk over and writes out every chunk that is now complete,  in order.
+ ****************************************************************************/
+
+static void Input_Mmap_Chunk_Done( _Sagan_Input_Mmap_Worker *worker, _Sagan_Input_Chunk *chunk )
+{
+
+    _Sagan_Input_Mmap *mmap_input = worker->mmap;
+    _Sagan_Input_Chunk *ready;
+    _Sagan_Input_Alert *alert;
+    _Sagan_Input_Alert **sorted = NULL;
+    size_t count;
+    size_t i;
+
+    if ( config->parallel_ordered == false )
+        {
+            return;
+        }
+
+    pthread_mutex_lock(&mmap_input->mutex);
+
+    if ( worker->alerts != NULL )
+        {
+            *worker->alerts_tail = chunk->alerts;
+            chunk->alerts = worker->alerts;
+        }
+
+    worker->alerts = NULL;
+    worker->alerts_tail = &worker->alerts;
+
+    chunk->pending--;
+
+    while ( mmap_input->next_output < mmap_input->chunk_count && mmap_input->chunks[mmap_input->next_output].pending == 0 )
+        {
+
+            ready = &mmap_input->chunks[mmap_input->next_output];
+
+            for ( count = 0, alert = ready->alerts; alert != NULL; alert = alert->next )
+                {
+                    count++;
+                }
+
+            if ( count > 0 )
+                {
+
+                    sorted = realloc(sorted, count * sizeof(_Sagan_Input_Alert *));
+
+                    if ( sorted == NULL )
+                        {
+                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for ordered alerts. Abort!", __FILE__, __LINE__);
+                        }
+
+                    for ( i = 0, alert = ready->alerts; alert != NULL; alert = alert->next )
+                        {
+                            sorted[i++] = alert;
+                        }
+
+                    qsort(sorted, count, sizeof(_Sagan_Input_Alert *), Input_Mmap_Alert_Compare);
+
+                    for ( i = 0; i < count; i++ )
+                        {
+                            Output(&sorted[i]->event);
+                            Input_Mmap_Alert_Free(sorted[i]);
+                        }
+                }
+
+            ready->alerts = NULL;
+            mmap_input->next_output++;
+        }
+
+    pthread_mutex_unlock(&mmap_input->mutex);
+
+    free(sorted);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Defer - Called by Send_Alert().  On a -P/-O worker the alert is
+ * copied and held for Input_Mmap_Chunk_Done(),  and true is returned.
+ * Anywhere else it returns false and the alert is written as usual.
+ ****************************************************************************/
+
+sbool Input_Mmap_Defer( _Sagan_Event *event )
+{
+
+    _Sagan_Input_Alert *alert;
+    char **field[INPUT_MMAP_ALERT_STRINGS];
+    int i;
+
+    if ( mmap_worker == NULL )
+        {
+            return(false);
+        }
+
+    alert = malloc(sizeof(_Sagan_Input_Alert));
+
+    if ( alert == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for a held alert. Abort!", __FILE__, __LINE__);
+        }
+
+    /* The event points at the worker's buffers (and the stack),  so every
+     * string has to be copied */
+
+    memcpy(&alert->event, event, sizeof(_Sagan_Event));
+    Input_Mmap_Alert_Strings(&alert->event, field);
+
+    for ( i = 0; i < INPUT_MMAP_ALERT_STRINGS; i++ )
+        {
+
+            if ( *field[i] != NULL )
+                {
+
+                    *field[i] = strdup(*field[i]);
+
+                    if ( *field[i] == NULL )
+                        {
+                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for a held alert. Abort!", __FILE__, __LINE__);
+                        }
+                }
+        }
+
+#ifdef HAVE_LIBLOGNORM
+    if ( alert->event.json_normalize != NULL )
+        {
+            json_object_get(alert->event.json_normalize);
+        }
+#endif
+
+    alert->offset = mmap_worker->offset;
+    alert->seq = mmap_worker->seq++;
+    alert->next = NULL;
+
+    *mmap_worker->alerts_tail = alert;
+    mmap_worker->alerts_tail = &alert->next;
+
+    return(true);
+}
+
+/****************************************************************************
+ * Input_Mmap_Holding - True while a file is being run with -O.  Its held
+ * alerts are written out later,  by rule number,  so the rules (and the
+ * rule pool they point into) can't be reloaded under them.
+ ****************************************************************************/
+
+sbool Input_Mmap_Holding( void )
+{
+    return( __atomic_load_n(&mmap_ordered, __ATOMIC_SEQ_CST) > 0 );
+}
+
+/****************************************************************************
+ * Input_Mmap_Alert_Strings - Every string an _Sagan_Event points to
+ ****************************************************************************/
+
+static void Input_Mmap_Alert_Strings( _Sagan_Event *event, char ***field )
+{
+
+    field[0] = &event->ip_src;
+    field[1] = &event->ip_dst;
+    field[2] = &event->selector;
+    field[3] = &event->fpri;
+    field[4] = &event->f_msg;
+    field[5] = &event->time;
+    field[6] = &event->date;
+    field[7] = &event->priority;
+    field[8] = &event->host;
+    field[9] = &event->facility;
+    field[10] = &event->level;
+    field[11] = &event->tag;
+    field[12] = &event->program;
+    field[13] = &event->message;
+    field[14] = &event->sid;
+    field[15] = &event->rev;
+    field[16] = &event->class;
+    field[17] = &event->normalize_http_uri;
+    field[18] = &event->normalize_http_hostname;
+
+}
+
+static void Input_Mmap_Alert_Free( _Sagan_Input_Alert *alert )
+{
+
+    char **field[INPUT_MMAP_ALERT_STRINGS];
+    int i;
+
+    Input_Mmap_Alert_Strings(&alert->event, field);
+
+    for ( i = 0; i < INPUT_MMAP_ALERT_STRINGS; i++ )
+        {
+            free(*field[i]);
+        }
+
+#ifdef HAVE_LIBLOGNORM
+    if ( alert->event.json_normalize != NULL )
+        {
+            json_object_put(alert->event.json_normalize);
+        }
+#endif
+
+    free(alert);
+
+}
+
+/****************************************************************************
+ * Input_Mmap_Alert_Compare - qsort() by line,  then by order within a line
+ ****************************************************************************/
+
+static int Input_Mmap_Alert_Compare( const void *a, const void *b )
+{
+
+    const _Sagan_Input_Alert *alert_a = *(const _Sagan_Input_Alert **)a;
+    const _Sagan_Input_Alert *alert_b = *(const _Sagan_Input_Alert **)b;
+
+    if ( alert_a->offset != alert_b->offset )
+        {
+            return( alert_a->offset < alert_b->offset ? -1 : 1 );
+        }
+
+    if ( alert_a->seq != alert_b->seq )
+        {
+            return( alert_a->seq < alert_b->seq ? -1 : 1 );
+        }
+
+    return(0);
+}
+
+/****************************************************************************
+ * Input_Mmap_Partition - Which worker a line belongs to,  by its syslog
+ * host.  For the Sagan format the host is the first field,  anything else
+ * has to be parsed to find it.
+ ****************************************************************************/
+
+static int Input_Mmap_Partition( _Sagan_Input *input, const char *line, size_t length, int workers )
+{
+
+    _Sagan_Input_Fields fields;
+    const char *host = line;
+    const char *end;
+    uint32_t hash = 5381;
+
+    if ( input->format == INPUT_FORMAT_SAGAN )
+        {
+            end = memchr(line, '|', length);
+            end = end != NULL ? end : line + length;
+        }
+    else
+        {
+
+            Input_Parse(input, line, length, &fields);
+
+            if ( fields.value[INPUT_FIELD_HOST] == NULL )
+                {
+                    return(0);
+                }
+
+            host = fields.value[INPUT_FIELD_HOST];
+            end = host + fields.length[INPUT_FIELD_HOST];
+        }
+
+    /* Djb2_Hash(),  without needing a copy of the host */
+
+    while ( host < end )
+        {
+            hash = ((hash << 5) + hash) + (unsigned char)*host++;
+        }
+
+    return( hash % workers );
+}
+
+/****************************************************************************
+ * Input_Mmap_Stateful - How many rules keep state between events (after,
+ * threshold,  xbits) or can load rules that do (dynamic rules)
+ ****************************************************************************/
+
+static int Input_Mmap_Stateful( void )
+{
+
+    int count = 0;
+    int i;
+
+    for ( i = 0; i < counters->rulecount; i++ )
+        {
+            if ( rulestruct[i].after_method != 0 || rulestruct[i].threshold_type != 0 ||
+                    rulestruct[i].xbit_flag || rulestruct[i].type == DYNAMIC_RULE )
+                {
+                    count++;
+                }
+        }
+
+    return(count);
+}
@@ -0,0 +1,105 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Work handed to a -P/--parallel worker at a time.  Rounded up to the
+ * end of a line */
+
+#define INPUT_MMAP_CHUNK	( 4 * 1024 * 1024 )
+
+#define INPUT_MMAP_ALERT_STRINGS	19	/* char * members of _Sagan_Event */
+
+/* An alert held back so output can be written in input order (-O) */
+
+typedef struct _Sagan_Input_Alert _Sagan_Input_Alert;
+struct _Sagan_Input_Alert
+{
+    _Sagan_Event event;
+    uint64_t offset;			/* Of the line that fired */
+    uint64_t seq;			/* Order within the line */
+    _Sagan_Input_Alert *next;
+};
+
+typedef struct _Sagan_Input_Chunk _Sagan_Input_Chunk;
+struct _Sagan_Input_Chunk
+{
+    size_t offset;
+    size_t length;
+    int pending;			/* Workers that haven't finished this chunk */
+    _Sagan_Input_Alert *alerts;
+
+    /* By host,  the chunk is scanned once and its lines grouped by worker.
+     * Worker w runs lines[first[w]] to lines[first[w+1] - 1] */
+
+    sbool scanned;
+    uint32_t *lines;			/* Offsets into the chunk */
+    uint32_t *first;
+    int unread;				/* Workers that haven't run their lines */
+};
+
+typedef struct _Sagan_Input_Mmap _Sagan_Input_Mmap;
+struct _Sagan_Input_Mmap
+{
+
+    _Sagan_Input *input;
+    const char *map;
+    size_t size;
+
+    _Sagan_Input_Chunk *chunks;
+    int chunk_count;
+    int next_chunk;			/* Next chunk to hand out (chunk mode) */
+    int next_output;			/* First chunk not yet written (-O) */
+    int next_scan;			/* Next chunk to group by host */
+    int workers;
+    sbool by_host;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t scanned;		/* A chunk has been grouped by host */
+
+};
+
+typedef struct _Sagan_Input_Mmap_Worker _Sagan_Input_Mmap_Worker;
+struct _Sagan_Input_Mmap_Worker
+{
+
+    _Sagan_Input_Mmap *mmap;
+    int id;
+
+    _Sagan_Input input;			/* Private copy so counters aren't shared */
+
+    _Sagan_Input_Alert *alerts;		/* Held for the current chunk (-O) */
+    _Sagan_Input_Alert **alerts_tail;
+    uint64_t offset;			/* Line being processed */
+    uint64_t seq;
+
+    int batch;				/* Lines since Processor_Work_Start() */
+
+};
+
+void Input_Mmap_Reader( _Sagan_Input * );
+sbool Input_Mmap_Defer( _Sagan_Event * );
+sbool Input_Mmap_Holding( void );
@@ -0,0 +1,658 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* input-net.c
+ *
+ * Receives syslog directly over UDP and TCP,  so rsyslog and a FIFO don't
+ * have to sit in front of Sagan.  UDP datagrams are pulled in a batch at
+ * a time with recvmmsg().  TCP connections are multiplexed with epoll and
+ * framed either by octet counting ("LEN SP MSG") or by a newline (RFC 6587).
+ * Either way,  messages are handed to Input_Enqueue() as views into the
+ * receive buffer.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#ifdef HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "input.h"
+#include "input-net.h"
+#include "lockfile.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+
+struct _Sagan_Input *SaganInputs;
+
+#ifdef HAVE_SYS_EPOLL_H
+
+static void Input_TCP_Accept( _Sagan_Input *, int );
+static sbool Input_TCP_Read( _Sagan_Input *, _Sagan_Input_Conn * );
+static void Input_TCP_Frames( _Sagan_Input *, _Sagan_Input_Conn *, sbool );
+static void Input_TCP_Close( int, _Sagan_Input_Conn * );
+
+#endif
+
+/****************************************************************************
+ * Input_Listen - Opens the sockets for all UDP/TCP inputs.  This is done
+ * before Sagan drops privileges so the standard (514) port can be used.
+ ****************************************************************************/
+
+void Input_Listen( void )
+{
+
+    _Sagan_Input *input;
+
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    char port[6] = { 0 };
+    int on = 1;
+    int error;
+    int rc;
+    int i;
+
+    for (i = 0; i < counters->input_count; i++)
+        {
+
+            input = &SaganInputs[i];
+
+            if ( input->type != INPUT_TYPE_UDP && input->type != INPUT_TYPE_TCP )
+                {
+                    continue;
+                }
+
+#ifndef HAVE_SYS_EPOLL_H
+
+            if ( input->type == INPUT_TYPE_TCP )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] TCP input %s requires epoll,  which this system doesn't have. Abort!", __FILE__, __LINE__, input->path);
+                }
+
+#endif
+
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = input->type == INPUT_TYPE_UDP ? SOCK_DGRAM : SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+            snprintf(port, sizeof(port), "%d", input->port);
+
+            rc = getaddrinfo(input->address, port, &hints, &result);
+
+            if ( rc != 0 )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Invalid address for %s input %s: %s. Abort!", __FILE__, __LINE__, Input_Type_Name(input->type), input->path, gai_strerror(rc));
+                }
+
+            if (( input->fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol) ) == -1 )
+                {
+                    error = errno;
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Cannot create socket for %s input %s: %s. Abort!", __FILE__, __LINE__, Input_Type_Name(input->type), input->path, strerror(error));
+                }
+
+            setsockopt(input->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+            if ( input->socket_buffer > 0 &&
+                    setsockopt(input->fd, SOL_SOCKET, SO_RCVBUF, &input->socket_buffer, sizeof(input->socket_buffer)) == -1 )
+                {
+                    Sagan_Log(S_WARN, "Could not set the receive buffer of %s input %s to %d bytes: %s", Input_Type_Name(input->type), input->path, input->socket_buffer, strerror(errno));
+                }
+
+            if ( bind(input->fd, result->ai_addr, result->ai_addrlen) == -1 )
+                {
+                    error = errno;
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Cannot bind %s input %s: %s. Abort!", __FILE__, __LINE__, Input_Type_Name(input->type), input->path, strerror(error));
+                }
+
+            freeaddrinfo(result);
+
+            if ( input->type == INPUT_TYPE_TCP )
+                {
+
+                    if ( listen(input->fd, SOMAXCONN) == -1 )
+                        {
+                            error = errno;
+                            Remove_Lock_File();
+                            Sagan_Log(S_ERROR, "[%s, line %d] Cannot listen on TCP input %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+                        }
+
+                    fcntl(input->fd, F_SETFL, fcntl(input->fd, F_GETFL) | O_NONBLOCK);
+                }
+
+            Sagan_Log(S_NORMAL, "Listening for syslog on %s %s.", Input_Type_Name(input->type), input->path);
+
+        }
+
+}
+
+/****************************************************************************
+ * Input_UDP_Reader - One datagram is one message.  recvmmsg() fills up to
+ * a batch worth of datagrams per system call,  each into its own
+ * MAX_SYSLOGMSG slice of the input buffer.  Never returns.
+ ****************************************************************************/
+
+void Input_UDP_Reader( _Sagan_Input *input )
+{
+
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_storage *from;
+    char (*from_ip)[MAXIP];
+
+    const char *datagram;
+    size_t length;
+    int received;
+    int count;
+    int error;
+    int i;
+
+    SetThreadName("SaganUDP");
+
+    input->buffer_size = config->sagan_queue_batch * MAX_SYSLOGMSG;
+    input->buffer = malloc(input->buffer_size);
+    input->pending = malloc(config->sagan_queue_batch * sizeof(_Sagan_Field_View));
+
+    input->peer = calloc(config->sagan_queue_batch, sizeof(char *));
+
+    msgs = calloc(config->sagan_queue_batch, sizeof(struct mmsghdr));
+    iov = calloc(config->sagan_queue_batch, sizeof(struct iovec));
+    from = calloc(config->sagan_queue_batch, sizeof(struct sockaddr_storage));
+    from_ip = calloc(config->sagan_queue_batch, MAXIP);
+
+    if ( input->buffer == NULL || input->pending == NULL || input->peer == NULL ||
+            msgs == NULL || iov == NULL || from == NULL || from_ip == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for UDP input. Abort!", __FILE__, __LINE__);
+        }
+
+    for (i = 0; i < config->sagan_queue_batch; i++)
+        {
+            iov[i].iov_base = input->buffer + ( i * MAX_SYSLOGMSG );
+            iov[i].iov_len = MAX_SYSLOGMSG;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+        }
+
+    for (;;)
+        {
+
+            for (i = 0; i < config->sagan_queue_batch; i++)
+                {
+                    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+                }
+
+#ifdef HAVE_RECVMMSG
+
+            received = recvmmsg(input->fd, msgs, config->sagan_queue_batch, MSG_WAITFORONE, NULL);
+
+#else
+
+            received = recvfrom(input->fd, iov[0].iov_base, iov[0].iov_len, 0, (struct sockaddr *)&from[0], &msgs[0].msg_hdr.msg_namelen);
+
+            if ( received >= 0 )
+                {
+                    msgs[0].msg_len = received;
+                    received = 1;
+                }
+
+#endif
+
+            if ( received == -1 )
+                {
+
+                    if ( errno == EINTR )
+                        {
+                            continue;
+                        }
+
+                    error = errno;
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Error receiving from UDP input %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+                }
+
+            count = 0;
+
+            for (i = 0; i < received; i++)
+                {
+
+                    datagram = iov[i].iov_base;
+                    length = msgs[i].msg_len;
+
+                    /* Senders don't agree on whether a datagram ends with a newline (or NUL) */
+
+                    while ( length > 0 && ( datagram[length-1] == '\n' || datagram[length-1] == '\r' || datagram[length-1] == '\0' ) )
+                        {
+                            length--;
+                        }
+
+                    if ( length == 0 )
+                        {
+                            continue;
+                        }
+
+                    /* Only raw syslog needs to know who sent it */
+
+                    if ( input->format != INPUT_FORMAT_SAGAN )
+                        {
+                            from_ip[i][0] = '\0';
+                            getnameinfo((struct sockaddr *)&from[i], msgs[i].msg_hdr.msg_namelen, from_ip[i], MAXIP, NULL, 0, NI_NUMERICHOST);
+                            input->peer[count] = from_ip[i];
+                        }
+
+                    input->pending[count].offset = datagram - input->buffer;
+                    input->pending[count].length = length;
+                    count++;
+                }
+
+            if ( count > 0 )
+                {
+                    Input_Enqueue(input, input->buffer, input->pending, input->format != INPUT_FORMAT_SAGAN ? input->peer : NULL, count);
+                }
+
+        }
+
+}
+
+/****************************************************************************
+ * Input_TCP_Reader - Accepts connections on a TCP input and reads from
+ * all of them with one epoll set.  Never returns.
+ ****************************************************************************/
+
+void Input_TCP_Reader( _Sagan_Input *input )
+{
+
+#ifdef HAVE_SYS_EPOLL_H
+
+    struct epoll_event event;
+    struct epoll_event events[INPUT_TCP_MAX_EVENTS];
+
+    _Sagan_Input_Conn *conn;
+    int epoll_fd;
+    int ready;
+    int error;
+    int i;
+
+    SetThreadName("SaganTCP");
+
+    input->pending = malloc(config->sagan_queue_batch * sizeof(_Sagan_Field_View));
+    input->peer = calloc(config->sagan_queue_batch, sizeof(char *));
+
+    if ( input->pending == NULL || input->peer == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for TCP input. Abort!", __FILE__, __LINE__);
+        }
+
+    if (( epoll_fd = epoll_create1(0) ) == -1 )
+        {
+            error = errno;
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] epoll_create1() failed for TCP input %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+        }
+
+    /* The listening socket is the only one without a connection */
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+
+    if ( epoll_ctl(epoll_fd, EPOLL_CTL_ADD, input->fd, &event) == -1 )
+        {
+            error = errno;
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] epoll_ctl() failed for TCP input %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+        }
+
+    for (;;)
+        {
+
+            ready = epoll_wait(epoll_fd, events, INPUT_TCP_MAX_EVENTS, -1);
+
+            if ( ready == -1 )
+                {
+
+                    if ( errno == EINTR )
+                        {
+                            continue;
+                        }
+
+                    error = errno;
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] epoll_wait() failed for TCP input %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+                }
+
+            for (i = 0; i < ready; i++)
+                {
+
+                    if ( events[i].data.ptr == NULL )
+                        {
+                            Input_TCP_Accept(input, epoll_fd);
+                            continue;
+                        }
+
+                    conn = events[i].data.ptr;
+
+                    if ( Input_TCP_Read(input, conn) == false )
+                        {
+                            Input_TCP_Close(epoll_fd, conn);
+                        }
+                }
+
+        }
+
+#endif
+
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/****************************************************************************
+ * Input_TCP_Accept - Takes every pending connection and adds it to the
+ * epoll set.
+ ****************************************************************************/
+
+static void Input_TCP_Accept( _Sagan_Input *input, int epoll_fd )
+{
+
+    struct epoll_event event;
+    struct sockaddr_storage from;
+    socklen_t from_len = sizeof(from);
+    _Sagan_Input_Conn *conn;
+    int fd;
+
+    while (( fd = accept(input->fd, (struct sockaddr *)&from, &from_len) ) != -1 )
+        {
+
+            conn = calloc(1, sizeof(_Sagan_Input_Conn));
+
+            if ( conn == NULL || ( conn->buffer = malloc(INPUT_TCP_BUFFER) ) == NULL )
+                {
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for TCP connection. Abort!", __FILE__, __LINE__);
+                }
+
+            conn->fd = fd;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+            getnameinfo((struct sockaddr *)&from, from_len, conn->peer, sizeof(conn->peer), NULL, 0, NI_NUMERICHOST);
+            from_len = sizeof(from);
+
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.ptr = conn;
+
+            if ( epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1 )
+                {
+                    Sagan_Log(S_WARN, "[%s, line %d] epoll_ctl() failed for a connection on TCP input %s: %s", __FILE__, __LINE__, input->path, strerror(errno));
+                    close(fd);
+                    free(conn->buffer);
+                    free(conn);
+                }
+
+        }
+
+    if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED )
+        {
+            Sagan_Log(S_WARN, "[%s, line %d] accept() failed on TCP input %s: %s", __FILE__, __LINE__, input->path, strerror(errno));
+        }
+
+}
+
+/****************************************************************************
+ * Input_TCP_Read - Reads what is waiting on a connection and processes
+ * the complete frames.  Returns false when the connection should be
+ * closed.
+ ****************************************************************************/
+
+static sbool Input_TCP_Read( _Sagan_Input *input, _Sagan_Input_Conn *conn )
+{
+
+    ssize_t bytes;
+
+    bytes = read(conn->fd, conn->buffer + conn->buffer_len, INPUT_TCP_BUFFER - conn->buffer_len);
+
+    if ( bytes == -1 )
+        {
+            return( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR );
+        }
+
+    /* Sender has gone away.  A newline framed message may be missing
+     * its newline */
+
+    if ( bytes == 0 )
+        {
+            Input_TCP_Frames(input, conn, true);
+            return(false);
+        }
+
+    conn->buffer_len += bytes;
+
+    Input_TCP_Frames(input, conn, false);
+
+    return(true);
+
+}
+
+/****************************************************************************
+ * Input_TCP_Frames - Splits a connection's buffer into messages and hands
+ * them to the work queue.  A frame starting with "digits SP" is octet
+ * counted,  anything else runs to the next newline.  A message that can
+ * never fit in the buffer is truncated and the rest of it thrown away.
+ ****************************************************************************/
+
+static void Input_TCP_Frames( _Sagan_Input *input, _Sagan_Input_Conn *conn, sbool closing )
+{
+
+    char *start = conn->buffer;
+    char *end = conn->buffer + conn->buffer_len;
+    char *frame_start;
+    char *p;
+
+    sbool full = ( conn->buffer_len == INPUT_TCP_BUFFER );
+    size_t frame;
+    size_t length;
+    int count = 0;
+
+    while ( start < end )
+        {
+
+            /* Still throwing away the tail of an over sized message */
+
+            if ( conn->skip > 0 )
+                {
+                    length = (size_t)(end - start) < conn->skip ? (size_t)(end - start) : conn->skip;
+                    start += length;
+                    conn->skip -= length;
+                    continue;
+                }
+
+            if ( conn->skip_line == true )
+                {
+
+                    if (( p = memchr(start, '\n', end - start) ) == NULL )
+                        {
+                            start = end;
+                            break;
+                        }
+
+                    start = p + 1;
+                    conn->skip_line = false;
+                    continue;
+                }
+
+            /* Octet counting? */
+
+            frame = 0;
+            frame_start = NULL;
+
+            if ( isdigit((unsigned char)*start) )
+                {
+
+                    for ( p = start; p < end && p - start < INPUT_TCP_MAX_OCTET_DIGITS && isdigit((unsigned char)*p); p++ )
+                        {
+                            frame = ( frame * 10 ) + ( *p - '0' );
+                        }
+
+                    if ( p == end && closing == false )
+                        {
+                            break;		/* Need the rest of the header */
+                        }
+
+                    if ( p < end && *p == ' ' )
+                        {
+                            frame_start = p + 1;
+                        }
+                }
+
+            if ( frame_start != NULL )
+                {
+
+                    if ( frame <= (size_t)(end - frame_start) )
+                        {
+                            length = frame;
+                        }
+
+                    else if ( full == true && start == conn->buffer )
+                        {
+                            length = end - frame_start;
+                            conn->skip = frame - length;
+                        }
+
+                    else
+                        {
+                            break;		/* Wait for the rest of the frame */
+                        }
+
+                    p = frame_start + length;
+
+                }
+            else
+                {
+
+                    frame_start = start;
+
+                    if (( p = memchr(start, '\n', end - start) ) == NULL )
+                        {
+
+                            if ( closing == false && ( full == false || start != conn->buffer ) )
+                                {
+                                    break;
+                                }
+
+                            conn->skip_line = ( closing == false );
+                            p = end;
+                        }
+
+                    length = p - start;
+
+                    if ( p < end )
+                        {
+                            p++;
+                        }
+
+                    if ( length > 0 && frame_start[length-1] == '\r' )
+                        {
+                            length--;
+                        }
+
+                }
+
+            start = p;
+
+            if ( length == 0 )
+                {
+                    continue;
+                }
+
+            input->pending[count].offset = frame_start - conn->buffer;
+            input->pending[count].length = length;
+            input->peer[count] = conn->peer;
+            count++;
+
+            if ( count == config->sagan_queue_batch )
+                {
+                    Input_Enqueue(input, conn->buffer, input->pending, input->peer, count);
+                    count = 0;
+                }
+
+        }
+
+    if ( count > 0 )
+        {
+            Input_Enqueue(input, conn->buffer, input->pending, input->peer, count);
+        }
+
+    /* Keep the partial frame (if any) for the next read() */
+
+    conn->buffer_len = end - start;
+
+    if ( conn->buffer_len > 0 && start != conn->buffer )
+        {
+            memmove(conn->buffer, start, conn->buffer_len);
+        }
+
+}
+
+/****************************************************************************
+ * Input_TCP_Close - Drops a connection
+ ****************************************************************************/
+
+static void Input_TCP_Close( int epoll_fd, _Sagan_Input_Conn *conn )
+{
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+
+    free(conn->buffer);
+    free(conn);
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#define INPUT_TCP_BUFFER	( MAX_SYSLOGMSG * 2 )	/* Per connection */
+#define INPUT_TCP_MAX_EVENTS	64			/* epoll_wait() batch */
+
+/* Octet counted frames have at most this many digits ahead of the space */
+
+#define INPUT_TCP_MAX_OCTET_DIGITS	10
+
+typedef struct _Sagan_Input_Conn _Sagan_Input_Conn;
+struct _Sagan_Input_Conn
+{
+
+    int		fd;
+    char	peer[MAXIP];		/* Sender's address */
+
+    char	*buffer;
+    size_t	buffer_len;
+
+    size_t	skip;			/* Bytes left of an octet counted frame too big for the buffer */
+    sbool	skip_line;		/* Throwing away the rest of an over sized line */
+
+};
+
+void Input_Listen( void );
+void Input_UDP_Reader( _Sagan_Input * );
+void Input_TCP_Reader( _Sagan_Input * );
@@ -0,0 +1,558 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* input-parse.c
+ *
+ * Finds the fields of a log line.  Sagan's own "|" delimited format comes
+ * from the rsyslog/syslog-ng template.  Raw RFC 3164 ("BSD") and RFC 5424
+ * syslog are parsed in a single pass,  so logs from other collectors don't
+ * need to be reformatted first.  Nothing is copied here.  Fields point into
+ * the line,  or at a few values built from the PRI.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "input.h"
+#include "input-parse.h"
+
+/* Names as rsyslog's "-text" properties give them,  so rules written
+ * against the template still match */
+
+static const char *input_facility_name[24] =
+{
+    "kern", "user", "mail", "daemon", "auth", "syslog", "lpr", "news",
+    "uucp", "cron", "authpriv", "ftp", "ntp", "audit", "alert", "clock",
+    "local0", "local1", "local2", "local3", "local4", "local5", "local6", "local7"
+};
+
+static const char *input_level_name[8] =
+{
+    "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+};
+
+static const char *input_month_name[12] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static const char *input_format_name[] =
+{
+    "sagan", "rfc3164", "rfc5424", "auto"
+};
+
+static int Input_Parse_Sagan( const char *, const char *, _Sagan_Input_Fields * );
+static void Input_Parse_RFC3164( _Sagan_Input *, const char *, const char *, _Sagan_Input_Fields * );
+static void Input_Parse_RFC5424( const char *, const char *, _Sagan_Input_Fields * );
+static int Input_Parse_PRI( const char **, const char * );
+static void Input_Parse_Set_PRI( _Sagan_Input_Fields *, int );
+static sbool Input_Parse_RFC3339( const char **, const char *, _Sagan_Input_Fields * );
+static const char *Input_Parse_Token( const char *, const char *, const char **, size_t * );
+static const char *Input_Parse_Skip_SD( const char *, const char * );
+
+static inline void Input_Field( _Sagan_Input_Fields *fields, int field, const char *value, size_t length )
+{
+    fields->value[field] = value;
+    fields->length[field] = length;
+}
+
+/****************************************************************************
+ * Input_Parse_Format - Turns a "format" name from sagan.yaml into an
+ * INPUT_FORMAT_*.  Returns -1 if it isn't one we know.
+ ****************************************************************************/
+
+int Input_Parse_Format( const char *name )
+{
+
+    int i;
+
+    for (i = 0; i < sizeof(input_format_name) / sizeof(input_format_name[0]); i++)
+        {
+            if (!strcasecmp(name, input_format_name[i]))
+                {
+                    return(i);
+                }
+        }
+
+    return(-1);
+}
+
+/****************************************************************************
+ * Input_Parse - Finds the fields of a line in the input's format
+ ****************************************************************************/
+
+void Input_Parse( _Sagan_Input *input, const char *line, size_t length, _Sagan_Input_Fields *fields )
+{
+
+    const char *end = line + length;
+    const char *c;
+
+    memset(fields->value, 0, sizeof(fields->value));
+
+    switch ( input->format )
+        {
+
+        case INPUT_FORMAT_RFC3164:
+            Input_Parse_RFC3164(input, line, end, fields);
+            break;
+
+        case INPUT_FORMAT_RFC5424:
+            Input_Parse_RFC5424(line, end, fields);
+            break;
+
+        case INPUT_FORMAT_AUTO:
+
+            /* "<PRI>1 " is RFC 5424.  Any other "<PRI>" is RFC 3164 */
+
+            if ( line < end && *line == '<' )
+                {
+
+                    c = memchr(line, '>', end - line < 5 ? end - line : 5);
+
+                    if ( c != NULL && end - c > 2 && isdigit((unsigned char)c[1]) && c[2] == ' ' )
+                        {
+                            Input_Parse_RFC5424(line, end, fields);
+                        }
+                    else
+                        {
+                            Input_Parse_RFC3164(input, line, end, fields);
+                        }
+
+                    break;
+                }
+
+            /* Otherwise,  it's ours if all the "|" are there */
+
+            if ( Input_Parse_Sagan(line, end, fields) == INPUT_FIELD_COUNT )
+                {
+                    break;
+                }
+
+            memset(fields->value, 0, sizeof(fields->value));
+            Input_Parse_RFC3164(input, line, end, fields);
+            break;
+
+        default:
+            Input_Parse_Sagan(line, end, fields);
+            break;
+
+        }
+
+}
+
+/****************************************************************************
+ * Input_Parse_Sagan - Splits a Sagan formatted line.  The message is
+ * everything after the 8th "|",  so it may contain "|" itself.  Returns
+ * the number of fields found.
+ ****************************************************************************/
+
+static int Input_Parse_Sagan( const char *line, const char *end, _Sagan_Input_Fields *fields )
+{
+
+    const char *start = line;
+    const char *pipe;
+    int count = 0;
+
+    while ( count < INPUT_FIELD_MESSAGE )
+        {
+
+            pipe = memchr(start, '|', end - start);
+
+            if ( pipe == NULL )
+                {
+                    break;
+                }
+
+            Input_Field(fields, count, start, pipe - start);
+            count++;
+
+            start = pipe + 1;
+        }
+
+    Input_Field(fields, count, start, end - start);
+    count++;
+
+    return(count);
+}
+
+/****************************************************************************
+ * Input_Parse_RFC3164 - "<PRI>Mmm dd hh:mm:ss HOSTNAME TAG[PID]: MSG"
+ *
+ * A line without a PRI gets the default (RFC 3164,  4.3.3).  Locally
+ * generated messages may not have a HOSTNAME.  rsyslog's "high precision"
+ * RFC 3339 timestamp is accepted in place of the BSD one.
+ ****************************************************************************/
+
+static void Input_Parse_RFC3164( _Sagan_Input *input, const char *p, const char *end, _Sagan_Input_Fields *fields )
+{
+
+    const char *token;
+    const char *c;
+    size_t length;
+
+    int pri = INPUT_DEFAULT_PRI;
+    int month;
+    int year;
+    int day;
+
+    if ( p < end && *p == '<' )
+        {
+            pri = Input_Parse_PRI(&p, end);
+        }
+
+    if ( pri >= 0 )
+        {
+            Input_Parse_Set_PRI(fields, pri);
+        }
+
+    /* TIMESTAMP */
+
+    if ( end - p >= 15 && p[3] == ' ' && p[6] == ' ' && p[9] == ':' && p[12] == ':' &&
+            isdigit((unsigned char)p[5]) && ( p[4] == ' ' || isdigit((unsigned char)p[4]) ) )
+        {
+
+            for (month = 0; month < 12; month++)
+                {
+                    if (!memcmp(p, input_month_name[month], 3))
+                        {
+                            break;
+                        }
+                }
+
+            if ( month < 12 )
+                {
+
+                    month++;
+                    day = ( p[4] == ' ' ? 0 : ( p[4] - '0' ) * 10 ) + ( p[5] - '0' );
+
+                    /* There's no year.  A December message read in January is from last year */
+
+                    year = month > input->month + 1 ? input->year - 1 : input->year;
+
+                    /* Keep to YYYY-MM-DD so it fits in 'date' */
+
+                    if ( year < 0 || year > 9999 )
+                        {
+                            year = 0;
+                        }
+
+                    if ( day < 0 || day > 31 )
+                        {
+                            day = 0;
+                        }
+
+                    snprintf(fields->date, sizeof(fields->date), "%04d-%02d-%02d", year, month, day);
+
+                    Input_Field(fields, INPUT_FIELD_DATE, fields->date, 10);
+                    Input_Field(fields, INPUT_FIELD_TIME, p + 7, 8);
+
+                    p += 15;
+
+                    if ( p < end && *p == ' ' )
+                        {
+                            p++;
+                        }
+                }
+        }
+
+    else
+        {
+            Input_Parse_RFC3339(&p, end, fields);
+        }
+
+    /* HOSTNAME.  If this looks like the TAG,  there isn't one */
+
+    c = Input_Parse_Token(p, end, &token, &length);
+
+    if ( length > 0 && c < end && token[length-1] != ':' && memchr(token, '[', length) == NULL )
+        {
+            Input_Field(fields, INPUT_FIELD_HOST, token, length);
+            p = c;
+        }
+
+    /* TAG.  The program name,  maybe a "[PID]",  then a ":" */
+
+    for ( c = p; c < end && *c != '[' && *c != ':' && *c != ' '; c++ );
+
+    if ( c > p )
+        {
+            Input_Field(fields, INPUT_FIELD_PROGRAM, p, c - p);
+        }
+
+    if ( c < end && *c == '[' )
+        {
+            c = memchr(c, ']', end - c);
+            c = c != NULL ? c + 1 : end;
+        }
+
+    if ( c < end && *c == ':' )
+        {
+            c++;
+        }
+
+    if ( c < end && *c == ' ' )
+        {
+            c++;
+        }
+
+    /* MSG */
+
+    if ( c < end )
+        {
+            Input_Field(fields, INPUT_FIELD_MESSAGE, c, end - c);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Parse_RFC5424 - "<PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID
+ * MSGID STRUCTURED-DATA MSG".  "-" is a nil value.  Structured data is
+ * skipped.
+ ****************************************************************************/
+
+static void Input_Parse_RFC5424( const char *p, const char *end, _Sagan_Input_Fields *fields )
+{
+
+    const char *token;
+    size_t length;
+    int pri;
+
+    if (( pri = Input_Parse_PRI(&p, end) ) >= 0 )
+        {
+            Input_Parse_Set_PRI(fields, pri);
+        }
+
+    /* VERSION */
+
+    p = Input_Parse_Token(p, end, &token, &length);
+
+    /* TIMESTAMP */
+
+    if ( Input_Parse_RFC3339(&p, end, fields) == false )
+        {
+            p = Input_Parse_Token(p, end, &token, &length);
+        }
+
+    /* HOSTNAME */
+
+    p = Input_Parse_Token(p, end, &token, &length);
+
+    if ( length > 0 && !( length == 1 && *token == '-' ) )
+        {
+            Input_Field(fields, INPUT_FIELD_HOST, token, length);
+        }
+
+    /* APP-NAME */
+
+    p = Input_Parse_Token(p, end, &token, &length);
+
+    if ( length > 0 && !( length == 1 && *token == '-' ) )
+        {
+            Input_Field(fields, INPUT_FIELD_PROGRAM, token, length);
+        }
+
+    /* PROCID and MSGID */
+
+    p = Input_Parse_Token(p, end, &token, &length);
+    p = Input_Parse_Token(p, end, &token, &length);
+
+    /* STRUCTURED-DATA */
+
+    if ( p < end && *p == '-' )
+        {
+            p++;
+        }
+
+    while ( p < end && *p == '[' )
+        {
+            p = Input_Parse_Skip_SD(p, end);
+        }
+
+    if ( p < end && *p == ' ' )
+        {
+            p++;
+        }
+
+    /* MSG.  Drop the UTF-8 BOM */
+
+    if ( end - p >= 3 && (unsigned char)p[0] == 0xEF && (unsigned char)p[1] == 0xBB && (unsigned char)p[2] == 0xBF )
+        {
+            p += 3;
+        }
+
+    if ( p < end )
+        {
+            Input_Field(fields, INPUT_FIELD_MESSAGE, p, end - p);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Parse_PRI - Returns the "<PRI>" value and moves 'p' past it,  or
+ * returns -1 if it isn't valid.
+ ****************************************************************************/
+
+static int Input_Parse_PRI( const char **p, const char *end )
+{
+
+    const char *c = *p;
+    int digits = 0;
+    int pri = 0;
+
+    if ( c >= end || *c != '<' )
+        {
+            return(-1);
+        }
+
+    for ( c++; c < end && digits < 3 && isdigit((unsigned char)*c); c++, digits++ )
+        {
+            pri = ( pri * 10 ) + ( *c - '0' );
+        }
+
+    if ( digits == 0 || c >= end || *c != '>' || pri > 191 )
+        {
+            return(-1);
+        }
+
+    *p = c + 1;
+
+    return(pri);
+}
+
+/****************************************************************************
+ * Input_Parse_Set_PRI - Facility,  priority and level from the PRI.  The
+ * tag is the PRI in hex,  like syslog-ng's $TAG.
+ ****************************************************************************/
+
+static void Input_Parse_Set_PRI( _Sagan_Input_Fields *fields, int pri )
+{
+
+    const char *facility = input_facility_name[pri >> 3];
+    const char *level = input_level_name[pri & 7];
+
+    Input_Field(fields, INPUT_FIELD_FACILITY, facility, strlen(facility));
+    Input_Field(fields, INPUT_FIELD_PRIORITY, level, strlen(level));
+    Input_Field(fields, INPUT_FIELD_LEVEL, level, strlen(level));
+
+    snprintf(fields->tag, sizeof(fields->tag), "%02x", pri);
+    Input_Field(fields, INPUT_FIELD_TAG, fields->tag, 2);
+
+}
+
+/****************************************************************************
+ * Input_Parse_RFC3339 - "YYYY-MM-DDThh:mm:ss[.frac][zone]".  The date and
+ * time are used as they are (the zone is ignored).  Moves 'p' past the
+ * timestamp.  Returns false if it isn't one.
+ ****************************************************************************/
+
+static sbool Input_Parse_RFC3339( const char **p, const char *end, _Sagan_Input_Fields *fields )
+{
+
+    const char *c = *p;
+
+    if ( end - c < 19 || !isdigit((unsigned char)c[0]) || c[4] != '-' || c[7] != '-' ||
+            c[10] != 'T' || c[13] != ':' || c[16] != ':' )
+        {
+            return(false);
+        }
+
+    Input_Field(fields, INPUT_FIELD_DATE, c, 10);
+    Input_Field(fields, INPUT_FIELD_TIME, c + 11, 8);
+
+    c = memchr(c, ' ', end - c);
+    *p = c != NULL ? c + 1 : end;
+
+    return(true);
+}
+
+/****************************************************************************
+ * Input_Parse_Token - Finds the next space delimited token.  Returns where
+ * the one after it starts.
+ ****************************************************************************/
+
+static const char *Input_Parse_Token( const char *p, const char *end, const char **token, size_t *length )
+{
+
+    const char *space = memchr(p, ' ', end - p);
+
+    if ( space == NULL )
+        {
+            space = end;
+        }
+
+    *token = p;
+    *length = space - p;
+
+    return( space < end ? space + 1 : end );
+}
+
+/****************************************************************************
+ * Input_Parse_Skip_SD - Skips one "[SD-ID PARAM="VALUE" ...]" element.  A
+ * '"',  '\' or ']' inside a value may be escaped with a '\'.
+ ****************************************************************************/
+
+static const char *Input_Parse_Skip_SD( const char *p, const char *end )
+{
+
+    sbool quoted = false;
+
+    for ( p++; p < end; p++ )
+        {
+
+            if ( quoted == true )
+                {
+
+                    if ( *p == '\\' )
+                        {
+                            p++;
+                        }
+
+                    else if ( *p == '"' )
+                        {
+                            quoted = false;
+                        }
+
+                    continue;
+                }
+
+            if ( *p == '"' )
+                {
+                    quoted = true;
+                }
+
+            else if ( *p == ']' )
+                {
+                    return(p + 1);
+                }
+        }
+
+    return(end);
+}
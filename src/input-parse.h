@@ -0,0 +1,47 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+
+#define INPUT_DEFAULT_PRI	13		/* user.notice,  for RFC 3164 lines without a PRI */
+
+/* Where each field of a line was found.  Most point into the line itself.
+ * Values a parser has to build (names from the PRI,  a date with a year)
+ * point into the buffers below.  A NULL value is a missing field. */
+
+typedef struct _Sagan_Input_Fields _Sagan_Input_Fields;
+struct _Sagan_Input_Fields
+{
+
+    const char	*value[INPUT_FIELD_COUNT];
+    size_t	length[INPUT_FIELD_COUNT];
+
+    char	tag[3];
+    char	date[11];
+
+};
+
+void Input_Parse( _Sagan_Input *, const char *, size_t, _Sagan_Input_Fields * );
+int  Input_Parse_Format( const char * );
@@ -0,0 +1,1016 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* input.c
+ *
+ * Reads Sagan formatted ("|" delimited) logs from FIFOs and files.  Each
+ * input gets its own reader thread,  all feeding the same work queue.  Data is
+ * pulled in with large read() calls,  lines are found with memchr() and
+ * fields are kept as (offset, length) views into the read buffer.  The only
+ * copy made is into the work queue slot.  Lines are handed to the workers
+ * a batch at a time.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "work-queue.h"
+#include "input.h"
+#include "input-net.h"
+#include "input-parse.h"
+#include "dns-cache.h"
+#include "input-mmap.h"
+#include "lockfile.h"
+#include "stats.h"
+#include "rule-profile.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+struct _SaganDebug *debug;
+
+struct _Sagan_Work_Queue **SaganWorkQueues;
+struct _Sagan_Input *SaganInputs;
+
+int work_queue_count;			 /* Comes from sagan.c */
+
+int proc_running;			 /* Comes from sagan.c */
+unsigned char dynamic_rule_flag;	 /* Comes from sagan.c */
+sbool reload_rules;			 /* Comes from sagan.c */
+
+pthread_mutex_t SaganMalformedCounter;
+pthread_mutex_t SaganRulesLoadedMutex;
+pthread_mutex_t SaganDynamicFlag;
+pthread_mutex_t SaganInputMutex;
+
+static int input_running = 0;		/* Readers that haven't hit EOF */
+
+/* Replacement values when a field is missing */
+
+static const char *input_field_error[INPUT_FIELD_COUNT] =
+{
+    NULL,
+    "SAGAN: FACILITY ERROR",
+    "SAGAN: PRIORITY ERROR",
+    "SAGAN: LEVEL ERROR",
+    "SAGAN: TAG ERROR",
+    "SAGAN: DATE ERROR",
+    "SAGAN: TIME ERROR",
+    "SAGAN: PROGRAM ERROR",
+    "SAGAN: MESSAGE ERROR"
+};
+
+static const char *input_field_name[INPUT_FIELD_COUNT] =
+{
+    "host", "facility", "priority", "level", "tag", "date", "time", "program", "message"
+};
+
+static const char *input_type_name[] =
+{
+    "FIFO", "File", "UDP", "TCP"
+};
+
+static void Input_Open( _Sagan_Input * );
+static void Input_Process_Buffer( _Sagan_Input *, sbool );
+static void Input_Malformed( _Sagan_Input *, int );
+static time_t Input_Event_Time( _Sagan_Input *, const char *, const char * );
+static void Input_Replay_Pace( _Sagan_Input * );
+static uintmax_t Input_Enqueue_Shard( _Sagan_Input *, const char *, _Sagan_Field_View *, const char **, int );
+
+/****************************************************************************
+ * Input_Type_Name - Returns a printable name for an INPUT_TYPE_*
+ ****************************************************************************/
+
+const char *Input_Type_Name( int type )
+{
+    return(input_type_name[type]);
+}
+
+/****************************************************************************
+ * Input_Field_Name - Returns the name of an INPUT_FIELD_*
+ ****************************************************************************/
+
+const char *Input_Field_Name( int field )
+{
+    return(input_field_name[field]);
+}
+
+/****************************************************************************
+ * Input_Field_Lookup - Returns the INPUT_FIELD_* for a name (as used in
+ * sagan.yaml),  or -1 if there isn't one
+ ****************************************************************************/
+
+int Input_Field_Lookup( const char *name )
+{
+
+    int i;
+
+    for ( i = 0; i < INPUT_FIELD_COUNT; i++ )
+        {
+            if ( !strcasecmp(name, input_field_name[i]) )
+                {
+                    return(i);
+                }
+        }
+
+    return(-1);
+}
+
+/****************************************************************************
+ * Input_Start - Spawns a reader thread for every configured input and
+ * waits on them.  Only returns if every reader has gone away,  which
+ * can't happen (the last file reader to finish exits Sagan).
+ ****************************************************************************/
+
+void Input_Start( void )
+{
+
+    pthread_t reader_id[counters->input_count];
+    void *reader;
+    int rc;
+    int i;
+
+    input_running = counters->input_count;
+
+    Sagan_Log(S_NORMAL, "Spawning %d Input Reader Thread(s).", counters->input_count);
+
+    for (i = 0; i < counters->input_count; i++)
+        {
+
+            /* Reading from a file,  there's no reason to ever drop an event.  Hold
+             * the reader until the workers catch up.  A TCP sender gets the same
+             * treatment,  it'll see the back pressure */
+
+            SaganInputs[i].block = ( SaganInputs[i].type == INPUT_TYPE_FILE || SaganInputs[i].type == INPUT_TYPE_TCP || config->replay_flag ) ? true : config->sagan_queue_block;
+
+            switch ( SaganInputs[i].type )
+                {
+
+                case INPUT_TYPE_UDP:
+                    reader = Input_UDP_Reader;
+                    break;
+
+                case INPUT_TYPE_TCP:
+                    reader = Input_TCP_Reader;
+                    break;
+
+                case INPUT_TYPE_FILE:
+                    reader = config->parallel_flag ? (void *)Input_Mmap_Reader : (void *)Input_Reader;
+                    break;
+
+                default:
+                    reader = Input_Reader;
+                    break;
+
+                }
+
+            rc = pthread_create( &reader_id[i], NULL, reader, &SaganInputs[i] );
+
+            if ( rc != 0 )
+                {
+
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "Could not pthread_create() for input reader %s [error: %d]", SaganInputs[i].path, rc);
+
+                }
+        }
+
+    for (i = 0; i < counters->input_count; i++)
+        {
+            pthread_join(reader_id[i], NULL);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Reader - Main loop for a FIFO/file.  A FIFO reader never returns.
+ * A file reader returns at EOF,  unless it is the last input still
+ * running,  in which case Sagan exits once the file has been processed.
+ ****************************************************************************/
+
+void Input_Reader( _Sagan_Input *input )
+{
+
+    ssize_t bytes;
+    sbool fifoerr = false;
+    int error;
+
+    SetThreadName("SaganReader");
+
+    input->buffer_size = INPUT_READ_BUFFER;
+    input->buffer_len = 0;
+    input->buffer = malloc(input->buffer_size);
+
+    if ( input->buffer == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input buffer. Abort!", __FILE__, __LINE__);
+        }
+
+    input->pending = malloc(config->sagan_queue_batch * sizeof(_Sagan_Field_View));
+
+    if ( input->pending == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for input lines. Abort!", __FILE__, __LINE__);
+        }
+
+    Input_Open(input);
+
+    for (;;)
+        {
+
+            bytes = read(input->fd, input->buffer + input->buffer_len, input->buffer_size - input->buffer_len);
+
+            if ( bytes > 0 )
+                {
+
+                    /* If the FIFO was in a error state,  let user know the FIFO writer has resumed */
+
+                    if ( fifoerr == true )
+                        {
+
+                            Sagan_Log(S_NORMAL, "FIFO writer has restarted. Processing events.");
+
+#if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
+
+                            Set_Pipe_Size(input->fd);
+
+#endif
+                            fifoerr = false;
+                        }
+
+                    input->buffer_len += bytes;
+
+                    Input_Process_Buffer(input, false);
+
+                    /* A "line" that fills the entire buffer has no end in sight.
+                     * Take what we have.  It'll be truncated to MAX_SYSLOGMSG anyways */
+
+                    if ( input->buffer_len == input->buffer_size )
+                        {
+                            Input_Process_Buffer(input, true);
+                        }
+
+                    continue;
+                }
+
+            if ( bytes == -1 )
+                {
+
+                    if ( errno == EINTR )
+                        {
+                            continue;
+                        }
+
+                    error = errno;
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Error reading from %s: %s. Abort!", __FILE__, __LINE__, input->path, strerror(error));
+                }
+
+            /* read() returned 0.  Either the end of the file or the FIFO writer
+             * has gone away.  Anything left over is the last line. */
+
+            Input_Process_Buffer(input, true);
+
+            if ( input->type == INPUT_TYPE_FILE )
+                {
+                    Input_Finished(input);
+                    return;
+                }
+
+            if ( fifoerr == false )
+                {
+                    Sagan_Log(S_WARN, "FIFO writer closed.  Waiting for FIFO writer to restart....");
+                    fifoerr = true;
+                }
+
+            sleep(1);		/* So we don't eat 100% CPU */
+
+        }
+
+}
+
+/****************************************************************************
+ * Input_Finished - A file has been read.  If other inputs are still
+ * running,  just close it up.  Otherwise wait for the workers to empty
+ * the queue and exit.
+ ****************************************************************************/
+
+void Input_Finished( _Sagan_Input *input )
+{
+
+    uint64_t pending;
+    uint64_t depth;
+    int running;
+    int i;
+
+    close(input->fd);
+
+    free(input->buffer);
+    free(input->pending);
+
+    input->buffer = NULL;
+    input->pending = NULL;
+
+    pthread_mutex_lock(&SaganInputMutex);
+    running = --input_running;
+    pthread_mutex_unlock(&SaganInputMutex);
+
+    if ( running > 0 )
+        {
+            Sagan_Log(S_NORMAL, "EOF reached on %s. %d input(s) still running.", input->path, running);
+            return;
+        }
+
+    Sagan_Log(S_NORMAL, "EOF reached. Waiting for threads to catch up....");
+    Sagan_Log(S_NORMAL, "");
+
+    for (;;)
+        {
+
+            pending = 0;
+            depth = 0;
+
+            for ( i = 0; i < work_queue_count; i++ )
+                {
+                    pending += Work_Queue_Pending(SaganWorkQueues[i]);
+                    depth += Work_Queue_Depth(SaganWorkQueues[i]);
+                }
+
+            if ( pending == 0 )
+                {
+                    break;
+                }
+
+            Sagan_Log(S_NORMAL, "Waiting on %" PRIu64 " queued event(s) and %d thread(s)....", depth, proc_running);
+            sleep(1);
+        }
+
+    Statistics();
+    Rule_Profile_Report();
+    Remove_Lock_File();
+
+    Sagan_Log(S_NORMAL, "Exiting.");
+    exit(0);
+
+}
+
+/****************************************************************************
+ * Input_Open - Opens (or creates) the FIFO,  or opens the file.
+ ****************************************************************************/
+
+static void Input_Open( _Sagan_Input *input )
+{
+
+    if ( input->type == INPUT_TYPE_FIFO )
+        {
+            Sagan_Log(S_NORMAL, "Attempting to open syslog FIFO (%s).", input->path);
+        }
+    else
+        {
+            Sagan_Log(S_NORMAL, "Attempting to open syslog FILE (%s).", input->path);
+        }
+
+    if (( input->fd = open(input->path, O_RDONLY) ) == -1 )
+        {
+
+            if ( input->type == INPUT_TYPE_FIFO )
+                {
+
+                    /* try to create it */
+
+                    Sagan_Log(S_NORMAL, "Fifo not found, creating it (%s).", input->path);
+
+                    if (mkfifo(input->path, 0700) == -1)
+                        {
+                            Sagan_Log(S_ERROR, "Could not create FIFO '%s'. Abort!", input->path);
+                        }
+
+                    input->fd = open(input->path, O_RDONLY);
+
+                    if ( input->fd == -1 )
+                        {
+                            Sagan_Log(S_ERROR, "Error opening %s. Abort!", input->path);
+                        }
+
+                }
+            else
+                {
+                    Sagan_Log(S_ERROR, "Could not open file '%s'. Abort!", input->path);
+                }
+
+        }
+
+    if ( input->type == INPUT_TYPE_FIFO )
+        {
+            Sagan_Log(S_NORMAL, "Successfully opened FIFO (%s).", input->path);
+
+#if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
+
+            Set_Pipe_Size(input->fd);
+
+#endif
+
+        }
+    else
+        {
+            Sagan_Log(S_NORMAL, "Successfully opened FILE (%s) and processing events.....", input->path);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Process_Buffer - Finds complete lines in the read buffer and hands
+ * them to the work queue a batch at a time.  Any partial line is moved to
+ * the front of the buffer for the next read().  If 'flush' is set,
+ * whatever is left is treated as a complete line.
+ ****************************************************************************/
+
+static void Input_Process_Buffer( _Sagan_Input *input, sbool flush )
+{
+
+    char *line = input->buffer;
+    char *end = input->buffer + input->buffer_len;
+    char *newline;
+
+    int line_count;
+
+    while ( line < end )
+        {
+
+            /* Collect up to a batch worth of lines */
+
+            line_count = 0;
+
+            while ( line < end && line_count < config->sagan_queue_batch )
+                {
+
+                    newline = memchr(line, '\n', end - line);
+
+                    if ( newline == NULL )
+                        {
+
+                            if ( flush == false )
+                                {
+                                    break;
+                                }
+
+                            newline = end;
+                        }
+
+                    /* Blank lines aren't events */
+
+                    if ( newline != line )
+                        {
+                            input->pending[line_count].offset = line - input->buffer;
+                            input->pending[line_count].length = newline - line;
+                            line_count++;
+                        }
+
+                    line = newline < end ? newline + 1 : end;
+                }
+
+            if ( line_count == 0 )
+                {
+                    break;
+                }
+
+            Input_Enqueue(input, input->buffer, input->pending, NULL, line_count);
+
+        }
+
+    /* Keep the partial line (if any) for the next read() */
+
+    input->buffer_len = end - line;
+
+    if ( input->buffer_len > 0 && line != input->buffer )
+        {
+            memmove(input->buffer, line, input->buffer_len);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Enqueue - Hands 'count' lines (views into 'base') to the work
+ * queue.  In "drop" mode we may get fewer slots than we asked for (or none
+ * at all).  'peer',  if not NULL,  is the address each line came from.
+ * Used by every input type.
+ ****************************************************************************/
+
+void Input_Enqueue( _Sagan_Input *input, const char *base, _Sagan_Field_View *line, const char **peer, int count )
+{
+
+    uint64_t ticket = 0;
+    int reserved;
+    int i = 0;
+    int j;
+
+    uintmax_t lines = input->lines;
+    uintmax_t dropped = input->dropped;
+    uintmax_t exhausted = 0;
+
+    time_t t;
+    struct tm now;
+
+    if ( input->format == INPUT_FORMAT_RFC3164 || input->format == INPUT_FORMAT_AUTO )
+        {
+            t = time(NULL);
+            localtime_r(&t, &now);
+            input->year = now.tm_year + 1900;
+            input->month = now.tm_mon + 1;
+        }
+
+    if ( work_queue_count > 1 )
+        {
+            exhausted = Input_Enqueue_Shard(input, base, line, peer, count);
+        }
+    else
+        {
+
+            while ( i < count )
+                {
+
+                    reserved = Work_Queue_Reserve(SaganWorkQueues[0], count - i, input->block, &ticket);
+
+                    if ( reserved == 0 )
+                        {
+                            Input_Process_Line(input, base + line[i].offset, line[i].length, peer != NULL ? peer[i] : NULL, NULL);
+                            exhausted++;
+                            i++;
+                            continue;
+                        }
+
+                    for ( j = 0; j < reserved; j++ )
+                        {
+                            Input_Process_Line(input, base + line[i + j].offset, line[i + j].length, peer != NULL ? peer[i + j] : NULL, Work_Queue_Slot(SaganWorkQueues[0], ticket + j));
+                        }
+
+                    Work_Queue_Commit(SaganWorkQueues[0], ticket, reserved);
+
+                    i += reserved;
+                }
+
+        }
+
+    /* Other readers update the same global counters,  so add ours in
+     * once per batch rather than once per line */
+
+    pthread_mutex_lock(&SaganInputMutex);
+    counters->sagantotal += input->lines - lines;
+    counters->sagan_log_drop += input->dropped - dropped;
+    counters->worker_thread_exhaustion += exhausted;
+    pthread_mutex_unlock(&SaganInputMutex);
+
+    if ( config->replay_flag == true && config->replay_speed > 0 )
+        {
+            Input_Replay_Pace(input);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Enqueue_Shard - With "queue-shard",  every worker has a queue of
+ * its own.  Each line is parsed into the input's staging event so we can
+ * hash the shard field,  then the staging event is traded for the empty
+ * one in a slot on that worker's queue.  Events with the same key are
+ * always run,  in order,  by the same worker.  Returns the number of lines
+ * that found their queue full.
+ ****************************************************************************/
+
+static uintmax_t Input_Enqueue_Shard( _Sagan_Input *input, const char *base, _Sagan_Field_View *line, const char **peer, int count )
+{
+
+    _Sagan_Work_Queue *queue;
+    uint64_t ticket = 0;
+    uintmax_t exhausted = 0;
+    char *key = NULL;
+    sbool message;
+    int i;
+
+    if ( input->staging == NULL )
+        {
+
+            input->staging = malloc(sizeof(struct _Sagan_Proc_Syslog));
+
+            if ( input->staging == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the staging event. Abort!", __FILE__, __LINE__);
+                }
+
+        }
+
+    for ( i = 0; i < count; i++ )
+        {
+
+            message = Input_Process_Line(input, base + line[i].offset, line[i].length, peer != NULL ? peer[i] : NULL, input->staging);
+
+            switch ( config->sagan_queue_shard )
+                {
+
+                case INPUT_FIELD_FACILITY:
+                    key = input->staging->syslog_facility;
+                    break;
+
+                case INPUT_FIELD_PRIORITY:
+                    key = input->staging->syslog_priority;
+                    break;
+
+                case INPUT_FIELD_LEVEL:
+                    key = input->staging->syslog_level;
+                    break;
+
+                case INPUT_FIELD_TAG:
+                    key = input->staging->syslog_tag;
+                    break;
+
+                case INPUT_FIELD_PROGRAM:
+                    key = input->staging->syslog_program;
+                    break;
+
+                default:
+                    key = input->staging->syslog_host;
+                    break;
+                }
+
+            queue = SaganWorkQueues[ Djb2_Hash(key) % work_queue_count ];
+
+            if ( Work_Queue_Reserve(queue, 1, input->block, &ticket) == 0 )
+                {
+
+                    /* Lines without a message were already counted */
+
+                    if ( message == true )
+                        {
+                            input->dropped++;
+                        }
+
+                    exhausted++;
+                    continue;
+                }
+
+            input->staging = Work_Queue_Exchange(queue, ticket, input->staging);
+            Work_Queue_Commit(queue, ticket, 1);
+
+        }
+
+    return(exhausted);
+}
+
+/****************************************************************************
+ * Input_Process_Line - Parses a line and copies its fields into a work
+ * queue slot.  If 'SaganProcSyslog' is NULL the queue was full and the
+ * line is counted as dropped.  For raw syslog,  'peer' (when we know it)
+ * is used as the host,  like rsyslog's %fromhost-ip%.  Returns false if
+ * the line had no message.
+ ****************************************************************************/
+
+sbool Input_Process_Line( _Sagan_Input *input, const char *line, size_t length, const char *peer, struct _Sagan_Proc_Syslog *SaganProcSyslog )
+{
+
+    _Sagan_Input_Fields fields;
+
+    char syslog_host[sizeof(SaganProcSyslog->syslog_host)];
+    char dns_host[MAXIP];
+    char *dest[INPUT_FIELD_COUNT];
+    size_t dest_size[INPUT_FIELD_COUNT];
+    size_t len;
+    int i;
+
+    input->lines++;
+
+    /* If Dynamic rules are loaded,  keep track of line count */
+
+    if ( config->dynamic_load_flag == true )
+        {
+            input->dynamic_line_count++;
+        }
+
+    Input_Parse(input, line, length, &fields);
+
+    if ( peer != NULL && input->format != INPUT_FORMAT_SAGAN )
+        {
+            fields.value[INPUT_FIELD_HOST] = peer;
+            fields.length[INPUT_FIELD_HOST] = strlen(peer);
+        }
+
+    /* We check to see if values from our FIFO are valid.  The host is
+     * needed as a string for the checks below */
+
+    len = 0;
+
+    if ( fields.value[INPUT_FIELD_HOST] != NULL )
+        {
+            len = fields.length[INPUT_FIELD_HOST] < sizeof(syslog_host) ? fields.length[INPUT_FIELD_HOST] : sizeof(syslog_host) - 1;
+            memcpy(syslog_host, fields.value[INPUT_FIELD_HOST], len);
+        }
+
+    syslog_host[len] = '\0';
+
+    /* If we're using DNS (and we shouldn't be!),  we start DNS checks and lookups
+     * here.  Both good and bad lookups are cached (see dns-cache.c) to not over
+     * load our DNS server(s) */
+
+    if ( config->syslog_src_lookup )
+        {
+
+            if ( !Is_IP(syslog_host) )   	/* Is inbound a valid IP? */
+                {
+                    DNS_Cache_Lookup(syslog_host, dns_host, sizeof(dns_host));
+                    strlcpy(syslog_host, dns_host, sizeof(syslog_host));
+                }
+
+        }
+
+    else if ( !Is_IP(syslog_host) )
+        {
+
+            if ( debug->debugmalformed )
+                {
+                    Sagan_Log(S_WARN, "Sagan received a malformed 'host': '%s' (replaced with %s)", syslog_host, config->sagan_host);
+                }
+
+            strlcpy(syslog_host, config->sagan_host, sizeof(syslog_host));
+            Input_Malformed(input, INPUT_FIELD_HOST);
+        }
+
+    /* We now check the rest of the values */
+
+    for ( i = INPUT_FIELD_FACILITY; i < INPUT_FIELD_COUNT; i++ )
+        {
+            if ( fields.value[i] == NULL )
+                {
+                    Input_Malformed(input, i);
+                }
+        }
+
+    /* If the message is lost,  all is lost.  Typically,  you don't lose part of the message,
+     * it's more likely to lose all  - Champ Clark III 11/17/2011 */
+
+    if ( SaganProcSyslog == NULL || fields.value[INPUT_FIELD_MESSAGE] == NULL )
+        {
+            input->dropped++;
+        }
+
+    if ( SaganProcSyslog == NULL )
+        {
+            return(fields.value[INPUT_FIELD_MESSAGE] != NULL);
+        }
+
+    dest[INPUT_FIELD_HOST] = SaganProcSyslog->syslog_host;
+    dest[INPUT_FIELD_FACILITY] = SaganProcSyslog->syslog_facility;
+    dest[INPUT_FIELD_PRIORITY] = SaganProcSyslog->syslog_priority;
+    dest[INPUT_FIELD_LEVEL] = SaganProcSyslog->syslog_level;
+    dest[INPUT_FIELD_TAG] = SaganProcSyslog->syslog_tag;
+    dest[INPUT_FIELD_DATE] = SaganProcSyslog->syslog_date;
+    dest[INPUT_FIELD_TIME] = SaganProcSyslog->syslog_time;
+    dest[INPUT_FIELD_PROGRAM] = SaganProcSyslog->syslog_program;
+    dest[INPUT_FIELD_MESSAGE] = SaganProcSyslog->syslog_message;
+
+    dest_size[INPUT_FIELD_HOST] = sizeof(SaganProcSyslog->syslog_host);
+    dest_size[INPUT_FIELD_FACILITY] = sizeof(SaganProcSyslog->syslog_facility);
+    dest_size[INPUT_FIELD_PRIORITY] = sizeof(SaganProcSyslog->syslog_priority);
+    dest_size[INPUT_FIELD_LEVEL] = sizeof(SaganProcSyslog->syslog_level);
+    dest_size[INPUT_FIELD_TAG] = sizeof(SaganProcSyslog->syslog_tag);
+    dest_size[INPUT_FIELD_DATE] = sizeof(SaganProcSyslog->syslog_date);
+    dest_size[INPUT_FIELD_TIME] = sizeof(SaganProcSyslog->syslog_time);
+    dest_size[INPUT_FIELD_PROGRAM] = sizeof(SaganProcSyslog->syslog_program);
+    dest_size[INPUT_FIELD_MESSAGE] = sizeof(SaganProcSyslog->syslog_message);
+
+    memcpy(SaganProcSyslog->syslog_host, syslog_host, sizeof(syslog_host));
+
+    for ( i = INPUT_FIELD_FACILITY; i < INPUT_FIELD_COUNT; i++ )
+        {
+
+            if ( fields.value[i] != NULL )
+                {
+                    len = fields.length[i] < dest_size[i] ? fields.length[i] : dest_size[i] - 1;
+                    memcpy(dest[i], fields.value[i], len);
+                    dest[i][len] = '\0';
+                }
+            else
+                {
+                    strlcpy(dest[i], input_field_error[i], dest_size[i]);
+                }
+        }
+
+    if ( config->replay_flag == true )
+        {
+            SaganProcSyslog->syslog_utime = Input_Event_Time(input, SaganProcSyslog->syslog_date, SaganProcSyslog->syslog_time);
+        }
+
+    if ( config->dynamic_load_flag == true && ( input->dynamic_line_count >= config->dynamic_load_sample_rate ) )
+        {
+
+            pthread_mutex_lock(&SaganDynamicFlag);
+            dynamic_rule_flag = DYNAMIC_RULE;
+            pthread_mutex_unlock(&SaganDynamicFlag);
+
+            input->dynamic_line_count = 0;
+        }
+
+    /* Thread holds here if rule load is in progress */
+
+    if ( config->dynamic_load_flag == true )
+        {
+
+            pthread_mutex_lock(&SaganRulesLoadedMutex);
+            reload_rules = true;
+            pthread_mutex_unlock(&SaganRulesLoadedMutex);
+
+        }
+
+    if (debug->debugsyslog)
+        {
+
+            Sagan_Log(S_DEBUG, "[%s, line %d] **[RAW Syslog]*********************************", __FILE__, __LINE__);
+            Sagan_Log(S_DEBUG, "[%s, line %d] Host: %s | Program: %s | Facility: %s | Priority: %s | Level: %s | Tag: %s", __FILE__, __LINE__, SaganProcSyslog->syslog_host, SaganProcSyslog->syslog_program, SaganProcSyslog->syslog_facility, SaganProcSyslog->syslog_priority, SaganProcSyslog->syslog_level, SaganProcSyslog->syslog_tag);
+            Sagan_Log(S_DEBUG, "[%s, line %d] Raw message: %s", __FILE__, __LINE__, SaganProcSyslog->syslog_message);
+
+        }
+
+    return(fields.value[INPUT_FIELD_MESSAGE] != NULL);
+}
+
+/****************************************************************************
+ * Input_Malformed - Counts (and optionally reports) a missing field
+ ****************************************************************************/
+
+static void Input_Malformed( _Sagan_Input *input, int field )
+{
+
+    input->malformed++;
+
+    pthread_mutex_lock(&SaganMalformedCounter);
+
+    switch ( field )
+        {
+
+        case INPUT_FIELD_HOST:
+            counters->malformed_host++;
+            break;
+
+        case INPUT_FIELD_FACILITY:
+            counters->malformed_facility++;
+            break;
+
+        case INPUT_FIELD_PRIORITY:
+            counters->malformed_priority++;
+            break;
+
+        case INPUT_FIELD_LEVEL:
+            counters->malformed_level++;
+            break;
+
+        case INPUT_FIELD_TAG:
+            counters->malformed_tag++;
+            break;
+
+        case INPUT_FIELD_DATE:
+            counters->malformed_date++;
+            break;
+
+        case INPUT_FIELD_TIME:
+            counters->malformed_time++;
+            break;
+
+        case INPUT_FIELD_PROGRAM:
+            counters->malformed_program++;
+            break;
+
+        case INPUT_FIELD_MESSAGE:
+            counters->malformed_message++;
+            break;
+
+        }
+
+    pthread_mutex_unlock(&SaganMalformedCounter);
+
+    if ( debug->debugmalformed && field != INPUT_FIELD_HOST )
+        {
+            Sagan_Log(S_WARN, "Sagan received a malformed '%s'", input_field_name[field]);
+        }
+
+}
+
+/****************************************************************************
+ * Input_Event_Time - Turns "YYYY-MM-DD" and "HH:MM:SS" (local time) into a
+ * utime for replay mode.  mktime() is only called when the hour changes,
+ * so a DST change (which happens on the hour) is taken into account.  If
+ * the time can't be read the event gets the time of the one before it.
+ ****************************************************************************/
+
+static time_t Input_Event_Time( _Sagan_Input *input, const char *date, const char *time )
+{
+
+    struct tm tm;
+    int hour;
+    int minute;
+    int second;
+
+    if ( sscanf(time, "%2d:%2d:%2d", &hour, &minute, &second) != 3 )
+        {
+            return(input->replay_last);
+        }
+
+    if ( hour != input->replay_hour || strcmp(date, input->replay_date) )
+        {
+
+            memset(&tm, 0, sizeof(tm));
+
+            if ( sscanf(date, "%4d-%2d-%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3 )
+                {
+                    return(input->replay_last);
+                }
+
+            tm.tm_year -= 1900;
+            tm.tm_mon--;
+            tm.tm_hour = hour;
+            tm.tm_isdst = -1;
+
+            input->replay_hour_start = mktime(&tm);
+            input->replay_hour = hour;
+            strlcpy(input->replay_date, date, sizeof(input->replay_date));
+        }
+
+    input->replay_last = input->replay_hour_start + minute * 60 + second;
+
+    return(input->replay_last);
+}
+
+/****************************************************************************
+ * Input_Replay_Pace - With "-R speed",  sleeps until the wall clock catches
+ * up with the last event handed to the workers.
+ ****************************************************************************/
+
+static void Input_Replay_Pace( _Sagan_Input *input )
+{
+
+    struct timeval now;
+    struct timespec pause;
+    int64_t target;
+    int64_t elapsed;
+
+    if ( input->replay_last == 0 )
+        {
+            return;
+        }
+
+    if ( input->replay_first == 0 )
+        {
+            input->replay_first = input->replay_last;
+            gettimeofday(&input->replay_start, NULL);
+            return;
+        }
+
+    gettimeofday(&now, NULL);
+
+    target = (int64_t)( ( input->replay_last - input->replay_first ) * 1000000.0 / config->replay_speed );
+    elapsed = (int64_t)( now.tv_sec - input->replay_start.tv_sec ) * 1000000 + ( now.tv_usec - input->replay_start.tv_usec );
+
+    if ( target > elapsed )
+        {
+            pause.tv_sec = ( target - elapsed ) / 1000000;
+            pause.tv_nsec = ( ( target - elapsed ) % 1000000 ) * 1000;
+            nanosleep(&pause, NULL);
+        }
+
+}
@@ -0,0 +1,129 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+/* Position of each field in a "|" delimited Sagan formatted line */
+
+#define INPUT_FIELD_HOST	0
+#define INPUT_FIELD_FACILITY	1
+#define INPUT_FIELD_PRIORITY	2
+#define INPUT_FIELD_LEVEL	3
+#define INPUT_FIELD_TAG		4
+#define INPUT_FIELD_DATE	5
+#define INPUT_FIELD_TIME	6
+#define INPUT_FIELD_PROGRAM	7
+#define INPUT_FIELD_MESSAGE	8
+
+#define INPUT_FIELD_COUNT	9
+
+/* Input types */
+
+#define INPUT_TYPE_FIFO		0
+#define INPUT_TYPE_FILE		1
+#define INPUT_TYPE_UDP		2
+#define INPUT_TYPE_TCP		3
+
+/* Line formats */
+
+#define INPUT_FORMAT_SAGAN	0	/* "|" delimited,  from the rsyslog/syslog-ng template */
+#define INPUT_FORMAT_RFC3164	1
+#define INPUT_FORMAT_RFC5424	2
+#define INPUT_FORMAT_AUTO	3
+
+/* Enough to drain a full pipe in one read(),  plus room for a partial line */
+
+#define INPUT_READ_BUFFER	( MAX_FIFO_SIZE + MAX_SYSLOGMSG )
+
+/* A field is a view into the read buffer,  not a copy */
+
+typedef struct _Sagan_Field_View _Sagan_Field_View;
+struct _Sagan_Field_View
+{
+    uint32_t offset;			/* From the start of the line */
+    uint32_t length;
+};
+
+typedef struct _Sagan_Input _Sagan_Input;
+struct _Sagan_Input
+{
+
+    char	path[MAXPATH];		/* FIFO/file name,  or "address:port" when listening */
+    int		type;
+    int		format;
+    sbool	enabled;
+    sbool	block;				/* Wait for room rather than drop when the queue is full */
+    int		fd;
+
+    char	address[64];		/* UDP/TCP only */
+    int		port;
+    int		socket_buffer;		/* SO_RCVBUF.  0 is the system default */
+
+    char	*buffer;
+    size_t	buffer_size;
+    size_t	buffer_len;
+
+    _Sagan_Field_View *pending;		/* Lines waiting to be handed to the queue */
+    const char	**peer;			/* UDP/TCP: who sent each pending line */
+
+    int		dynamic_line_count;
+
+    /* With "queue-shard",  lines are parsed here before we know which
+     * worker's queue they go to (see Input_Enqueue_Shard()) */
+
+    struct _Sagan_Proc_Syslog *staging;
+
+    /* RFC 3164 timestamps have no year.  This is "now" as of the last batch */
+
+    int		year;
+    int		month;
+
+    /* Replay mode (-R) */
+
+    char	replay_date[11];		/* Last syslog_date seen ... */
+    int		replay_hour;			/* ... and hour ... */
+    time_t	replay_hour_start;		/* ... and the start of that hour as a utime */
+    time_t	replay_first;			/* First event time,  for pacing */
+    time_t	replay_last;
+    struct timeval replay_start;		/* Wall clock at replay_first */
+
+    /* Per input statistics.  Only the reader thread for this input
+     * writes to these */
+
+    uintmax_t	lines;
+    uintmax_t	malformed;
+    uintmax_t	dropped;
+
+};
+
+const char *Input_Type_Name( int );
+const char *Input_Field_Name( int );
+int Input_Field_Lookup( const char * );
+void Input_Start( void );
+void Input_Reader( _Sagan_Input * );
+void Input_Enqueue( _Sagan_Input *, const char *, _Sagan_Field_View *, const char **, int );
+sbool Input_Process_Line( _Sagan_Input *, const char *, size_t, const char *, struct _Sagan_Proc_Syslog * );
+void Input_Finished( _Sagan_Input * );
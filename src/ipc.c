@@ -113,7 +113,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -206,7 +206,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -298,7 +298,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -385,7 +385,7 @@ sbool Clean_IPC_Object( int type )
             char timet[20];
 
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -471,7 +471,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -557,7 +557,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -647,7 +647,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -737,7 +737,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -823,7 +823,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -909,7 +909,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -995,7 +995,7 @@ sbool Clean_IPC_Object( int type )
 
             char timet[20];
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(timet, sizeof(timet), "%s",  now);
             utime = atol(timet);
@@ -46,6 +46,7 @@
 #include "sagan-defs.h"
 #include "key.h"
 #include "stats.h"
+#include "rule-profile.h"
 
 struct _SaganConfig *config;
 
@@ -63,6 +64,7 @@ void Key_Handler( void )
             if ( key != 0 )
                 {
                     Statistics();
+                    Rule_Profile_Report();
                 }
 
         }
@@ -42,6 +42,7 @@
 #include "sagan-defs.h"
 #include "liblognormalize.h"
 #include "sagan-config.h"
+#include "dns-cache.h"
 
 struct _SaganConfig *config;
 struct _SaganDebug *debug;
@@ -206,7 +207,7 @@ json_object *Normalize_Liblognorm(char *syslog_msg, struct _SaganNormalizeLiblog
             if ( SaganNormalizeLiblognorm->ip_src[0] == '0' && config->syslog_src_lookup)
                 {
 
-                    if (0 == DNS_Lookup(SaganNormalizeLiblognorm->src_host, tmp_host, sizeof(tmp_host)))
+                    if (0 == DNS_Cache_Lookup(SaganNormalizeLiblognorm->src_host, tmp_host, sizeof(tmp_host)))
                         {
                             strlcpy(SaganNormalizeLiblognorm->ip_src, tmp_host, sizeof(SaganNormalizeLiblognorm->ip_src));
                         }
@@ -225,7 +226,7 @@ json_object *Normalize_Liblognorm(char *syslog_msg, struct _SaganNormalizeLiblog
             if ( SaganNormalizeLiblognorm->ip_dst[0] == '0' && config->syslog_src_lookup)
                 {
 
-                    if (0 == DNS_Lookup(SaganNormalizeLiblognorm->dst_host, tmp_host, sizeof(tmp_host)))
+                    if (0 == DNS_Cache_Lookup(SaganNormalizeLiblognorm->dst_host, tmp_host, sizeof(tmp_host)))
                         {
                             strlcpy(SaganNormalizeLiblognorm->ip_dst, tmp_host, sizeof(SaganNormalizeLiblognorm->ip_dst));
                         }
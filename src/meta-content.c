@@ -46,7 +46,7 @@
 
 struct _Rule_Struct *rulestruct;
 
-int Meta_Content_Search(char *syslog_msg, int rule_position , int meta_content_count)
+int Meta_Content_Search(const char *syslog_msg, size_t syslog_msg_len, int rule_position , int meta_content_count)
 {
 
     int z = meta_content_count;
@@ -60,14 +60,14 @@ int Meta_Content_Search(char *syslog_msg, int rule_position , int meta_content_c
                 {
                     if ( rulestruct[rule_position].meta_content_case[z] == 1 )
                         {
-                            if (Sagan_stristr(syslog_msg, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i], true))
+                            if (Sagan_strnistr(syslog_msg, syslog_msg_len, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i], true))
                                 {
                                     return(true);
                                 }
                         }
                     else
                         {
-                            if (Sagan_strstr(syslog_msg, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i]))
+                            if (Sagan_strnstr(syslog_msg, syslog_msg_len, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i]))
                                 {
                                     return(true);
                                 }
@@ -84,7 +84,7 @@ int Meta_Content_Search(char *syslog_msg, int rule_position , int meta_content_c
                 {
                     if ( rulestruct[rule_position].meta_content_case[z] == 1 )
                         {
-                            if (Sagan_stristr(syslog_msg, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i], true))
+                            if (Sagan_strnistr(syslog_msg, syslog_msg_len, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i], true))
                                 {
                                     return(false);
                                 }
@@ -92,7 +92,7 @@ int Meta_Content_Search(char *syslog_msg, int rule_position , int meta_content_c
                     else
                         {
 
-                            if (Sagan_strstr(syslog_msg, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i]))
+                            if (Sagan_strnstr(syslog_msg, syslog_msg_len, rulestruct[rule_position].meta_content_containers[z].meta_content_converted[i]))
                                 {
                                     return(false);
                                 }
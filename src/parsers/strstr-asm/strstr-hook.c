@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "sagan.h"
 #include "sagan-defs.h"
@@ -85,27 +86,64 @@ char *Sagan_strstr(const char *_x, const char *_y)
  *
  * 0/FALSE == Don't convert needle
  * 1/TRUE  == Convert needle
+ *
+ * Nothing is copied.  We let strcspn() (which is vectorized in most libcs)
+ * find the next place the first byte of the needle appears,  in either
+ * case,  then fold and compare the rest in place.  The return value points
+ * into the haystack.
  */
 
 char *Sagan_stristr(const char *_x, const char *_y, sbool needle_lower )
 {
 
-    char *p = NULL;
-    char haystack_string[MAX_SYSLOGMSG] = { 0 };
-    char needle_string[512] = { 0 };
+    const unsigned char *haystack = (const unsigned char *)_x;
+    const unsigned char *needle = (const unsigned char *)_y;
+    unsigned char first;
+    char accept[3] = { 0 };
+    size_t i;
 
-    strlcpy(haystack_string, _x, sizeof(haystack_string));
-    To_LowerC(haystack_string);
+    if ( *needle == '\0' )
+        {
+            return (char *) _x;
+        }
 
-    strlcpy(needle_string, _y, sizeof(needle_string));
+    first = needle_lower ? tolower(*needle) : *needle;
 
-    if ( needle_lower ) {
-        To_LowerC(needle_string);
-    }
+    /* An upper case needle we were told was lower case can't match */
 
-    p = Sagan_strstr( haystack_string, needle_string);
+    if ( first != tolower(first) )
+        {
+            return NULL;
+        }
 
-    return p;
+    accept[0] = first;
+    accept[1] = toupper(first) != first ? toupper(first) : '\0';
+
+    for (;;)
+        {
+
+            haystack += strcspn((const char *)haystack, accept);
+
+            if ( *haystack == '\0' )
+                {
+                    return NULL;
+                }
+
+            for ( i = 1; needle[i] != '\0'; i++ )
+                {
+                    if ( tolower(haystack[i]) != ( needle_lower ? tolower(needle[i]) : needle[i] ) )
+                        {
+                            break;
+                        }
+                }
+
+            if ( needle[i] == '\0' )
+                {
+                    return (char *) haystack;
+                }
+
+            haystack++;
+        }
 
 }
 
@@ -125,3 +163,103 @@ char *Sagan_stristr(const char *_x, const char *_y, sbool needle_lower )
     return (strcasestr(_x, _y));
 }
 #endif
+
+/****************************************************************************
+ * Sagan_strnstr - Case sensitive search of the first "len" bytes of the
+ * haystack.  The haystack does not have to be NULL terminated at "len",
+ * so a content window can be searched in place rather than copied out.
+ ****************************************************************************/
+
+char *Sagan_strnstr(const char *_x, size_t len, const char *_y)
+{
+    return (memmem(_x, len, _y, strlen(_y)));
+}
+
+/****************************************************************************
+ * Sagan_strnistr - Case insensitive Sagan_strnstr().  "needle_lower" works
+ * like it does for Sagan_stristr().  memchr() finds the next candidate for
+ * each case of the first byte.  The other candidate is remembered so a
+ * common byte doesn't get rescanned for every miss.
+ ****************************************************************************/
+
+char *Sagan_strnistr(const char *_x, size_t len, const char *_y, sbool needle_lower )
+{
+
+    const unsigned char *haystack = (const unsigned char *)_x;
+    const unsigned char *needle = (const unsigned char *)_y;
+    const unsigned char *last;
+    const unsigned char *lower = NULL;
+    const unsigned char *upper = NULL;
+    const unsigned char *candidate;
+    size_t needle_len = strlen(_y);
+    unsigned char first;
+    unsigned char first_upper;
+    size_t i;
+
+    if ( needle_len == 0 )
+        {
+            return (char *) _x;
+        }
+
+    if ( needle_len > len )
+        {
+            return NULL;
+        }
+
+    first = needle_lower ? tolower(*needle) : *needle;
+
+    if ( first != tolower(first) )
+        {
+            return NULL;
+        }
+
+    first_upper = toupper(first);
+    last = haystack + ( len - needle_len );		/* Last place a match can start */
+
+    while ( haystack <= last )
+        {
+
+            if ( lower < haystack )
+                {
+                    lower = memchr(haystack, first, last - haystack + 1);
+                    lower = lower == NULL ? last + 1 : lower;
+                }
+
+            candidate = lower;
+
+            if ( first_upper != first )
+                {
+
+                    if ( upper < haystack )
+                        {
+                            upper = memchr(haystack, first_upper, last - haystack + 1);
+                            upper = upper == NULL ? last + 1 : upper;
+                        }
+
+                    candidate = upper < candidate ? upper : candidate;
+                }
+
+            if ( candidate > last )
+                {
+                    return NULL;
+                }
+
+            for ( i = 1; i < needle_len; i++ )
+                {
+                    if ( tolower(candidate[i]) != ( needle_lower ? tolower(needle[i]) : needle[i] ) )
+                        {
+                            break;
+                        }
+                }
+
+            if ( i == needle_len )
+                {
+                    return (char *) candidate;
+                }
+
+            haystack = candidate + 1;
+        }
+
+    return NULL;
+
+}
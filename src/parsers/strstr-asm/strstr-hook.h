@@ -44,4 +44,6 @@ int __strstr_sse42();
 
 char *Sagan_strstr(const char *, const char *);
 char *Sagan_stristr(const char *, const char *, sbool);
+char *Sagan_strnstr(const char *, size_t, const char *);
+char *Sagan_strnistr(const char *, size_t, const char *, sbool);
 
@@ -41,139 +41,249 @@
 #include "sagan-defs.h"
 #include "ignore-list.h"
 #include "sagan-config.h"
+#include "work-queue.h"
+#include "processor.h"
+#include "util-time.h"
 #include "parsers/parsers.h"
 
 #include "processors/engine.h"
 #include "processors/track-clients.h"
 #include "processors/blacklist.h"
 #include "processors/dynamic-rules.h"
+#include "alloc-count.h"
 
 struct _Sagan_Ignorelist *SaganIgnorelist;
 struct _SaganCounters *counters;
-struct _Sagan_Proc_Syslog *SaganProcSyslog;
+struct _Sagan_Work_Queue **SaganWorkQueues;
 struct _SaganConfig *config;
 struct _Rule_Struct *rulestruct;
 
-int proc_msgslot; 		/* Comes from sagan.c */
 int proc_running;       /* Comes from sagan.c */
+int work_queue_count;   /* Comes from sagan.c */
 unsigned char dynamic_rule_flag; /* Comes from sagan.c */
 
-pthread_cond_t SaganProcDoWork;
 pthread_mutex_t SaganProcWorkMutex;
 
 pthread_cond_t SaganReloadCond;
-pthread_mutex_t SaganReloadMutex;
+pthread_cond_t SaganProcIdleCond;
 
 pthread_mutex_t SaganDynamicFlag;
 
 pthread_mutex_t SaganIgnoreCounter=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t SaganClientTracker=PTHREAD_MUTEX_INITIALIZER;
 
+static int processor_next = 0;		/* Hands out a queue to each worker */
+
 
 void Processor ( void )
 {
 
     (void)SetThreadName("SaganWorker");
 
-    struct _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL = NULL;
-    SaganProcSyslog_LOCAL = malloc(sizeof(struct _Sagan_Proc_Syslog));
+    struct _Sagan_Proc_Syslog **SaganProcSyslog_BATCH = NULL;
+
+    /* Unless "queue-shard" is set,  there is only one queue and everyone
+     * shares it */
+
+    _Sagan_Work_Queue *queue = SaganWorkQueues[ __atomic_fetch_add(&processor_next, 1, __ATOMIC_RELAXED) % work_queue_count ];
 
-    if ( SaganProcSyslog_LOCAL == NULL )
+    /* Pointers to events in the work queue's pool.  They are traded for
+     * new ones on every dequeue,  never copied */
+
+    SaganProcSyslog_BATCH = malloc(config->sagan_queue_batch * sizeof(struct _Sagan_Proc_Syslog *));
+
+    if ( SaganProcSyslog_BATCH == NULL )
         {
-            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for SaganProcSyslog_LOCAL. Abort!", __FILE__, __LINE__);
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for SaganProcSyslog_BATCH. Abort!", __FILE__, __LINE__);
         }
 
-    memset(SaganProcSyslog_LOCAL, 0, sizeof(struct _Sagan_Proc_Syslog));
+    Work_Queue_Spares(queue, SaganProcSyslog_BATCH, config->sagan_queue_batch);
 
-    sbool ignore_flag = false;
-
-    int i;
+    int b;
+    int batch_count;
 
     for (;;)
         {
 
-            pthread_mutex_lock(&SaganProcWorkMutex);
+            /* Pull as many events as are waiting (up to queue-batch).  This
+             * sleeps if the queue is empty */
+
+            batch_count = Work_Queue_Dequeue(queue, SaganProcSyslog_BATCH, config->sagan_queue_batch);
 
-            while ( proc_msgslot == 0 ) pthread_cond_wait(&SaganProcDoWork, &SaganProcWorkMutex);
+            Processor_Work_Start();
 
-            if ( config->sagan_reload )
+            for ( b = 0; b < batch_count; b++ )
                 {
-                    pthread_cond_wait(&SaganReloadCond, &SaganReloadMutex);
+                    Processor_Event(SaganProcSyslog_BATCH[b]);
                 }
 
-            proc_running++;
-            proc_msgslot--;	/* This was ++ before coming over, so we now -- it to get to
-					 * original value */
+            Work_Queue_Done(queue, batch_count);
 
-            strlcpy(SaganProcSyslog_LOCAL->syslog_host, SaganProcSyslog[proc_msgslot].syslog_host, sizeof(SaganProcSyslog_LOCAL->syslog_host));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_facility, SaganProcSyslog[proc_msgslot].syslog_facility, sizeof(SaganProcSyslog_LOCAL->syslog_facility));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_priority, SaganProcSyslog[proc_msgslot].syslog_priority, sizeof(SaganProcSyslog_LOCAL->syslog_priority));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_level, SaganProcSyslog[proc_msgslot].syslog_level, sizeof(SaganProcSyslog_LOCAL->syslog_level));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_tag, SaganProcSyslog[proc_msgslot].syslog_tag, sizeof(SaganProcSyslog_LOCAL->syslog_tag));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_date, SaganProcSyslog[proc_msgslot].syslog_date, sizeof(SaganProcSyslog_LOCAL->syslog_date));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_time, SaganProcSyslog[proc_msgslot].syslog_time, sizeof(SaganProcSyslog_LOCAL->syslog_time));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_program, SaganProcSyslog[proc_msgslot].syslog_program, sizeof(SaganProcSyslog_LOCAL->syslog_program));
-            strlcpy(SaganProcSyslog_LOCAL->syslog_message, SaganProcSyslog[proc_msgslot].syslog_message, sizeof(SaganProcSyslog_LOCAL->syslog_message));
+            Processor_Work_Done();
+        } //  for (;;)
 
-            pthread_mutex_unlock(&SaganProcWorkMutex);
+    Sagan_Log(S_WARN, "[%s, line %d] Holy cow! You should never see this message!", __FILE__, __LINE__);
+    free(SaganProcSyslog_BATCH);		/* Should never make it here */
+}
 
-            /* Check for general "drop" items.  We do this first so we can save CPU later */
+/****************************************************************************
+ * Processor_Work_Start - Called by a worker before it runs events.  While
+ * the rules are being reloaded,  this waits for the reload to finish.
+ ****************************************************************************/
 
-            if ( config->sagan_droplist_flag )
-                {
+void Processor_Work_Start( void )
+{
 
-                    ignore_flag = false;
+    pthread_mutex_lock(&SaganProcWorkMutex);
 
-                    for (i = 0; i < counters->droplist_count; i++)
-                        {
+    while ( config->sagan_reload )
+        {
+            pthread_cond_wait(&SaganReloadCond, &SaganProcWorkMutex);
+        }
 
-                            if (Sagan_strstr(SaganProcSyslog_LOCAL->syslog_message, SaganIgnorelist[i].ignore_string))
-                                {
+    proc_running++;
+    pthread_mutex_unlock(&SaganProcWorkMutex);
 
-                                    pthread_mutex_lock(&SaganIgnoreCounter);
-                                    counters->ignore_count++;
-                                    pthread_mutex_unlock(&SaganIgnoreCounter);
+}
 
-                                    ignore_flag = true;
-                                    goto outside_loop;	/* Stop processing from ignore list */
-                                }
-                        }
-                }
+/****************************************************************************
+ * Processor_Work_Done - Called by a worker once it is done with the rules
+ * (the end of a batch or chunk)
+ ****************************************************************************/
 
-outside_loop:
+void Processor_Work_Done( void )
+{
 
-            /* If we're in a ignore state,  then we can bypass the processors */
+    pthread_mutex_lock(&SaganProcWorkMutex);
 
-            if ( ignore_flag == false )
-                {
+    proc_running--;
 
-                    Sagan_Engine(SaganProcSyslog_LOCAL, dynamic_rule_flag );
+    if ( proc_running == 0 )
+        {
+            pthread_cond_broadcast(&SaganProcIdleCond);
+        }
 
-                    /* If this is a dynamic run,  reset back to normal */
+    pthread_mutex_unlock(&SaganProcWorkMutex);
 
-                    if ( dynamic_rule_flag == DYNAMIC_RULE )
-                        {
+}
 
-                            pthread_mutex_lock(&SaganDynamicFlag);
-                            dynamic_rule_flag = 0;
-                            pthread_mutex_unlock(&SaganDynamicFlag);
+/****************************************************************************
+ * Processor_Pause - Stops workers from starting on more events and waits
+ * for the running ones to finish.  After this nothing is using the rules,
+ * the rule index or the rule pool,  so a reload can free them.
+ ****************************************************************************/
 
-                        }
+void Processor_Pause( void )
+{
+
+    pthread_mutex_lock(&SaganProcWorkMutex);
+
+    config->sagan_reload = true;
+
+    while ( proc_running != 0 )
+        {
+            pthread_cond_wait(&SaganProcIdleCond, &SaganProcWorkMutex);
+        }
 
-                    if ( config->sagan_track_clients_flag )
+    pthread_mutex_unlock(&SaganProcWorkMutex);
+
+}
+
+/****************************************************************************
+ * Processor_Resume - Lets the workers go again after Processor_Pause()
+ ****************************************************************************/
+
+void Processor_Resume( void )
+{
+
+    pthread_mutex_lock(&SaganProcWorkMutex);
+
+    config->sagan_reload = false;
+    pthread_cond_broadcast(&SaganReloadCond);
+
+    pthread_mutex_unlock(&SaganProcWorkMutex);
+
+}
+
+/****************************************************************************
+ * Processor_Event - Runs one event through the drop list,  the engine and
+ * client tracking.  Used by the worker threads,  and by the -P/--parallel
+ * file workers that don't go through the work queue.
+ ****************************************************************************/
+
+void Processor_Event( struct _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL )
+{
+
+    sbool ignore_flag = false;
+    int i;
+
+#ifdef WITH_ALLOC_COUNT
+    uint64_t allocs = Alloc_Count();
+#endif
+
+    /* In replay mode "now" is when the event was logged */
+
+    if ( config->replay_flag )
+        {
+            Sagan_Event_Time(SaganProcSyslog_LOCAL->syslog_utime);
+        }
+
+    /* Check for general "drop" items.  We do this first so we can save CPU later */
+
+    if ( config->sagan_droplist_flag )
+        {
+
+            for (i = 0; i < counters->droplist_count; i++)
+                {
+
+                    if (Sagan_strstr(SaganProcSyslog_LOCAL->syslog_message, SaganIgnorelist[i].ignore_string))
                         {
-                            Track_Clients( SaganProcSyslog_LOCAL->syslog_host );
+
+                            pthread_mutex_lock(&SaganIgnoreCounter);
+                            counters->ignore_count++;
+                            pthread_mutex_unlock(&SaganIgnoreCounter);
+
+                            ignore_flag = true;
+                            break;	/* Stop processing from ignore list */
                         }
+                }
+        }
 
-                } // End if if (ignore_Flag)
+    /* If we're in a ignore state,  then we can bypass the processors */
 
+    if ( ignore_flag == false )
+        {
 
-            pthread_mutex_lock(&SaganProcWorkMutex);
-            proc_running--;
-            pthread_mutex_unlock(&SaganProcWorkMutex);
-        } //  for (;;)
+            Sagan_Engine(SaganProcSyslog_LOCAL, dynamic_rule_flag );
+
+            /* If this is a dynamic run,  reset back to normal */
+
+            if ( dynamic_rule_flag == DYNAMIC_RULE )
+                {
+
+                    pthread_mutex_lock(&SaganDynamicFlag);
+                    dynamic_rule_flag = 0;
+                    pthread_mutex_unlock(&SaganDynamicFlag);
+
+                }
+
+            if ( config->sagan_track_clients_flag )
+                {
+                    Track_Clients( SaganProcSyslog_LOCAL->syslog_host );
+                }
+
+        } // End if if (ignore_Flag)
+
+#ifdef WITH_ALLOC_COUNT
+
+    allocs = Alloc_Count() - allocs;
+
+    if ( allocs != 0 )
+        {
+            __atomic_add_fetch(&counters->event_alloc_total, allocs, __ATOMIC_RELAXED);
+        }
+
+#endif
 
-    Sagan_Log(S_WARN, "[%s, line %d] Holy cow! You should never see this message!", __FILE__, __LINE__);
-    free(SaganProcSyslog_LOCAL);		/* Should never make it here */
 }
 
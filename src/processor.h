@@ -24,3 +24,8 @@
 
 
 void Processor ( void );
+void Processor_Event( struct _Sagan_Proc_Syslog * );
+void Processor_Work_Start( void );
+void Processor_Work_Done( void );
+void Processor_Pause( void );
+void Processor_Resume( void );
@@ -41,6 +41,7 @@
 #include "sagan.h"
 #include "sagan-defs.h"
 #include "sagan-config.h"
+#include "event-context.h"
 
 #include "processors/blacklist.h"
 
@@ -275,24 +276,27 @@ sbool Sagan_Blacklist_IPADDR ( unsigned char *ipaddr )
  * blacklist IP's in memory!
  ***************************************************************************/
 
-sbool Sagan_Blacklist_IPADDR_All ( char *syslog_message, _Sagan_Lookup_Cache_Entry *lookup_cache, size_t cache_size)
+sbool Sagan_Blacklist_IPADDR_All ( _Sagan_Event_Context *ctx )
 {
 
     int i;
     int b;
 
+    char *ipaddr = NULL;
     unsigned char ip[MAXIPBIT] = { 0 };
 
-    for (i = 0; i < cache_size; i++)
+    for (i = 1; i <= MAX_PARSE_IP; i++)
         {
 
+            ipaddr = Event_Context_IP(ctx, i);
+
             /* Failed to find next IP,  short circuit the process */
-            if ((lookup_cache[i].searched && 0 == lookup_cache[i].offset) || !Parse_IP(syslog_message, i+1, NULL, sizeof(lookup_cache[i].ip), lookup_cache, cache_size))
+            if ( ipaddr[0] == '\0' )
                 {
                     return(false);
                 }
 
-            if (!IP2Bit(lookup_cache[i].ip, ip))
+            if (!Event_Context_IP_Bits(ctx, ipaddr, ip))
                 {
                     continue;
                 }
@@ -46,6 +46,7 @@
 #include "sagan-defs.h"
 #include "sagan-config.h"
 #include "rules.h"
+#include "event-context.h"
 
 #include "processors/bluedot.h"
 
@@ -1446,26 +1447,29 @@ int Sagan_Bluedot_Cat_Compare ( unsigned char bluedot_results, int rule_position
  * message and preforms a Bluedot query.
  ***************************************************************************/
 
-int Sagan_Bluedot_IP_Lookup_All ( char *syslog_message, int rule_position, _Sagan_Lookup_Cache_Entry *lookup_cache, size_t cache_size)
+int Sagan_Bluedot_IP_Lookup_All ( _Sagan_Event_Context *ctx, int rule_position )
 {
 
     int i;
-    int j;
+
+    char *ipaddr = NULL;
 
     unsigned char bluedot_results;
     sbool bluedot_flag;
 
 
-    for (i = 0; i < cache_size; i++)
+    for (i = 1; i <= MAX_PARSE_IP; i++)
         {
 
+            ipaddr = Event_Context_IP(ctx, i);
+
             /* Failed to find next IP,  short circuit the process */
-            if ((lookup_cache[i].searched && 0 == lookup_cache[i].offset) || !Parse_IP(syslog_message, i+1, NULL, sizeof(lookup_cache[i].ip), lookup_cache, cache_size))
+            if ( ipaddr[0] == '\0' )
                 {
                     return(false);
                 }
 
-            bluedot_results = Sagan_Bluedot_Lookup(lookup_cache[i].ip, BLUEDOT_LOOKUP_IP, rule_position);
+            bluedot_results = Sagan_Bluedot_Lookup(ipaddr, BLUEDOT_LOOKUP_IP, rule_position);
             bluedot_flag = Sagan_Bluedot_Cat_Compare( bluedot_results, rule_position, BLUEDOT_LOOKUP_IP );
 
             if ( bluedot_flag == 1 )
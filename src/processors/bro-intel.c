@@ -43,6 +43,7 @@
 #include "sagan.h"
 #include "sagan-defs.h"
 #include "sagan-config.h"
+#include "event-context.h"
 
 #include "parsers/parsers.h"
 
@@ -664,24 +665,27 @@ sbool Sagan_BroIntel_IPADDR ( unsigned char *ip )
  * a syslog_message (reguardless of lognorm/parse ip)!
  *****************************************************************************/
 
-sbool Sagan_BroIntel_IPADDR_All ( char *syslog_message, _Sagan_Lookup_Cache_Entry *lookup_cache, size_t cache_size)
+sbool Sagan_BroIntel_IPADDR_All ( _Sagan_Event_Context *ctx )
 {
 
     int i;
     int b;
 
+    char *ipaddr = NULL;
     unsigned char ip[MAXIPBIT] = {0};
 
-    for (i = 0; i < cache_size; i++)
+    for (i = 1; i <= MAX_PARSE_IP; i++)
         {
 
+            ipaddr = Event_Context_IP(ctx, i);
+
             /* Failed to find next IP,  short circuit the process */
-            if ((lookup_cache[i].searched && 0 == lookup_cache[i].offset) || !Parse_IP(syslog_message, i+1, NULL, sizeof(lookup_cache[i].ip), lookup_cache, cache_size))
+            if ( ipaddr[0] == '\0' )
                 {
                     return(false);
                 }
 
-            if (!IP2Bit(lookup_cache[i].ip, ip))
+            if (!Event_Context_IP_Bits(ctx, ipaddr, ip))
                 {
                     continue;
                 }
@@ -704,7 +708,7 @@ sbool Sagan_BroIntel_IPADDR_All ( char *syslog_message, _Sagan_Lookup_Cache_Entr
  * Sagan_BroIntel_DOMAIN - Search DOMAIN array
  *****************************************************************************/
 
-sbool Sagan_BroIntel_DOMAIN ( char *syslog_message )
+sbool Sagan_BroIntel_DOMAIN ( const char *syslog_message_lower )
 {
 
     int i;
@@ -712,7 +716,7 @@ sbool Sagan_BroIntel_DOMAIN ( char *syslog_message )
     for ( i = 0; i < counters->brointel_domain_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_Domain[i].domain, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_Domain[i].domain) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -732,7 +736,7 @@ sbool Sagan_BroIntel_DOMAIN ( char *syslog_message )
  * Sagan_BroIntel_FILE_HASH - Search FILE_HASH array
  *****************************************************************************/
 
-sbool Sagan_BroIntel_FILE_HASH ( char *syslog_message )
+sbool Sagan_BroIntel_FILE_HASH ( const char *syslog_message_lower )
 {
 
     int i;
@@ -740,7 +744,7 @@ sbool Sagan_BroIntel_FILE_HASH ( char *syslog_message )
     for ( i = 0; i < counters->brointel_file_hash_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_File_Hash[i].hash, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_File_Hash[i].hash) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -760,7 +764,7 @@ sbool Sagan_BroIntel_FILE_HASH ( char *syslog_message )
  * Sagan_BroIntel_URL - Search URL array
  *****************************************************************************/
 
-sbool Sagan_BroIntel_URL ( char *syslog_message )
+sbool Sagan_BroIntel_URL ( const char *syslog_message_lower )
 {
 
     int i;
@@ -768,7 +772,7 @@ sbool Sagan_BroIntel_URL ( char *syslog_message )
     for ( i = 0; i < counters->brointel_url_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_URL[i].url, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_URL[i].url) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -787,7 +791,7 @@ sbool Sagan_BroIntel_URL ( char *syslog_message )
  * Sagan_BroIntel_SOFTWARE - Search SOFTWARE array
  ****************************************************************************/
 
-sbool Sagan_BroIntel_SOFTWARE ( char *syslog_message )
+sbool Sagan_BroIntel_SOFTWARE ( const char *syslog_message_lower )
 {
 
     int i;
@@ -795,7 +799,7 @@ sbool Sagan_BroIntel_SOFTWARE ( char *syslog_message )
     for ( i = 0; i < counters->brointel_software_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_Software[i].software, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_Software[i].software) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -814,7 +818,7 @@ sbool Sagan_BroIntel_SOFTWARE ( char *syslog_message )
  * Sagan_BroIntel_EMAIL - Search EMAIL array
  *****************************************************************************/
 
-sbool Sagan_BroIntel_EMAIL ( char *syslog_message )
+sbool Sagan_BroIntel_EMAIL ( const char *syslog_message_lower )
 {
 
     int i;
@@ -822,7 +826,7 @@ sbool Sagan_BroIntel_EMAIL ( char *syslog_message )
     for ( i = 0; i < counters->brointel_email_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_Email[i].email, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_Email[i].email) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -841,7 +845,7 @@ sbool Sagan_BroIntel_EMAIL ( char *syslog_message )
  * Sagan_BroIntel_USER_NAME - Search USER_NAME array
  ****************************************************************************/
 
-sbool Sagan_BroIntel_USER_NAME ( char *syslog_message )
+sbool Sagan_BroIntel_USER_NAME ( const char *syslog_message_lower )
 {
 
     int i;
@@ -849,7 +853,7 @@ sbool Sagan_BroIntel_USER_NAME ( char *syslog_message )
     for ( i = 0; i < counters->brointel_user_name_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_User_Name[i].username, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_User_Name[i].username) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -868,7 +872,7 @@ sbool Sagan_BroIntel_USER_NAME ( char *syslog_message )
  * Sagan_BroIntel_FILE_NAME - Search FILE_NAME array
  ****************************************************************************/
 
-sbool Sagan_BroIntel_FILE_NAME ( char *syslog_message )
+sbool Sagan_BroIntel_FILE_NAME ( const char *syslog_message_lower )
 {
 
     int i;
@@ -876,7 +880,7 @@ sbool Sagan_BroIntel_FILE_NAME ( char *syslog_message )
     for ( i = 0; i < counters->brointel_file_name_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_File_Name[i].file_name, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_File_Name[i].file_name) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -895,7 +899,7 @@ sbool Sagan_BroIntel_FILE_NAME ( char *syslog_message )
  * Sagan_BroIntel_CERT_HASH - Search CERT_HASH array
  ***************************************************************************/
 
-sbool Sagan_BroIntel_CERT_HASH ( char *syslog_message )
+sbool Sagan_BroIntel_CERT_HASH ( const char *syslog_message_lower )
 {
 
     int i;
@@ -903,7 +907,7 @@ sbool Sagan_BroIntel_CERT_HASH ( char *syslog_message )
     for ( i = 0; i < counters->brointel_cert_hash_count; i++)
         {
 
-            if ( Sagan_stristr(syslog_message, Sagan_BroIntel_Intel_Cert_Hash[i].cert_hash, false) )
+            if ( Sagan_strstr(syslog_message_lower, Sagan_BroIntel_Intel_Cert_Hash[i].cert_hash) )
                 {
                     if ( debug->debugbrointel )
                         {
@@ -99,14 +99,14 @@ void Sagan_BroIntel_Init(void);
 void Sagan_BroIntel_Load_File(void);
 
 sbool  Sagan_BroIntel_IPADDR ( unsigned char * );
-sbool  Sagan_BroIntel_IPADDR_All ( char *, _Sagan_Lookup_Cache_Entry *, size_t);
-
-sbool  Sagan_BroIntel_DOMAIN ( char * );
-sbool  Sagan_BroIntel_FILE_HASH ( char * );
-sbool  Sagan_BroIntel_URL ( char * );
-sbool  Sagan_BroIntel_SOFTWARE( char * );
-sbool  Sagan_BroIntel_EMAIL( char * );
-sbool  Sagan_BroIntel_USER_NAME ( char * );
-sbool  Sagan_BroIntel_FILE_NAME ( char * );
-sbool  Sagan_BroIntel_CERT_HASH ( char * );
+sbool  Sagan_BroIntel_IPADDR_All ( struct _Sagan_Event_Context * );
+
+sbool  Sagan_BroIntel_DOMAIN ( const char * );
+sbool  Sagan_BroIntel_FILE_HASH ( const char * );
+sbool  Sagan_BroIntel_URL ( const char * );
+sbool  Sagan_BroIntel_SOFTWARE( const char * );
+sbool  Sagan_BroIntel_EMAIL( const char * );
+sbool  Sagan_BroIntel_USER_NAME ( const char * );
+sbool  Sagan_BroIntel_FILE_NAME ( const char * );
+sbool  Sagan_BroIntel_CERT_HASH ( const char * );
 
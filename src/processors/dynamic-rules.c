@@ -39,7 +39,10 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "rules.h"
+#include "rules-index.h"
+#include "rule-pool.h"
 #include "sagan-config.h"
 #include "send-alert.h"
 
@@ -49,6 +52,7 @@ struct _SaganConfig *config;
 struct _Rule_Struct *rulestruct;
 struct _Rules_Loaded *rules_loaded;
 struct _SaganCounters *counters;
+struct _SaganDebug *debug;
 
 sbool reload_rules;
 
@@ -111,7 +115,7 @@ int Sagan_Dynamic_Rules ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, int rule_po
 
             Sagan_Log(S_NORMAL, "Detected dynamic signature '%s'. Dynamically loading '%s'.", rulestruct[rule_position].s_msg, rulestruct[rule_position].dynamic_ruleset);
 
-            gettimeofday(&tp, 0);
+            Sagan_Event_Timeval(&tp);
 
             /* Process the alert _before_ loading rule set! Otherwise, mem will mismatch */
             Send_Alert(SaganProcSyslog_LOCAL,
@@ -133,6 +137,12 @@ int Sagan_Dynamic_Rules ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, int rule_po
             reload_rules = 1;
 
             Load_Rules(rulestruct[rule_position].dynamic_ruleset);
+            Rule_Index_Build();
+
+            if ( debug->debugload )
+                {
+                    Rule_Pool_Report();
+                }
 
             reload_rules = 0;
             pthread_mutex_unlock(&SaganRulesLoadedMutex);
@@ -160,7 +170,7 @@ int Sagan_Dynamic_Rules ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, int rule_po
             Sagan_Log(S_NORMAL, "Detected dynamic signature '%s'. Sagan would automatically load '%s' but the 'dynamic_load' processor is set to 'alert'.", rulestruct[rule_position].s_msg, rulestruct[rule_position].dynamic_ruleset);
 
 
-            gettimeofday(&tp, 0);
+            Sagan_Event_Timeval(&tp);
 
             Send_Alert(SaganProcSyslog_LOCAL,
                        NULL,
@@ -40,12 +40,18 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "aetas.h"
 #include "meta-content.h"
 #include "send-alert.h"
 #include "xbit.h"
 #include "xbit-mmap.h"
 #include "rules.h"
+#include "rules-index.h"
+#include "util-pcre.h"
+#include "event-context.h"
+#include "rule-profile.h"
+#include "rule-adaptive.h"
 #include "sagan-config.h"
 #include "ipc.h"
 #include "check-flow.h"
@@ -76,6 +82,8 @@ struct _Rule_Struct *rulestruct;
 struct _SaganDebug *debug;
 struct _SaganConfig *config;
 
+_Rule_Index *SaganRuleIndex;
+
 struct _Sagan_IPC_Counters *counters_ipc;
 
 pthread_mutex_t CounterFollowFlowDrop=PTHREAD_MUTEX_INITIALIZER;
@@ -83,22 +91,253 @@ pthread_mutex_t CountersFlowFlowTotal=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t CountersGeoIPHit=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t CounterSaganFoundMutex=PTHREAD_MUTEX_INITIALIZER;
 
-void Sagan_Engine_Init ( void )
+/****************************************************************************
+ * Sagan_Engine_Window - Works out the part of the message a content or
+ * meta_content is searched in,  from its offset/depth/distance/within.
+ * The window is returned as a pointer into the message and a length;
+ * nothing is copied.  "prev_depth" is the depth of the content before
+ * this one,  which distance is measured from.
+ ****************************************************************************/
+
+static const char *Sagan_Engine_Window( const char *message, size_t message_len, int offset, int depth, int distance, int prev_depth, int within, size_t *window_len )
 {
 
+    const char *window = message;
+    size_t start = 0;
+
+    *window_len = message_len;
+
+    /* OFFSET */
+
+    if ( offset != 0 )
+        {
+
+            if ( message_len > (size_t)offset )
+                {
+                    window = message + offset;
+                    *window_len = message_len - offset;
+                }
+            else
+                {
+                    *window_len = 0; 	/* The offset is larger than the message */
+                }
+
+        }
+
+    /* DEPTH.  +1 to account for the whitespace at the beginning of the syslog message */
+
+    if ( depth != 0 && *window_len > (size_t)depth + 1 )
+        {
+            *window_len = depth + 1;
+        }
+
+    /* DISTANCE is from the end of the last content's depth,  not from
+     * the offset/depth above */
+
+    if ( distance != 0 )
+        {
+
+            start = prev_depth + distance + 1;
+
+            if ( message_len > start )
+                {
+                    window = message + start;
+                    *window_len = message_len - start;
+                }
+            else
+                {
+                    window = message + message_len;
+                    *window_len = 0;
+                }
+
+            /* WITHIN */
+
+            if ( within != 0 && *window_len > (size_t)within )
+                {
+                    *window_len = within;
+                }
+
+        }
+
+    return(window);
+
 }
 
-int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule_flag )
+/****************************************************************************
+ * Sagan_Engine_Check - Runs one op (a content,  pcre or meta_content) of
+ * rule 'b'.  Returns true if it passed (for "content: !",  if the content
+ * isn't there)
+ ****************************************************************************/
+
+static sbool Sagan_Engine_Check( int b, const _Rule_Index_Op *op, const char *strings, const char *message, size_t message_len )
+{
+
+    const char *window = NULL;
+    size_t window_len = 0;
+    sbool found = false;
+
+    switch ( op->type )
+        {
+
+        case RULE_OP_CONTENT:
+
+            window = Sagan_Engine_Window(message, message_len, op->offset, op->depth,
+                                         op->distance, op->prev_depth, op->within, &window_len);
+
+            if ( op->nocase == 1 )
+                {
+                    found = Sagan_strnistr(window, window_len, strings + op->string, false) != NULL;
+                }
+            else
+                {
+                    found = Sagan_strnstr(window, window_len, strings + op->string) != NULL;
+                }
+
+            /* for content: !,  the content must not be found */
+
+            return( found != op->not );
+
+        case RULE_OP_PCRE:
+
+            return( PCRE_Match(b, op->index, message, message_len) > 0 );
+
+        case RULE_OP_META_CONTENT:
+
+            window = Sagan_Engine_Window(message, message_len, op->offset, op->depth,
+                                         op->distance, op->prev_depth, op->within, &window_len);
+
+            return( Meta_Content_Search(window, window_len, b, op->index) == true );
+
+        }
+
+    return(false);
+
+}
+
+/****************************************************************************
+ * Sagan_Engine_Run - Runs a rule's ops until one fails.  Without
+ * "rule-adaptive" ('adaptive' is NULL) that's content,  pcre then
+ * meta_content,  as they are in the rule.  Otherwise it's the order
+ * rule-adaptive.c has worked out.  They all have to pass,  so the order
+ * doesn't change the outcome.  Returns how many passed.
+ ****************************************************************************/
+
+static int Sagan_Engine_Run( int b, const _Rule_Index_Rule *rule, const _Rule_Index_Op *code, const char *strings, _Rule_Adaptive *adaptive, const char *message, size_t message_len, _Rule_Profile *profile )
 {
 
-    struct _Sagan_Processor_Info *processor_info_engine = NULL;
-    processor_info_engine = malloc(sizeof(struct _Sagan_Processor_Info));
+    _Rule_Adaptive_Check *check = NULL;
+    const _Rule_Index_Op *op = NULL;
+    sbool sample = false;
+    struct timespec start;
+
+    int evaluated[RULE_OP_TYPES] = { 0 };
+    sbool failed[RULE_OP_TYPES] = { false };
+    uint64_t *pass_count[RULE_OP_TYPES];
+    uint64_t *fail_count[RULE_OP_TYPES];
+    int passed = 0;
+    int i;
+
+    sbool pass = false;
+
+    if ( adaptive != NULL )
+        {
+            check = Rule_Adaptive_Checks(adaptive);
+            sample = Rule_Adaptive_Sample(adaptive);
+        }
+
+    for ( i = 0; i < rule->code_count; i++ )
+        {
+
+            /* Samples run every check,  so we learn about the ones that
+             * normally don't get the chance */
 
-    if ( processor_info_engine == NULL )
+            if ( sample == true )
+                {
+                    op = &code[check[i].index];
+                    Rule_Adaptive_Start(&start);
+                    pass = Sagan_Engine_Check(b, op, strings, message, message_len);
+                    Rule_Adaptive_Stop(&check[i], &start, pass);
+                }
+            else
+                {
+                    op = check != NULL ? &code[check[i].index] : &code[i];
+                    pass = Sagan_Engine_Check(b, op, strings, message, message_len);
+                }
+
+            evaluated[op->type]++;
+
+            if ( pass == true )
+                {
+                    passed++;
+                }
+            else
+                {
+
+                    failed[op->type] = true;
+
+                    /* Once one fails,  the rest can't change the outcome */
+
+                    if ( sample == false )
+                        {
+                            break;
+                        }
+                }
+        }
+
+    if ( adaptive != NULL )
+        {
+            Rule_Adaptive_Done(adaptive);
+        }
+
+    /* "rule-profiling".  A type passes if all of it ran and passed */
+
+    if ( profile != NULL )
         {
-            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for processor_info_engine. Abort!", __FILE__, __LINE__);
+
+            pass_count[RULE_OP_CONTENT] = &profile->content_pass;
+            pass_count[RULE_OP_PCRE] = &profile->pcre_pass;
+            pass_count[RULE_OP_META_CONTENT] = &profile->meta_content_pass;
+
+            fail_count[RULE_OP_CONTENT] = &profile->content_fail;
+            fail_count[RULE_OP_PCRE] = &profile->pcre_fail;
+            fail_count[RULE_OP_META_CONTENT] = &profile->meta_content_fail;
+
+            for ( i = 0; i < RULE_OP_TYPES; i++ )
+                {
+
+                    if ( rule->op_count[i] == 0 || ( failed[i] == false && evaluated[i] != rule->op_count[i] ) )
+                        {
+                            continue;
+                        }
+
+                    if ( failed[i] == true )
+                        {
+                            (*fail_count[i])++;
+                        }
+                    else
+                        {
+                            (*pass_count[i])++;
+                        }
+                }
         }
 
+    return(passed);
+
+}
+
+void Sagan_Engine_Init ( void )
+{
+
+}
+
+int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule_flag )
+{
+
+    /* Only lives as long as the event,  so each worker reuses its own */
+
+    static __thread struct _Sagan_Processor_Info processor_info_engine_local;
+    struct _Sagan_Processor_Info *processor_info_engine = &processor_info_engine_local;
+
     memset(processor_info_engine, 0, sizeof(_Sagan_Processor_Info));
 
     int processor_info_engine_src_port = 0;
@@ -112,16 +351,24 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
     int threadid = 0;
 
     int b = 0;
-    int z = 0;
+
+    _Rule_Index *rule_index = __atomic_load_n(&SaganRuleIndex, __ATOMIC_ACQUIRE);
+    _Rule_Index_Program *rule_program = NULL;
+    int rule_program_count = 0;
+    int g = 0;
+    int p = 0;
+    int h = 0;
+    int header_id[RULE_INDEX_HEADER_COUNT];
+    uint64_t *prefilter = NULL;
+    uint64_t *programs = NULL;
+    sbool program_indexed = false;
 
     sbool match = false;
     int sagan_match = 0;				/* Used to determine if all has "matched" (content, pcre, meta_content, etc) */
 
-    int rc = 0;
-    int ovector[PCRE_OVECCOUNT];
+    size_t message_len = 0;
 
-    int alter_num = 0;
-    int meta_alter_num = 0;
+    _Rule_Adaptive *adaptive = NULL;
 
     sbool xbit_return = 0;
     sbool xbit_count_return = 0;
@@ -129,24 +376,20 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
     sbool alert_time_trigger = false;
     sbool check_flow_return = true;  /* 1 = match, 0 = no match */
 
-    char *ptmp;
-    char *tok2;
-
     /* We don't tie these to HAVE_LIBMAXMINDDB because we might have other
      * methods to extract the informaton */
 
     char *pnormalize_selector = NULL;
 
-    int check_pos = 0;
-    struct _Sagan_Lookup_Cache_Entry lookup_cache[MAX_PARSE_IP] = { 0 };
+    /* Everything parsed out of the event,  shared by all rules */
+
+    static __thread _Sagan_Event_Context event_context;
+    _Sagan_Event_Context *ctx = &event_context;
 
-    ptrdiff_t ip_parse_cache_used[MAX_PARSE_IP];
+    /* "rule-profiling" */
 
-    char parse_ip_src[MAXIP] = { 0 };
-    char parse_ip_dst[MAXIP] = { 0 };
-    char parse_md5_hash[MD5_HASH_SIZE+1] = { 0 };
-    char parse_sha1_hash[SHA1_HASH_SIZE+1] = { 0 };
-    char parse_sha256_hash[SHA256_HASH_SIZE+1] = { 0 };
+    _Rule_Profile *profile = NULL;
+    struct timespec profile_start;
 
     sbool ip_src_flag = false;
 
@@ -158,10 +401,7 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
     uint32_t ip_dstport_u32 = 0;
     unsigned char ip_dst_bits[MAXIPBIT] = { 0 };
 
-    char tmpbuf[128];
     char s_msg[1024];
-    char alter_content[MAX_SYSLOGMSG];
-    char meta_alter_content[MAX_SYSLOGMSG];
 
     struct timeval tp;
     int proto = 0;
@@ -199,44 +439,62 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
 #endif
 
-#ifdef HAVE_LIBLOGNORM
-
-    static __thread struct _SaganNormalizeLiblognorm SaganNormalizeLiblognorm = { 0 };
+    /* Search for matches */
 
-    memset((char *)&SaganNormalizeLiblognorm, 0, sizeof(struct _SaganNormalizeLiblognorm));
-#endif
+    /* First we search for 'program' and such.   This way,  we don't waste CPU
+     * time with pcre/content.  Rules naming exact programs come from the
+     * index (see rules-index.c),  so we only see those for this event's
+     * program.  They are merged with the rules we always check,  keeping
+     * rule order */
 
+    rule_program = Rule_Index_Lookup(rule_index, SaganProcSyslog_LOCAL->syslog_program);
 
-    // Set all to -1 to facilitate easier checking
-    memset((char *)ip_parse_cache_used, -1, sizeof(ip_parse_cache_used));
+    if ( rule_program != NULL )
+        {
+            rule_program_count = rule_program->count;
+        }
 
-    /* This needs to be included,  even if liblognorm isn't in use */
+    Rule_Index_Event(rule_index, SaganProcSyslog_LOCAL, header_id);
 
-    sbool liblognorm_status = 0;
-    json_object *json_normalize = NULL;
+    message_len = strlen(SaganProcSyslog_LOCAL->syslog_message);
 
-    /* Search for matches */
+    Event_Context_Init(ctx, SaganProcSyslog_LOCAL, message_len);
 
-    /* First we search for 'program' and such.   This way,  we don't waste CPU
-     * time with pcre/content.  */
+    if ( config->rule_adaptive == true )
+        {
+            Rule_Adaptive_Event();
+        }
 
-    for(b=0; b < counters->rulecount; b++)
+    while ( g < rule_index->generic_count || p < rule_program_count )
         {
-            ip_src_flag = false;
-            ip_dst_flag = false;
 
-            parse_ip_src[0] = '\0';
-            parse_ip_dst[0] = '\0';
-            parse_md5_hash[0] = '\0';
-            parse_sha1_hash[0] = '\0';
-            parse_sha256_hash[0] = '\0';
+            if ( p == rule_program_count || ( g < rule_index->generic_count && rule_index->generic[g] < rule_program->rules[p] ) )
+                {
+                    b = rule_index->generic[g++];
+                    program_indexed = false;
+                }
+            else
+                {
+
+                    b = rule_program->rules[p++];
+                    program_indexed = true;
+
+                    /* "program: sshd|ssh*" is on both lists */
+
+                    if ( g < rule_index->generic_count && rule_index->generic[g] == b )
+                        {
+                            g++;
+                        }
+                }
 
+            ip_src_flag = false;
+            ip_dst_flag = false;
 
-            ip_src = parse_ip_src;
-            ip_dst = parse_ip_dst;
-            md5_hash = parse_md5_hash;
-            sha1_hash = parse_sha1_hash;
-            sha256_hash = parse_sha256_hash;
+            ip_src = NULL;
+            ip_dst = NULL;
+            md5_hash = NULL;
+            sha1_hash = NULL;
+            sha256_hash = NULL;
 
             ip_dstport_u32 = 0;
             ip_srcport_u32 = 0;
@@ -246,401 +504,165 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
             /* Process "normal" rules.  Skip dynamic rules if it's not time to process them */
 
-            if ( rulestruct[b].type == NORMAL_RULE || ( rulestruct[b].type == DYNAMIC_RULE && dynamic_rule_flag == true ) )
+            if ( rule_index->rules[b].dynamic == false || dynamic_rule_flag == true )
                 {
 
                     match = false;
 
-                    if ( strcmp(rulestruct[b].s_program, "" ))
+                    if ( config->rule_profiling )
                         {
-                            strlcpy(tmpbuf, rulestruct[b].s_program, sizeof(tmpbuf));
-                            ptmp = strtok_r(tmpbuf, "|", &tok2);
-                            match = true;
-                            while ( ptmp != NULL )
-                                {
-                                    if ( Wildcard(ptmp, SaganProcSyslog_LOCAL->syslog_program) == 1 )
-                                        {
-                                            match = false;
-                                        }
-
-                                    ptmp = strtok_r(NULL, "|", &tok2);
-                                }
+                            profile = Rule_Profile_Get(b);
+                            profile->checks++;
+                            Rule_Profile_Start(&profile_start);
                         }
 
-                    if ( strcmp(rulestruct[b].s_facility, "" ))
-                        {
-                            strlcpy(tmpbuf, rulestruct[b].s_facility, sizeof(tmpbuf));
-                            ptmp = strtok_r(tmpbuf, "|", &tok2);
-                            match = true;
-                            while ( ptmp != NULL )
-                                {
-                                    if (!strcmp(ptmp, SaganProcSyslog_LOCAL->syslog_facility))
-                                        {
-                                            match = false;
-                                        }
-
-                                    ptmp = strtok_r(NULL, "|", &tok2);
-                                }
-                        }
+                    /* Wildcard programs.  Worked out for all rules at once,  the first
+                     * time a rule needs it */
 
-                    if ( strcmp(rulestruct[b].s_syspri, "" ))
+                    if ( program_indexed == false && rule_index->rules[b].wildcard == true )
                         {
-                            strlcpy(tmpbuf, rulestruct[b].s_syspri, sizeof(tmpbuf));
-                            ptmp = strtok_r(tmpbuf, "|", &tok2);
-                            match = true;
-                            while ( ptmp != NULL )
-                                {
-                                    if (!strcmp(ptmp, SaganProcSyslog_LOCAL->syslog_priority))
-                                        {
-                                            match = false;
-                                        }
 
-                                    ptmp = strtok_r(NULL, "|", &tok2);
+                            if ( programs == NULL )
+                                {
+                                    programs = Rule_Index_Wildcard(rule_index, SaganProcSyslog_LOCAL->syslog_program);
                                 }
-                        }
 
-                    if ( strcmp(rulestruct[b].s_level, "" ))
-                        {
-                            strlcpy(tmpbuf, rulestruct[b].s_level, sizeof(tmpbuf));
-                            ptmp = strtok_r(tmpbuf, "|", &tok2);
-                            match = true;
-                            while ( ptmp != NULL )
+                            if ( !RULE_INDEX_BIT(programs, b) )
                                 {
-                                    if (!strcmp(ptmp, SaganProcSyslog_LOCAL->syslog_level))
-                                        {
-                                            match = false;
-                                        }
-
-                                    ptmp = strtok_r(NULL, "|", &tok2);
+                                    match = true;
                                 }
                         }
 
-                    if ( strcmp(rulestruct[b].s_tag, "" ))
+                    /* facility,  priority,  level and tag */
+
+                    if ( match == false && rule_index->rules[b].checks_header == true )
                         {
-                            strlcpy(tmpbuf, rulestruct[b].s_tag, sizeof(tmpbuf));
-                            ptmp = strtok_r(tmpbuf, "|", &tok2);
-                            match = true;
-                            while ( ptmp != NULL )
+                            for ( h = 0; h < RULE_INDEX_HEADER_COUNT; h++ )
                                 {
-                                    if (!strcmp(ptmp, SaganProcSyslog_LOCAL->syslog_tag))
+                                    if ( rule_index->rules[b].header[h] != NULL && !RULE_INDEX_HEADER_MATCH(rule_index->rules[b].header[h], header_id[h]) )
                                         {
-                                            match = false;
+                                            match = true;
+                                            break;
                                         }
-
-                                    ptmp = strtok_r(NULL, "|", &tok2);
                                 }
                         }
 
-                    /* If there has been a match above,  or NULL on all,  then we continue with
-                     * PCRE/content search */
-
-                    /* Search via strstr (content:) */
+                    /* Skip the rule if its prefilter content isn't in the message.  The
+                     * search is done once,  the first time a rule needs it */
 
-                    if ( match == false )
+                    if ( match == false && rule_index->rules[b].pattern != -1 )
                         {
 
-                            if ( rulestruct[b].content_count != 0 )
+                            if ( prefilter == NULL )
                                 {
-
-                                    for(z=0; z<rulestruct[b].content_count; z++)
-                                        {
-
-
-                                            /* Content: OFFSET */
-
-                                            alter_num = 0;
-
-                                            if ( rulestruct[b].s_offset[z] != 0 )
-                                                {
-
-                                                    if ( strlen(SaganProcSyslog_LOCAL->syslog_message) > rulestruct[b].s_offset[z] )
-                                                        {
-
-                                                            alter_num = strlen(SaganProcSyslog_LOCAL->syslog_message) - rulestruct[b].s_offset[z];
-                                                            strlcpy(alter_content, SaganProcSyslog_LOCAL->syslog_message + (strlen(SaganProcSyslog_LOCAL->syslog_message) - alter_num), alter_num + 1);
-
-                                                        }
-                                                    else
-                                                        {
-
-                                                            alter_content[0] = '\0'; 	/* The offset is larger than the message.  Set content too NULL */
-
-                                                        }
-
-                                                }
-                                            else
-                                                {
-
-                                                    strlcpy(alter_content, SaganProcSyslog_LOCAL->syslog_message, sizeof(alter_content));
-
-                                                }
-
-                                            /* Content: DEPTH */
-
-                                            if ( rulestruct[b].s_depth[z] != 0 )
-                                                {
-
-                                                    /* We do +2 to account for alter_count[0] and whitespace at the begin of syslog message */
-
-                                                    strlcpy(alter_content, alter_content, rulestruct[b].s_depth[z] + 2);
-
-                                                }
-
-                                            /* Content: DISTANCE */
-
-                                            if ( rulestruct[b].s_distance[z] != 0 )
-                                                {
-
-                                                    alter_num = strlen(SaganProcSyslog_LOCAL->syslog_message) - ( rulestruct[b].s_depth[z-1] + rulestruct[b].s_distance[z] + 1);
-                                                    strlcpy(alter_content, SaganProcSyslog_LOCAL->syslog_message + (strlen(SaganProcSyslog_LOCAL->syslog_message) - alter_num), alter_num + 1);
-
-                                                    /* Content: WITHIN */
-
-                                                    if ( rulestruct[b].s_within[z] != 0 )
-                                                        {
-                                                            strlcpy(alter_content, alter_content, rulestruct[b].s_within[z] + 1);
-
-                                                        }
-
-                                                }
-
-                                            /* If case insensitive */
-
-                                            if ( rulestruct[b].s_nocase[z] == 1 )
-                                                {
-
-                                                    if (rulestruct[b].content_not[z] != 1 && Sagan_stristr(alter_content, rulestruct[b].s_content[z], false))
-
-                                                        {
-                                                            sagan_match++;
-                                                        }
-                                                    else
-                                                        {
-
-                                                            /* for content: ! */
-
-                                                            if ( rulestruct[b].content_not[z] == 1 && !Sagan_stristr(alter_content, rulestruct[b].s_content[z], false)) sagan_match++;
-
-                                                        }
-                                                }
-                                            else
-                                                {
-
-                                                    /* If case sensitive */
-
-                                                    if ( rulestruct[b].content_not[z] != 1 && Sagan_strstr(alter_content, rulestruct[b].s_content[z] ))
-                                                        {
-                                                            sagan_match++;
-                                                        }
-                                                    else
-                                                        {
-
-                                                            /* for content: ! */
-                                                            if ( rulestruct[b].content_not[z] == 1 && !Sagan_strstr(alter_content, rulestruct[b].s_content[z])) sagan_match++;
-
-                                                        }
-                                                }
-                                        }
+                                    prefilter = Rule_Index_Prefilter(rule_index, SaganProcSyslog_LOCAL->syslog_message);
                                 }
 
-                            /* Search via PCRE */
-
-                            /* Note:  We verify each "step" has succeeded before function execution.  For example,
-                             * if there is a "content",  but that has failed,  there is no point in doing the
-                             * pcre or meta_content. */
-
-                            if ( rulestruct[b].pcre_count != 0 && sagan_match == rulestruct[b].content_count )
+                            if ( !RULE_INDEX_BIT(prefilter, rule_index->rules[b].pattern) )
                                 {
-
-                                    for(z=0; z<rulestruct[b].pcre_count; z++)
-                                        {
-
-                                            rc = pcre_exec( rulestruct[b].re_pcre[z], rulestruct[b].pcre_extra[z], SaganProcSyslog_LOCAL->syslog_message, (int)strlen(SaganProcSyslog_LOCAL->syslog_message), 0, 0, ovector, PCRE_OVECCOUNT);
-
-                                            if ( rc > 0 )
-                                                {
-                                                    sagan_match++;
-                                                }
-
-                                        }  /* End of pcre if */
+                                    match = true;
                                 }
+                        }
 
-                            /* Search via meta_content */
-
-                            if ( rulestruct[b].meta_content_count != 0 && sagan_match == rulestruct[b].content_count + rulestruct[b].pcre_count )
-                                {
-
-                                    for (z=0; z<rulestruct[b].meta_content_count; z++)
-                                        {
-
-                                            meta_alter_num = 0;
-
-                                            /* Meta_content: OFFSET */
-
-                                            if ( rulestruct[b].meta_offset[z] != 0 )
-                                                {
-
-                                                    if ( strlen(SaganProcSyslog_LOCAL->syslog_message) > rulestruct[b].meta_offset[z] )
-                                                        {
-
-                                                            meta_alter_num = strlen(SaganProcSyslog_LOCAL->syslog_message) - rulestruct[b].meta_offset[z];
-                                                            strlcpy(meta_alter_content, SaganProcSyslog_LOCAL->syslog_message + (strlen(SaganProcSyslog_LOCAL->syslog_message) - meta_alter_num), meta_alter_num + 1);
-
-                                                        }
-                                                    else
-                                                        {
-
-                                                            meta_alter_content[0] = '\0';    /* The offset is larger than the message.  Set meta_content too NULL */
-
-                                                        }
-
-                                                }
-                                            else
-                                                {
-
-                                                    strlcpy(meta_alter_content, SaganProcSyslog_LOCAL->syslog_message, sizeof(meta_alter_content));
-
-                                                }
-
-
-                                            /* Meta_content: DEPTH */
-
-                                            if ( rulestruct[b].meta_depth[z] != 0 )
-                                                {
-
-                                                    /* We do +2 to account for alter_count[0] and whitespace at the begin of syslog message */
-
-                                                    strlcpy(meta_alter_content, meta_alter_content, rulestruct[b].meta_depth[z] + 2);
-
-                                                }
-
-                                            /* Meta_content: DISTANCE */
-
-                                            if ( rulestruct[b].meta_distance[z] != 0 )
-                                                {
-
-                                                    meta_alter_num = strlen(SaganProcSyslog_LOCAL->syslog_message) - ( rulestruct[b].meta_depth[z-1] + rulestruct[b].meta_distance[z] + 1 );
-                                                    strlcpy(meta_alter_content, SaganProcSyslog_LOCAL->syslog_message + (strlen(SaganProcSyslog_LOCAL->syslog_message) - meta_alter_num), meta_alter_num + 1);
-
-                                                    /* Meta_ontent: WITHIN */
-
-                                                    if ( rulestruct[b].meta_within[z] != 0 )
-                                                        {
-                                                            strlcpy(meta_alter_content, meta_alter_content, rulestruct[b].meta_within[z] + 1);
-
-                                                        }
+                    if ( profile != NULL && match == true )
+                        {
+                            profile->prefilter_fail++;
+                        }
 
-                                                }
+                    /* If there has been a match above,  or NULL on all,  then we continue with
+                     * content/pcre/meta_content.  "rule-adaptive" runs them in the order that
+                     * has been cheapest for this thread lately */
 
-                                            rc = Meta_Content_Search(meta_alter_content, b, z);
+                    if ( match == false )
+                        {
 
-                                            if ( rc == 1 )
-                                                {
-                                                    sagan_match++;
-                                                }
+                            adaptive = NULL;
 
-                                        }
+                            if ( config->rule_adaptive == true )
+                                {
+                                    adaptive = Rule_Adaptive_Get(b, &rule_index->code[rule_index->rules[b].code], rule_index->rules[b].code_count);
                                 }
 
-
-                        } /* End of content: & pcre */
+                            sagan_match = Sagan_Engine_Run(b, &rule_index->rules[b], &rule_index->code[rule_index->rules[b].code], rule_index->strings,
+                                                           adaptive, SaganProcSyslog_LOCAL->syslog_message, message_len, profile);
+                        }
 
                     /* if you got match */
 
-                    if ( sagan_match == rulestruct[b].pcre_count + rulestruct[b].content_count + rulestruct[b].meta_content_count )
+                    if ( sagan_match == rule_index->rules[b].code_count )
                         {
 
-                            gettimeofday(&tp, 0);	/* Store event time as soon as we get a match */
+                            Sagan_Event_Timeval(&tp);	/* Store event time as soon as we get a match */
 
                             if ( match == false )
                                 {
 
-#ifdef HAVE_LIBLOGNORM
-                                    if ( 0 == liblognorm_status && rulestruct[b].normalize == 1 )
+                                    if ( profile != NULL )
                                         {
-                                            // Set that normalization has been tried work isn't repeated
-                                            liblognorm_status = -1;
+                                            profile->matches++;
+                                        }
 
-                                            json_normalize = Normalize_Liblognorm(SaganProcSyslog_LOCAL->syslog_message, &SaganNormalizeLiblognorm);
+#ifdef HAVE_LIBLOGNORM
+                                    if ( rulestruct[b].normalize == 1 && Event_Context_Normalize(ctx) == 1 )
+                                        {
 
-                                            if ( SaganNormalizeLiblognorm.ip_src[0] != '0'  ||
-                                                 SaganNormalizeLiblognorm.ip_dst[0] != '0'  ||
-                                                 SaganNormalizeLiblognorm.src_port != 0  ||
-                                                 SaganNormalizeLiblognorm.dst_port != 0  ||
-                                                 SaganNormalizeLiblognorm.hash_sha256[0] != '\0'  ||
-                                                 SaganNormalizeLiblognorm.hash_sha256[0] != '\0'  ||
-                                                 SaganNormalizeLiblognorm.hash_md5[0] != '\0' )
+                                            /* These are _only_ set here */
 
+                                            if ( ctx->normalize->username[0] != '\0' )
                                                 {
-                                                    liblognorm_status = 1;
+                                                    normalize_username = ctx->normalize->username;
                                                 }
 
-                                            /* These are _only_ set here */ 
-                                            if ( SaganNormalizeLiblognorm.username[0] != '\0' ) 
+                                            if ( config->selector_flag && ctx->normalize->selector[0] != '\0' )
                                                 {
-
-                                                    liblognorm_status = 1;
-                                                    normalize_username = SaganNormalizeLiblognorm.username;
+                                                    pnormalize_selector = ctx->normalize->username;
                                                 }
 
-                                            if ( config->selector_flag && SaganNormalizeLiblognorm.selector[0] != '\0' )
+                                            if ( ctx->normalize->http_uri[0] != '\0' )
                                                 {
-                                                    liblognorm_status = 1;
-                                                    pnormalize_selector = SaganNormalizeLiblognorm.username;
+                                                    normalize_http_uri = ctx->normalize->http_uri;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.http_uri[0] != '\0' )
+                                            if ( ctx->normalize->filename[0] != '\0' )
                                                 {
-                                                    liblognorm_status = 1;
-                                                    normalize_http_uri = SaganNormalizeLiblognorm.http_uri;
+                                                    normalize_filename = ctx->normalize->filename;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.filename[0] != '\0' )
-                                                {
-                                                    liblognorm_status = 1;
-                                                    normalize_filename = SaganNormalizeLiblognorm.filename;
-                                                }
-                                        }
-
-                                    if ( 1 == liblognorm_status && rulestruct[b].normalize == 1 )
-                                        {
-                                            if ( SaganNormalizeLiblognorm.ip_src[0] != '0')
+                                            if ( ctx->normalize->ip_src[0] != '0')
                                                 {
                                                     ip_src_flag = true;
-                                                    ip_src = SaganNormalizeLiblognorm.ip_src;
+                                                    ip_src = ctx->normalize->ip_src;
                                                 }
 
-
-                                            if ( SaganNormalizeLiblognorm.ip_dst[0] != '0' )
+                                            if ( ctx->normalize->ip_dst[0] != '0' )
                                                 {
                                                     ip_dst_flag = true;
-                                                    ip_dst = SaganNormalizeLiblognorm.ip_dst;
+                                                    ip_dst = ctx->normalize->ip_dst;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.src_port != 0 ) 
+                                            if ( ctx->normalize->src_port != 0 )
                                                 {
-                                                    ip_srcport_u32 = SaganNormalizeLiblognorm.src_port;
+                                                    ip_srcport_u32 = ctx->normalize->src_port;
                                                 }
 
-
-                                            if ( SaganNormalizeLiblognorm.dst_port != 0 ) 
+                                            if ( ctx->normalize->dst_port != 0 )
                                                 {
-                                                    ip_dstport_u32 = SaganNormalizeLiblognorm.dst_port;
+                                                    ip_dstport_u32 = ctx->normalize->dst_port;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.hash_md5[0] != '\0' ) 
+                                            if ( ctx->normalize->hash_md5[0] != '\0' )
                                                 {
-                                                    md5_hash = SaganNormalizeLiblognorm.hash_md5;
+                                                    md5_hash = ctx->normalize->hash_md5;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.hash_sha256[0] != '\0' ) 
+                                            if ( ctx->normalize->hash_sha1[0] != '\0' )
                                                 {
-                                                    sha256_hash = SaganNormalizeLiblognorm.hash_sha1;
+                                                    sha1_hash = ctx->normalize->hash_sha1;
                                                 }
 
-                                            if ( SaganNormalizeLiblognorm.hash_sha256[0] != '\0' ) 
+                                            if ( ctx->normalize->hash_sha256[0] != '\0' )
                                                 {
-                                                    sha256_hash = SaganNormalizeLiblognorm.hash_sha256;
+                                                    sha256_hash = ctx->normalize->hash_sha256;
                                                 }
 
                                         }
@@ -648,132 +670,74 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
 
                                     /* Normalization should always over ride parse_src_ip/parse_dst_ip/parse_port,
-                                     * _unless_ liblognorm fails and both are in a rule or liblognorm failed to get src or dst */
-
-                                    /* We don't need to set ip_src, et al to the parse_X version because it is reset at the top 
-                                     * and is only changed if normalize is valid */
+                                     * _unless_ liblognorm fails and both are in a rule or liblognorm failed to get src or dst.
+                                     * Whatever we parse is kept in the event context for the next rule that wants it */
 
                                     /* parse_src_ip: {position} */
 
                                     if ( ip_src_flag == false && rulestruct[b].s_find_src_ip == 1 )
                                         {
-                                            check_pos = rulestruct[b].s_find_src_pos - 1;
-
-                                            // Cache the parsing to avoid doing this for every rule
-
-                                            if (check_pos < MAX_PARSE_IP && lookup_cache[check_pos].searched)
-                                                {
-                                                    ip_src = lookup_cache[check_pos].ip;
-
-                                                    // This case handles if we already found the previous index
-                                                }
-                                            else
-                                                {
-                                                    Parse_IP(SaganProcSyslog_LOCAL->syslog_message,
-                                                             check_pos+1,
-                                                             parse_ip_src,
-                                                             sizeof(parse_ip_src),
-                                                             lookup_cache,
-                                                             MAX_PARSE_IP);
-
-                                                }
-
-                                            /* If Parse_IP is successful,  we set the flag */
+                                            ip_src = Event_Context_IP(ctx, rulestruct[b].s_find_src_pos);
 
                                             if ( ip_src[0] != '\0' )
                                                 {
                                                     ip_src_flag = true;
                                                 }
-
                                         }
 
                                     /* parse_dst_ip: {postion} */
 
                                     if ( ip_dst_flag == false && rulestruct[b].s_find_dst_ip == 1 )
                                         {
-                                            check_pos = rulestruct[b].s_find_dst_pos - 1;
-
-                                            // Cache the parsing to avoid doing this for every rule
-
-                                            if (check_pos < MAX_PARSE_IP && lookup_cache[check_pos].searched)
-                                                {
-                                                    ip_dst = lookup_cache[check_pos].ip;
-
-                                                    // This case handles if we already found the previous index
-                                                }
-                                            else
-                                                {
-                                                    Parse_IP(SaganProcSyslog_LOCAL->syslog_message,
-                                                             check_pos+1,
-                                                             parse_ip_dst,
-                                                             sizeof(parse_ip_dst),
-                                                             lookup_cache,
-                                                             MAX_PARSE_IP);
-                                                }
-
-                                            /* If Parse_IP is successful,  we set the flag */
+                                            ip_dst = Event_Context_IP(ctx, rulestruct[b].s_find_dst_pos);
 
                                             if ( ip_dst[0] != '\0' )
                                                 {
                                                     ip_dst_flag = true;
                                                 }
-
                                         }
 
                                     /* parse_port */
 
                                     if ( ip_srcport_u32 == 0 && rulestruct[b].s_find_port == 1 )
                                         {
-                                            ip_srcport_u32 = Parse_Src_Port(SaganProcSyslog_LOCAL->syslog_message);
+                                            ip_srcport_u32 = Event_Context_Src_Port(ctx);
                                         }
 
                                     if ( ip_dstport_u32 == 0 && rulestruct[b].s_find_port == 1 )
                                         {
-                                            ip_dstport_u32 = Parse_Dst_Port(SaganProcSyslog_LOCAL->syslog_message);
-
+                                            ip_dstport_u32 = Event_Context_Dst_Port(ctx);
                                         }
 
-                                    /* parse_hash: md5 */
+                                    /* parse_hash */
 
                                     if ( md5_hash == NULL && rulestruct[b].s_find_hash_type == PARSE_HASH_MD5 )
                                         {
-                                            Parse_Hash(SaganProcSyslog_LOCAL->syslog_message, PARSE_HASH_MD5, parse_md5_hash, sizeof(parse_md5_hash));
-                                            md5_hash = parse_md5_hash;
+                                            md5_hash = Event_Context_Hash(ctx, PARSE_HASH_MD5);
                                         }
 
                                     else if ( sha1_hash == NULL && rulestruct[b].s_find_hash_type == PARSE_HASH_SHA1 )
                                         {
-                                            Parse_Hash(SaganProcSyslog_LOCAL->syslog_message, PARSE_HASH_SHA1, parse_sha256_hash, sizeof(parse_sha1_hash));
-                                            sha1_hash = parse_sha1_hash;
+                                            sha1_hash = Event_Context_Hash(ctx, PARSE_HASH_SHA1);
                                         }
 
                                     else if ( sha256_hash == NULL && rulestruct[b].s_find_hash_type == PARSE_HASH_SHA256 )
                                         {
-                                            Parse_Hash(SaganProcSyslog_LOCAL->syslog_message, PARSE_HASH_SHA256, parse_sha256_hash, sizeof(parse_sha256_hash));
-                                            sha256_hash = parse_sha256_hash;
+                                            sha256_hash = Event_Context_Hash(ctx, PARSE_HASH_SHA256);
                                         }
 
-                                    /*  DEBUG
-                                    else if ( sha256_hash[0] == '\0' && rulestruct[b].s_find_hash_type == PARSE_HASH_ALL )
-                                        {
-                                    Parse_Hash(SaganProcSyslog_LOCAL->syslog_message, PARSE_HASH_SHA256, sha256_hash, sizeof(sha256_hash));
-                                            sha256_hash = parse_sha256_hash;
-                                                      }
-                                                      */
-
-
                                     /* If the rule calls for proto searching,  we do it now */
 
                                     proto = 0;
 
                                     if ( rulestruct[b].s_find_proto_program == 1 )
                                         {
-                                            proto = Parse_Proto_Program(SaganProcSyslog_LOCAL->syslog_program);
+                                            proto = Event_Context_Proto_Program(ctx);
                                         }
 
                                     if ( rulestruct[b].s_find_proto == 1 && proto == 0 )
                                         {
-                                            proto = Parse_Proto(SaganProcSyslog_LOCAL->syslog_message);
+                                            proto = Event_Context_Proto(ctx);
                                         }
 
                                     /* If proto is not searched or has failed,  default to whatever the rule told us to
@@ -824,14 +788,14 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
                                             ip_dst = config->sagan_host;
                                         }
 
-                                    if ( ip_src_flag ) 
+                                    if ( ip_src_flag )
                                         {
-                                            IP2Bit(ip_src, ip_src_bits);
+                                            Event_Context_IP_Bits(ctx, ip_src, ip_src_bits);
                                         }
 
-                                    if ( ip_dst_flag ) 
+                                    if ( ip_dst_flag )
                                         {
-                                            IP2Bit(ip_dst, ip_dst_bits);
+                                            Event_Context_IP_Bits(ctx, ip_dst, ip_dst_bits);
                                         }
 
                                     strlcpy(s_msg, rulestruct[b].s_msg, sizeof(s_msg));
@@ -982,7 +946,7 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
                                             if ( blacklist_results == 0 && rulestruct[b].blacklist_ipaddr_all )
                                                 {
-                                                    blacklist_results = Sagan_Blacklist_IPADDR_All(SaganProcSyslog_LOCAL->syslog_message, lookup_cache, MAX_PARSE_IP);
+                                                    blacklist_results = Sagan_Blacklist_IPADDR_All(ctx);
                                                 }
 
                                             if ( blacklist_results == 0 && rulestruct[b].blacklist_ipaddr_both && ip_src_flag && ip_dst_flag )
@@ -1036,18 +1000,18 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
                                                     if ( rulestruct[b].bluedot_ipaddr_type == 4 )
                                                         {
 
-                                                            bluedot_ip_flag = Sagan_Bluedot_IP_Lookup_All(SaganProcSyslog_LOCAL->syslog_message, b, lookup_cache, MAX_PARSE_IP);
+                                                            bluedot_ip_flag = Sagan_Bluedot_IP_Lookup_All(ctx, b);
 
                                                         }
 
                                                 }
 
 
-                                            if ( rulestruct[b].bluedot_file_hash && ( md5_hash[0] != '\0' ||
-                                                    sha256_hash[0] != '\0' || sha256_hash[0] != '\0') )
+                                            if ( rulestruct[b].bluedot_file_hash && ( md5_hash != NULL ||
+                                                    sha1_hash != NULL || sha256_hash != NULL ) )
                                                 {
 
-                                                    if ( md5_hash[0] != '\0')
+                                                    if ( md5_hash != NULL && md5_hash[0] != '\0')
                                                         {
 
                                                             bluedot_results = Sagan_Bluedot_Lookup( md5_hash, BLUEDOT_LOOKUP_HASH, b);
@@ -1055,15 +1019,15 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
                                                         }
 
-                                                    if ( sha256_hash[0] != '\0' )
+                                                    if ( sha1_hash != NULL && sha1_hash[0] != '\0' )
                                                         {
 
-                                                            bluedot_results = Sagan_Bluedot_Lookup( sha256_hash, BLUEDOT_LOOKUP_HASH, b);
+                                                            bluedot_results = Sagan_Bluedot_Lookup( sha1_hash, BLUEDOT_LOOKUP_HASH, b);
                                                             bluedot_hash_flag = Sagan_Bluedot_Cat_Compare( bluedot_results, b, BLUEDOT_LOOKUP_HASH);
 
                                                         }
 
-                                                    if ( sha256_hash[0] != '\0')
+                                                    if ( sha256_hash != NULL && sha256_hash[0] != '\0')
                                                         {
 
                                                             bluedot_results = Sagan_Bluedot_Lookup( sha256_hash, BLUEDOT_LOOKUP_HASH, b);
@@ -1120,7 +1084,7 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_ipaddr_all )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_IPADDR_All ( SaganProcSyslog_LOCAL->syslog_message, lookup_cache, MAX_PARSE_IP);
+                                                    brointel_results = Sagan_BroIntel_IPADDR_All(ctx);
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_ipaddr_both && ip_src_flag && ip_dst_flag )
@@ -1133,37 +1097,37 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_domain )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_DOMAIN(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_DOMAIN(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_file_hash )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_FILE_HASH(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_FILE_HASH(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_url )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_URL(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_URL(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_software )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_SOFTWARE(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_SOFTWARE(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_user_name )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_USER_NAME(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_USER_NAME(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_file_name )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_FILE_NAME(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_FILE_NAME(Event_Context_Lower(ctx));
                                                 }
 
                                             if ( brointel_results == 0 && rulestruct[b].brointel_cert_hash )
                                                 {
-                                                    brointel_results = Sagan_BroIntel_CERT_HASH(SaganProcSyslog_LOCAL->syslog_message);
+                                                    brointel_results = Sagan_BroIntel_CERT_HASH(Event_Context_Lower(ctx));
                                                 }
 
                                         }
@@ -1342,11 +1306,16 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
                                                                                                                                     if ( rulestruct[b].xbit_flag == false || rulestruct[b].xbit_noalert == 0 )
                                                                                                                                         {
 
+                                                                                                                                            if ( profile != NULL )
+                                                                                                                                                {
+                                                                                                                                                    profile->alerts++;
+                                                                                                                                                }
+
                                                                                                                                             if ( rulestruct[b].type == NORMAL_RULE )
                                                                                                                                                 {
 
                                                                                                                                                     Send_Alert(SaganProcSyslog_LOCAL,
-                                                                                                                                                               liblognorm_status == 1 && rulestruct[b].normalize == 1 ? json_normalize : NULL,
+                                                                                                                                                               ctx->normalize_status == 1 && rulestruct[b].normalize == 1 ? ctx->json_normalize : NULL,
                                                                                                                                                                processor_info_engine,
                                                                                                                                                                ip_src,
                                                                                                                                                                ip_dst,
@@ -1402,23 +1371,20 @@ int Sagan_Engine ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, sbool dynamic_rule
 
                     match = false;  		      /* Reset match! */
                     sagan_match=0;	      /* Reset pcre/meta_content/content match! */
-                    rc=0;		      /* Return code */
                     xbit_return=0;	      /* Xbit reset */
                     check_flow_return = true;      /* Rule flow direction reset */
 
-                } /* If normal or dynamic rule */
+                    if ( profile != NULL )
+                        {
+                            Rule_Profile_Stop(profile, &profile_start);
+                            profile = NULL;
+                        }
 
-        } /* End for for loop */
+                } /* If normal or dynamic rule */
 
-    free(processor_info_engine);
+        } /* End of rule loop */
 
-#ifdef HAVE_LIBLOGNORM
-    if ( NULL != json_normalize )
-        {
-            json_object_put(json_normalize);
-            json_normalize = NULL;
-        }
-#endif
+    Event_Context_Free(ctx);
 
     return(0);
 }
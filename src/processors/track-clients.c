@@ -57,7 +57,6 @@ pthread_mutex_t IPCTrackClientCounter=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t IPCTrackClientsStatus=PTHREAD_MUTEX_INITIALIZER;
 
 struct _Sagan_Processor_Info *processor_info_track_client = NULL;
-struct _Sagan_Proc_Syslog *SaganProcSyslog;
 struct _Sagan_Track_Clients_IPC *SaganTrackClients_ipc;
 struct _Sagan_IPC_Counters *counters_ipc;
 
@@ -78,7 +77,7 @@ void Track_Clients ( char *host )
     uintmax_t utime_u64;
     unsigned char hostbits[MAXIPBIT] = { 0 };
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(utime_tmp, sizeof(utime_tmp), "%s",  now);
     utime_u64 = atol(utime_tmp);
@@ -200,7 +199,7 @@ void Track_Clients_Thread ( void )
 
             struct timeval tp;
 
-            t = time(NULL);
+            t = Sagan_Time();
             now=localtime(&t);
             strftime(utime_tmp, sizeof(utime_tmp), "%s",  now);
             utime_u32 = atol(utime_tmp);
@@ -273,7 +272,7 @@ void Track_Clients_Thread ( void )
 
                                     alertid=101;		/* See gen-msg.map */
 
-                                    gettimeofday(&tp, 0);
+                                    Sagan_Event_Timeval(&tp);
 
                                     /* Send alert to output plugins */
 
@@ -339,7 +338,7 @@ void Track_Clients_Thread ( void )
 
                                     alertid=100;	/* See gen-msg.map  */
 
-                                    gettimeofday(&tp, 0);
+                                    Sagan_Event_Timeval(&tp);
 
 
                                     /* Send alert to output plugins */
@@ -41,7 +41,6 @@
 #include <getopt.h>
 #include <time.h>
 #include <signal.h>
-#include <pcre.h>
 
 #include "version.h"
 
@@ -0,0 +1,423 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* rule-adaptive.c
+ *
+ * "rule-adaptive: yes".  A rule's content,  pcre and meta_content checks
+ * all have to pass,  and none of them change anything,  so they can run
+ * in any order without changing what alerts.  Each worker thread times a
+ * sample of them and runs the ones that are cheap and most likely to
+ * fail first.  Traffic drifts,  so the order is worked out again every
+ * RULE_ADAPTIVE_INTERVAL checks of a rule.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "rules.h"
+#include "rules-index.h"
+#include "rule-adaptive.h"
+#include "lockfile.h"
+
+struct _SaganCounters *counters;
+
+static int Rule_Adaptive_Generation = 0;	/* Bumped on reload */
+
+static __thread _Rule_Adaptive_Thread Rule_Adaptive_Local;
+
+static void Rule_Adaptive_Build( _Rule_Adaptive_Thread *, _Rule_Adaptive *, const _Rule_Index_Op *, int );
+static void Rule_Adaptive_Reorder( _Rule_Adaptive_Check *, int );
+static void Rule_Adaptive_Repack( _Rule_Adaptive_Thread * );
+static uint32_t Rule_Adaptive_Alloc( _Rule_Adaptive_Check **, uint32_t *, uint32_t *, int );
+
+/****************************************************************************
+ * Rule_Adaptive_Alloc - Room for 'count' checks in a pool.  Returns the
+ * offset.  Pools only grow,  which is why rules hold offsets
+ ****************************************************************************/
+
+static uint32_t Rule_Adaptive_Alloc( _Rule_Adaptive_Check **pool, uint32_t *used, uint32_t *size, int count )
+{
+
+    _Rule_Adaptive_Check *tmp = NULL;
+    uint32_t first = *used;
+
+    if ( *used + count > *size )
+        {
+
+            *size = *size == 0 ? 1024 : *size * 2;
+
+            while ( *used + count > *size )
+                {
+                    *size *= 2;
+                }
+
+            tmp = realloc(*pool, *size * sizeof(_Rule_Adaptive_Check));
+
+            if ( tmp == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for rule-adaptive. Abort!", __FILE__, __LINE__);
+                }
+
+            *pool = tmp;
+        }
+
+    *used += count;
+
+    return(first);
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Build - A rule's checks in op order (see Rule_Index_Code()),
+ * the same order the engine uses without "rule-adaptive"
+ ****************************************************************************/
+
+static void Rule_Adaptive_Build( _Rule_Adaptive_Thread *thread, _Rule_Adaptive *adaptive, const _Rule_Index_Op *code, int count )
+{
+
+    _Rule_Adaptive_Check *check = NULL;
+    int i;
+
+    memset(adaptive, 0, sizeof(_Rule_Adaptive));
+
+    adaptive->built = true;
+    adaptive->count = count;
+
+    /* Nothing to reorder */
+
+    if ( count < 2 )
+        {
+            return;
+        }
+
+    adaptive->first = Rule_Adaptive_Alloc(&thread->pool, &thread->pool_used, &thread->pool_size, count);
+
+    check = &thread->pool[adaptive->first];
+    memset(check, 0, count * sizeof(_Rule_Adaptive_Check));
+
+    for ( i = 0; i < count; i++ )
+        {
+            check[i].type = code[i].type;
+            check[i].index = i;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Get - This thread's order for 'rule',  whose 'count' ops
+ * start at 'code',  or NULL if the rule has fewer than two checks
+ ****************************************************************************/
+
+_Rule_Adaptive *Rule_Adaptive_Get( int rule, const _Rule_Index_Op *code, int count )
+{
+
+    _Rule_Adaptive_Thread *thread = &Rule_Adaptive_Local;
+    _Rule_Adaptive *rules = NULL;
+    int generation = __atomic_load_n(&Rule_Adaptive_Generation, __ATOMIC_RELAXED);
+    int size;
+
+    /* Rules were reloaded.  Start over */
+
+    if ( thread->generation != generation )
+        {
+            memset(thread->rules, 0, thread->size * sizeof(_Rule_Adaptive));
+            thread->pool_used = 0;
+            thread->generation = generation;
+        }
+
+    /* Dynamic rules are added while we run */
+
+    if ( rule >= thread->size )
+        {
+
+            size = counters->rulecount > rule ? counters->rulecount : rule + 1;
+
+            rules = realloc(thread->rules, size * sizeof(_Rule_Adaptive));
+
+            if ( rules == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for rule-adaptive. Abort!", __FILE__, __LINE__);
+                }
+
+            memset(&rules[thread->size], 0, ( size - thread->size ) * sizeof(_Rule_Adaptive));
+
+            thread->rules = rules;
+            thread->size = size;
+        }
+
+    if ( thread->rules[rule].built == false )
+        {
+            Rule_Adaptive_Build(thread, &thread->rules[rule], code, count);
+        }
+
+    return( thread->rules[rule].count < 2 ? NULL : &thread->rules[rule] );
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Checks - A rule's checks,  in the order to run them
+ ****************************************************************************/
+
+_Rule_Adaptive_Check *Rule_Adaptive_Checks( _Rule_Adaptive *adaptive )
+{
+    return(&Rule_Adaptive_Local.pool[adaptive->first]);
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Sample - Should this check of the rule run and time all
+ * of its checks?
+ ****************************************************************************/
+
+sbool Rule_Adaptive_Sample( _Rule_Adaptive *adaptive )
+{
+    return( ( adaptive->checks & ( RULE_ADAPTIVE_SAMPLE - 1 ) ) == 0 );
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Start/Rule_Adaptive_Stop - Time one check of a sample
+ ****************************************************************************/
+
+void Rule_Adaptive_Start( struct timespec *start )
+{
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+void Rule_Adaptive_Stop( _Rule_Adaptive_Check *check, struct timespec *start, sbool pass )
+{
+
+    struct timespec stop;
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    check->nsec += (uint64_t)( stop.tv_sec - start->tv_sec ) * 1000000000 + stop.tv_nsec - start->tv_nsec;
+    check->samples++;
+
+    if ( pass == false )
+        {
+            check->fails++;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Reorder - Cheapest per failure first.  For checks that
+ * must all pass,  running them by cost / chance of failing is the order
+ * that does the least work on average.  Old samples count for half each
+ * time so the order follows the traffic
+ ****************************************************************************/
+
+static void Rule_Adaptive_Reorder( _Rule_Adaptive_Check *check, int count )
+{
+
+    double rank[MAX_CONTENT + MAX_PCRE + MAX_META_CONTENT];
+    double cost;
+    double tmp_rank;
+    _Rule_Adaptive_Check tmp;
+
+    int i;
+    int j;
+
+    for ( i = 0; i < count; i++ )
+        {
+
+            if ( check[i].samples != 0 )
+                {
+                    cost = (double)check[i].nsec / check[i].samples;
+                }
+            else
+                {
+                    cost = check[i].type == RULE_OP_CONTENT ? RULE_ADAPTIVE_COST_CONTENT :
+                           check[i].type == RULE_OP_PCRE ? RULE_ADAPTIVE_COST_PCRE : RULE_ADAPTIVE_COST_META_CONTENT;
+                }
+
+            /* +1/+2 so a check that hasn't failed yet isn't "free" */
+
+            rank[i] = cost * ( check[i].samples + 2 ) / ( check[i].fails + 1 );
+
+            check[i].nsec >>= 1;
+            check[i].samples >>= 1;
+            check[i].fails >>= 1;
+        }
+
+    /* Insertion sort.  There are only a handful,  and it's stable so ties
+     * keep rule order */
+
+    for ( i = 1; i < count; i++ )
+        {
+
+            tmp = check[i];
+            tmp_rank = rank[i];
+
+            for ( j = i; j > 0 && rank[j-1] > tmp_rank; j-- )
+                {
+                    check[j] = check[j-1];
+                    rank[j] = rank[j-1];
+                }
+
+            check[j] = tmp;
+            rank[j] = tmp_rank;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Done - A check of the rule is finished
+ ****************************************************************************/
+
+void Rule_Adaptive_Done( _Rule_Adaptive *adaptive )
+{
+
+    adaptive->heat++;
+
+    if ( ++adaptive->checks == RULE_ADAPTIVE_INTERVAL )
+        {
+            Rule_Adaptive_Reorder(Rule_Adaptive_Checks(adaptive), adaptive->count);
+            adaptive->checks = 0;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Repack - Copy the checks of the busiest rules next to each
+ * other,  so the rules most events go through share cache lines.  The copy
+ * goes into the thread's spare pool,  which then swaps with the live one
+ ****************************************************************************/
+
+static void Rule_Adaptive_Repack( _Rule_Adaptive_Thread *thread )
+{
+
+    _Rule_Adaptive *adaptive = NULL;
+    _Rule_Adaptive_Check *pool = NULL;
+    uint32_t pool_used = 0;
+    uint32_t pool_size = 0;
+
+    int *order = NULL;
+    int order_count = 0;
+    int tmp;
+
+    uint32_t first;
+
+    int i;
+    int j;
+
+    /* Only grows when dynamic rules have been added */
+
+    if ( thread->order_size < thread->size )
+        {
+
+            order = realloc(thread->order, thread->size * sizeof(int));
+
+            if ( order == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for rule-adaptive. Abort!", __FILE__, __LINE__);
+                }
+
+            thread->order = order;
+            thread->order_size = thread->size;
+        }
+
+    order = thread->order;
+
+    for ( i = 0; i < thread->size; i++ )
+        {
+            if ( thread->rules[i].built == true && thread->rules[i].count >= 2 )
+                {
+                    order[order_count++] = i;
+                }
+        }
+
+    /* Busiest first.  Insertion sort,  the order barely changes between
+     * repacks */
+
+    for ( i = 1; i < order_count; i++ )
+        {
+
+            tmp = order[i];
+
+            for ( j = i; j > 0 && thread->rules[order[j-1]].heat < thread->rules[tmp].heat; j-- )
+                {
+                    order[j] = order[j-1];
+                }
+
+            order[j] = tmp;
+        }
+
+    pool = thread->spare;
+    pool_size = thread->spare_size;
+
+    for ( i = 0; i < order_count; i++ )
+        {
+
+            adaptive = &thread->rules[order[i]];
+            first = Rule_Adaptive_Alloc(&pool, &pool_used, &pool_size, adaptive->count);
+
+            memcpy(&pool[first], &thread->pool[adaptive->first], adaptive->count * sizeof(_Rule_Adaptive_Check));
+
+            adaptive->first = first;
+            adaptive->heat >>= 1;
+        }
+
+    thread->spare = thread->pool;
+    thread->spare_size = thread->pool_size;
+
+    thread->pool = pool;
+    thread->pool_used = pool_used;
+    thread->pool_size = pool_size;
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Event - Called by the engine at the start of each event
+ ****************************************************************************/
+
+void Rule_Adaptive_Event( void )
+{
+
+    _Rule_Adaptive_Thread *thread = &Rule_Adaptive_Local;
+
+    if ( ++thread->events % RULE_ADAPTIVE_REPACK == 0 && thread->pool_used != 0 )
+        {
+            Rule_Adaptive_Repack(thread);
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Adaptive_Reset - Rules were reloaded.  Each thread starts over the
+ * next time it looks
+ ****************************************************************************/
+
+void Rule_Adaptive_Reset( void )
+{
+    __atomic_add_fetch(&Rule_Adaptive_Generation, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,101 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+/* Every RULE_ADAPTIVE_SAMPLE'th check of a rule runs and times all of its
+ * checks.  That's what the order is worked out from.  Must be a power
+ * of 2 */
+
+#define RULE_ADAPTIVE_SAMPLE		64
+
+/* Checks of a rule between reorders */
+
+#define RULE_ADAPTIVE_INTERVAL		4096
+
+/* Events between regrouping the busiest rules together */
+
+#define RULE_ADAPTIVE_REPACK		262144
+
+/* Cost (ns) assumed before a check has been timed */
+
+#define RULE_ADAPTIVE_COST_CONTENT	50
+#define RULE_ADAPTIVE_COST_PCRE		500
+#define RULE_ADAPTIVE_COST_META_CONTENT	100
+
+typedef struct _Rule_Adaptive_Check _Rule_Adaptive_Check;
+struct _Rule_Adaptive_Check
+{
+    uint64_t nsec;			/* From samples.  Halved at each reorder */
+    uint32_t samples;
+    uint32_t fails;
+    uint8_t type;			/* RULE_OP_* */
+    uint8_t index;			/* Which of the rule's ops */
+};
+
+/* One per rule per worker thread.  The checks live in the thread's pool,
+ * busiest rules first */
+
+typedef struct _Rule_Adaptive _Rule_Adaptive;
+struct _Rule_Adaptive
+{
+    uint32_t first;			/* Offset into the pool */
+    uint32_t checks;			/* Since the last reorder */
+    uint32_t heat;			/* Checks,  halved at each regroup */
+    uint8_t count;
+    sbool built;
+};
+
+typedef struct _Rule_Adaptive_Thread _Rule_Adaptive_Thread;
+struct _Rule_Adaptive_Thread
+{
+    _Rule_Adaptive *rules;
+    int size;
+
+    _Rule_Adaptive_Check *pool;
+    uint32_t pool_used;
+    uint32_t pool_size;
+
+    /* A repack copies into the spare pool and swaps it in.  Both are kept,
+     * so once they're big enough a repack doesn't allocate */
+
+    _Rule_Adaptive_Check *spare;
+    uint32_t spare_size;
+
+    int *order;				/* Rules by heat,  for a repack */
+    int order_size;
+
+    uint64_t events;
+    int generation;
+};
+
+void Rule_Adaptive_Event( void );
+_Rule_Adaptive *Rule_Adaptive_Get( int, const struct _Rule_Index_Op *, int );
+_Rule_Adaptive_Check *Rule_Adaptive_Checks( _Rule_Adaptive * );
+sbool Rule_Adaptive_Sample( _Rule_Adaptive * );
+void Rule_Adaptive_Start( struct timespec * );
+void Rule_Adaptive_Stop( _Rule_Adaptive_Check *, struct timespec *, sbool );
+void Rule_Adaptive_Done( _Rule_Adaptive * );
+void Rule_Adaptive_Reset( void );
@@ -0,0 +1,169 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* rule-pool.c
+ *
+ * Storage for the variable length parts of the rules (content,
+ * meta_content,  references,  flows and xbits).  Each is sized to what
+ * the rule actually uses (see Rule_Pack() in rules.c) and carved out of
+ * a few large chunks,  rather than every rule carrying arrays sized for
+ * the maximum.  Nothing is freed until the rules are reloaded.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "rules.h"
+#include "rule-pool.h"
+#include "lockfile.h"
+
+struct _SaganCounters *counters;
+
+static _Rule_Pool_Chunk *Rule_Pool_Chunks = NULL;
+
+static size_t Rule_Pool_Used = 0;		/* Handed out */
+static size_t Rule_Pool_Reserved = 0;		/* In chunks */
+
+/****************************************************************************
+ * Rule_Pool_Alloc - Returns 'size' bytes of zeroed memory that lives until
+ * the next Rule_Pool_Free().  Only called while rules are being loaded
+ ****************************************************************************/
+
+void *Rule_Pool_Alloc( size_t size )
+{
+
+    _Rule_Pool_Chunk *chunk = Rule_Pool_Chunks;
+    void *ptr = NULL;
+
+    /* Keep everything 8 byte aligned */
+
+    size = ( size + 7 ) & ~(size_t)7;
+
+    if ( chunk == NULL || chunk->size - chunk->used < size )
+        {
+
+            chunk = malloc(sizeof(_Rule_Pool_Chunk));
+
+            if ( chunk == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule pool. Abort!", __FILE__, __LINE__);
+                }
+
+            chunk->size = size > RULE_POOL_CHUNK ? size : RULE_POOL_CHUNK;
+            chunk->used = 0;
+            chunk->data = calloc(1, chunk->size);
+
+            if ( chunk->data == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule pool. Abort!", __FILE__, __LINE__);
+                }
+
+            /* An oversized chunk goes behind the current one,  so the
+             * current one's free space isn't lost */
+
+            if ( size > RULE_POOL_CHUNK && Rule_Pool_Chunks != NULL )
+                {
+                    chunk->next = Rule_Pool_Chunks->next;
+                    Rule_Pool_Chunks->next = chunk;
+                }
+            else
+                {
+                    chunk->next = Rule_Pool_Chunks;
+                    Rule_Pool_Chunks = chunk;
+                }
+
+            Rule_Pool_Reserved += chunk->size;
+        }
+
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+
+    Rule_Pool_Used += size;
+
+    return(ptr);
+
+}
+
+/****************************************************************************
+ * Rule_Pool_Strdup - A copy of 'str' in the pool
+ ****************************************************************************/
+
+char *Rule_Pool_Strdup( const char *str )
+{
+
+    size_t len = strlen(str) + 1;
+    char *copy = Rule_Pool_Alloc(len);
+
+    memcpy(copy, str, len);
+
+    return(copy);
+
+}
+
+/****************************************************************************
+ * Rule_Pool_Free - Releases everything in the pool.  Only on reload,
+ * once Processor_Pause() has the workers stopped and no -O alerts are held
+ * (Input_Mmap_Holding()),  so nothing still points into it
+ ****************************************************************************/
+
+void Rule_Pool_Free( void )
+{
+
+    _Rule_Pool_Chunk *next;
+
+    while ( Rule_Pool_Chunks != NULL )
+        {
+            next = Rule_Pool_Chunks->next;
+            free(Rule_Pool_Chunks->data);
+            free(Rule_Pool_Chunks);
+            Rule_Pool_Chunks = next;
+        }
+
+    Rule_Pool_Used = 0;
+    Rule_Pool_Reserved = 0;
+
+}
+
+/****************************************************************************
+ * Rule_Pool_Report - Logs the memory the loaded rules take ("-d load")
+ ****************************************************************************/
+
+void Rule_Pool_Report( void )
+{
+
+    size_t rules = (size_t)counters->rulecount * sizeof(_Rule_Struct);
+
+    Sagan_Log(S_DEBUG, "[%s, line %d] Rule memory: %d rule(s) take %lu bytes.  %lu in rulestruct (%lu per rule) and %lu in the rule pool (%lu reserved).", __FILE__, __LINE__,
+              counters->rulecount, (unsigned long)( rules + Rule_Pool_Reserved ), (unsigned long)rules, (unsigned long)sizeof(_Rule_Struct),
+              (unsigned long)Rule_Pool_Used, (unsigned long)Rule_Pool_Reserved);
+
+}
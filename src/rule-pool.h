@@ -0,0 +1,44 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stddef.h>
+
+/* Rules are carved out of chunks this size.  Larger allocations get a
+ * chunk to themselves */
+
+#define RULE_POOL_CHUNK		65536
+
+typedef struct _Rule_Pool_Chunk _Rule_Pool_Chunk;
+struct _Rule_Pool_Chunk
+{
+    _Rule_Pool_Chunk *next;
+    size_t size;
+    size_t used;
+    char *data;
+};
+
+void *Rule_Pool_Alloc( size_t );
+char *Rule_Pool_Strdup( const char * );
+void Rule_Pool_Free( void );
+void Rule_Pool_Report( void );
@@ -0,0 +1,326 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* rule-profile.c
+ *
+ * Per rule profiling ("rule-profiling: yes").  Counts what the engine did
+ * with each rule and how long it took,  so expensive signatures can be
+ * found.  The report is written on SIGUSR1 and when Sagan exits.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "rules.h"
+#include "rule-profile.h"
+#include "lockfile.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+struct _Rule_Struct *rulestruct;
+
+/* Every worker's counters.  The list only grows,  and a worker only
+ * resizes its own counters while holding the mutex,  so the report can
+ * walk them safely */
+
+static _Rule_Profile_Thread *Rule_Profile_Threads = NULL;
+static pthread_mutex_t Rule_Profile_Mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread _Rule_Profile_Thread *Rule_Profile_Local = NULL;
+
+/* For sorting the report */
+
+typedef struct _Rule_Profile_Entry _Rule_Profile_Entry;
+struct _Rule_Profile_Entry
+{
+    int rule;
+    _Rule_Profile profile;
+};
+
+static int Rule_Profile_Compare( const void *, const void * );
+
+/****************************************************************************
+ * Rule_Profile_Get - This thread's counters for 'rule'.  Dynamic rules and
+ * reloads can add rules while we run,  so the array grows as needed
+ ****************************************************************************/
+
+_Rule_Profile *Rule_Profile_Get( int rule )
+{
+
+    _Rule_Profile *rules = NULL;
+    int size = 0;
+
+    if ( Rule_Profile_Local == NULL )
+        {
+
+            Rule_Profile_Local = calloc(1, sizeof(_Rule_Profile_Thread));
+
+            if ( Rule_Profile_Local == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for Rule_Profile_Local. Abort!", __FILE__, __LINE__);
+                }
+
+            pthread_mutex_lock(&Rule_Profile_Mutex);
+            Rule_Profile_Local->next = Rule_Profile_Threads;
+            Rule_Profile_Threads = Rule_Profile_Local;
+            pthread_mutex_unlock(&Rule_Profile_Mutex);
+
+        }
+
+    if ( rule >= Rule_Profile_Local->size )
+        {
+
+            size = counters->rulecount > rule ? counters->rulecount : rule + 1;
+
+            pthread_mutex_lock(&Rule_Profile_Mutex);
+
+            rules = realloc(Rule_Profile_Local->rules, size * sizeof(_Rule_Profile));
+
+            if ( rules == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to reallocate memory for rule profiling. Abort!", __FILE__, __LINE__);
+                }
+
+            memset(&rules[Rule_Profile_Local->size], 0, ( size - Rule_Profile_Local->size ) * sizeof(_Rule_Profile));
+
+            Rule_Profile_Local->rules = rules;
+            Rule_Profile_Local->size = size;
+
+            pthread_mutex_unlock(&Rule_Profile_Mutex);
+
+        }
+
+    return(&Rule_Profile_Local->rules[rule]);
+}
+
+/****************************************************************************
+ * Rule_Profile_Start/Rule_Profile_Stop - Time one rule
+ ****************************************************************************/
+
+void Rule_Profile_Start( struct timespec *start )
+{
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+void Rule_Profile_Stop( _Rule_Profile *profile, struct timespec *start )
+{
+
+    struct timespec stop;
+    uint64_t nsec;
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    nsec = (uint64_t)( stop.tv_sec - start->tv_sec ) * 1000000000 + stop.tv_nsec - start->tv_nsec;
+
+    profile->nsec += nsec;
+
+    if ( nsec > profile->nsec_max )
+        {
+            profile->nsec_max = nsec;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Profile_Reset - Forget everything.  Rule numbers mean something
+ * else after a reload
+ ****************************************************************************/
+
+void Rule_Profile_Reset( void )
+{
+
+    _Rule_Profile_Thread *thread = NULL;
+
+    pthread_mutex_lock(&Rule_Profile_Mutex);
+
+    for ( thread = Rule_Profile_Threads; thread != NULL; thread = thread->next )
+        {
+            memset(thread->rules, 0, thread->size * sizeof(_Rule_Profile));
+        }
+
+    pthread_mutex_unlock(&Rule_Profile_Mutex);
+
+}
+
+/****************************************************************************
+ * Rule_Profile_Compare - Most total time first
+ ****************************************************************************/
+
+static int Rule_Profile_Compare( const void *a, const void *b )
+{
+
+    const _Rule_Profile_Entry *x = a;
+    const _Rule_Profile_Entry *y = b;
+
+    if ( x->profile.nsec != y->profile.nsec )
+        {
+            return( x->profile.nsec < y->profile.nsec ? 1 : -1 );
+        }
+
+    return( x->rule - y->rule );
+}
+
+/****************************************************************************
+ * Rule_Profile_Report - Add up every worker's counters and log the most
+ * expensive rules.  Counters are read while workers are still running,
+ * so a report taken under load may be off by an event or two
+ ****************************************************************************/
+
+void Rule_Profile_Report( void )
+{
+
+    _Rule_Profile_Thread *thread = NULL;
+    _Rule_Profile_Entry *entries = NULL;
+    _Rule_Profile *total = NULL;
+    _Rule_Profile *profile = NULL;
+
+    int rule_count = counters->rulecount;
+    int checked = 0;
+    int top = 0;
+    int i;
+
+    uint64_t nsec_all = 0;
+
+    char content[48];
+    char pcre[48];
+    char meta_content[48];
+
+    if ( config->rule_profiling == false || rule_count == 0 )
+        {
+            return;
+        }
+
+    entries = calloc(rule_count, sizeof(_Rule_Profile_Entry));
+
+    if ( entries == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule profiling report. Abort!", __FILE__, __LINE__);
+        }
+
+    pthread_mutex_lock(&Rule_Profile_Mutex);
+
+    for ( thread = Rule_Profile_Threads; thread != NULL; thread = thread->next )
+        {
+
+            for ( i = 0; i < thread->size && i < rule_count; i++ )
+                {
+
+                    profile = &thread->rules[i];
+                    total = &entries[i].profile;
+
+                    total->checks += profile->checks;
+                    total->prefilter_fail += profile->prefilter_fail;
+                    total->content_pass += profile->content_pass;
+                    total->content_fail += profile->content_fail;
+                    total->pcre_pass += profile->pcre_pass;
+                    total->pcre_fail += profile->pcre_fail;
+                    total->meta_content_pass += profile->meta_content_pass;
+                    total->meta_content_fail += profile->meta_content_fail;
+                    total->matches += profile->matches;
+                    total->alerts += profile->alerts;
+                    total->nsec += profile->nsec;
+
+                    if ( profile->nsec_max > total->nsec_max )
+                        {
+                            total->nsec_max = profile->nsec_max;
+                        }
+                }
+        }
+
+    pthread_mutex_unlock(&Rule_Profile_Mutex);
+
+    /* Only rules the engine has looked at are worth reporting */
+
+    for ( i = 0; i < rule_count; i++ )
+        {
+
+            if ( entries[i].profile.checks == 0 )
+                {
+                    continue;
+                }
+
+            nsec_all += entries[i].profile.nsec;
+
+            entries[i].rule = i;
+            entries[checked++] = entries[i];
+        }
+
+    qsort(entries, checked, sizeof(_Rule_Profile_Entry), Rule_Profile_Compare);
+
+    top = config->rule_profiling_top == 0 || config->rule_profiling_top > checked ? checked : config->rule_profiling_top;
+
+    Sagan_Log(S_NORMAL, "");
+    Sagan_Log(S_NORMAL, "          -[ Sagan Rule Profiling ]-");
+    Sagan_Log(S_NORMAL, "");
+    Sagan_Log(S_NORMAL, "           Rules checked            : %d of %d", checked, rule_count);
+    Sagan_Log(S_NORMAL, "           Total rule time          : %.3f ms", (double)nsec_all / 1000000);
+    Sagan_Log(S_NORMAL, "           Showing                  : %d (by total time)", top);
+    Sagan_Log(S_NORMAL, "");
+    Sagan_Log(S_NORMAL, "   Num        SID  Rev      Checks  Prefilter%%       Content p/f          Pcre p/f          Meta p/f     Matches      Alerts    Avg ns     Max ns     Total ms   Time%%");
+    Sagan_Log(S_NORMAL, "   ---  ---------  ---  ----------  ----------  ----------------  ----------------  ----------------  ----------  ----------  --------  ---------  -----------  ------");
+
+    for ( i = 0; i < top; i++ )
+        {
+
+            profile = &entries[i].profile;
+
+            snprintf(content, sizeof(content), "%" PRIu64 "/%" PRIu64 "", profile->content_pass, profile->content_fail);
+            snprintf(pcre, sizeof(pcre), "%" PRIu64 "/%" PRIu64 "", profile->pcre_pass, profile->pcre_fail);
+            snprintf(meta_content, sizeof(meta_content), "%" PRIu64 "/%" PRIu64 "", profile->meta_content_pass, profile->meta_content_fail);
+
+            Sagan_Log(S_NORMAL, "   %3d  %9s  %3s  %10" PRIu64 "  %9.3f%%  %16s  %16s  %16s  %10" PRIu64 "  %10" PRIu64 "  %8" PRIu64 "  %9" PRIu64 "  %11.3f  %5.2f%%",
+                      i + 1,
+                      rulestruct[entries[i].rule].s_sid,
+                      rulestruct[entries[i].rule].s_rev,
+                      profile->checks,
+                      CalcPct(profile->checks - profile->prefilter_fail, profile->checks),
+                      content,
+                      pcre,
+                      meta_content,
+                      profile->matches,
+                      profile->alerts,
+                      profile->nsec / profile->checks,
+                      profile->nsec_max,
+                      (double)profile->nsec / 1000000,
+                      CalcPct(profile->nsec, nsec_all));
+        }
+
+    Sagan_Log(S_NORMAL, "");
+
+    free(entries);
+
+}
@@ -0,0 +1,67 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+/* Rules shown by Rule_Profile_Report() when "rule-profiling-top" isn't set */
+
+#define RULE_PROFILE_TOP	25
+
+/* What the engine did with one rule.  Each worker thread keeps its own
+ * (see Rule_Profile_Get()),  they are added up for the report */
+
+typedef struct _Rule_Profile _Rule_Profile;
+struct _Rule_Profile
+{
+    uint64_t checks;			/* Times the engine looked at the rule */
+    uint64_t prefilter_fail;		/* ... and the program/header/prefilter ruled it out */
+
+    uint64_t content_pass;
+    uint64_t content_fail;
+    uint64_t pcre_pass;
+    uint64_t pcre_fail;
+    uint64_t meta_content_pass;
+    uint64_t meta_content_fail;
+
+    uint64_t matches;			/* content,  pcre and meta_content all matched */
+    uint64_t alerts;			/* ... and it made it past flow/xbit/threshold/after/etc */
+
+    uint64_t nsec;
+    uint64_t nsec_max;
+};
+
+typedef struct _Rule_Profile_Thread _Rule_Profile_Thread;
+struct _Rule_Profile_Thread
+{
+    _Rule_Profile *rules;
+    int size;
+    _Rule_Profile_Thread *next;
+};
+
+_Rule_Profile *Rule_Profile_Get( int );
+void Rule_Profile_Start( struct timespec * );
+void Rule_Profile_Stop( _Rule_Profile *, struct timespec * );
+void Rule_Profile_Reset( void );
+void Rule_Profile_Report( void );
@@ -0,0 +1,1360 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+/* rules-index.c
+ *
+ * Indexes the loaded rules by "program" so the engine only looks at rules
+ * that can match an event's program.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "rules.h"
+#include "rules-index.h"
+#include "lockfile.h"
+
+struct _SaganCounters *counters;
+struct _SaganConfig *config;
+struct _SaganDebug *debug;
+struct _Rule_Struct *rulestruct;
+
+_Rule_Index *SaganRuleIndex = NULL;
+
+/* Rule_Index_Anchor() returns this when a rule is prefiltered on the
+ * literal from its pcre (see PCRE_Literal()),  not a content */
+
+#define RULE_INDEX_ANCHOR_PCRE	MAX_CONTENT
+
+static _Rule_Index_Program *Rule_Index_Add( _Rule_Index_Program **, uint32_t, int *, const char *, int );
+static void Rule_Index_Add_Wildcard( _Rule_Index *, const char *, int );
+static void Rule_Index_Trie_Add( _Rule_Index_Trie *, const char *, size_t, sbool, int );
+static void Rule_Index_Mark( _Rule_Index *, uint64_t *, int );
+static sbool Rule_Index_Glob( const char *, const char * );
+static uint32_t Rule_Index_Trie_Child( _Rule_Index_Trie *, uint32_t, unsigned char );
+static void Rule_Index_Headers( _Rule_Index * );
+static void Rule_Index_Patterns( _Rule_Index * );
+static void Rule_Index_Code( _Rule_Index * );
+static int Rule_Index_Anchor( int, uint32_t *, int * );
+static const char *Rule_Index_Anchor_String( int, int );
+static sbool Rule_Index_Anchor_Nocase( int, int );
+static uint32_t *Rule_Index_Sample( int *, int * );
+static int Rule_Index_Intern( _Rule_Index_Header *, const char *, sbool );
+static const char *Rule_Index_Header_Value( int, int );
+static void Rule_Index_Free( _Rule_Index * );
+
+/****************************************************************************
+ * Rule_Index_Build - Builds a new index over every loaded rule and makes it
+ * the current one.  Called once the rules are loaded,  and again whenever
+ * dynamic rules are added.  Workers may still be walking the old index,  so
+ * it's kept until the next reload (when they are parked).
+ ****************************************************************************/
+
+void Rule_Index_Build( void )
+{
+
+    _Rule_Index *index;
+    _Rule_Index_Program *entry;
+
+    char program[sizeof(rulestruct[0].s_program)];
+    char *ptmp;
+    char *tok = NULL;
+
+    uint32_t size = 64;
+    int b;
+
+    index = calloc(1, sizeof(_Rule_Index));
+
+    if ( index == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+        }
+
+    /* Keep the table at most half full,  assuming one program per rule */
+
+    while ( size < (uint32_t)counters->rulecount * 2 )
+        {
+            size <<= 1;
+        }
+
+    index->buckets = calloc(size, sizeof(_Rule_Index_Program *));
+    index->wildcard_buckets = calloc(size, sizeof(_Rule_Index_Program *));
+    index->generic = malloc((counters->rulecount + 1) * sizeof(int));
+    index->rules = calloc(counters->rulecount + 1, sizeof(_Rule_Index_Rule));
+
+    if ( index->buckets == NULL || index->wildcard_buckets == NULL || index->generic == NULL || index->rules == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+        }
+
+    index->mask = size - 1;
+    index->wildcard_mask = size - 1;
+    index->rule_count = counters->rulecount;
+
+    for ( b = 0; b < counters->rulecount; b++ )
+        {
+
+            if ( rulestruct[b].s_program[0] == '\0' )
+                {
+                    index->generic[index->generic_count++] = b;
+                    continue;
+                }
+
+            /* Exact names are indexed.  A rule with any wildcard is also
+             * checked against every event,  but only its wildcards need
+             * testing (see Rule_Index_Wildcard()) */
+
+            if ( strpbrk(rulestruct[b].s_program, "*?") != NULL )
+                {
+                    index->generic[index->generic_count++] = b;
+                    index->rules[b].wildcard = true;
+                }
+
+            strlcpy(program, rulestruct[b].s_program, sizeof(program));
+            ptmp = strtok_r(program, "|", &tok);
+
+            while ( ptmp != NULL )
+                {
+
+                    if ( strpbrk(ptmp, "*?") != NULL )
+                        {
+                            Rule_Index_Add_Wildcard(index, ptmp, b);
+                        }
+                    else
+                        {
+                            Rule_Index_Add(index->buckets, index->mask, &index->program_count, ptmp, b);
+                        }
+
+                    ptmp = strtok_r(NULL, "|", &tok);
+                }
+        }
+
+    /* Wildcard patterns by number,  for the tries */
+
+    index->wildcard = malloc((index->wildcard_count + 1) * sizeof(_Rule_Index_Program *));
+
+    if ( index->wildcard == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( size = 0; size <= index->wildcard_mask; size++ )
+        {
+            for ( entry = index->wildcard_buckets[size]; entry != NULL; entry = entry->next )
+                {
+                    index->wildcard[entry->id] = entry;
+                }
+        }
+
+    Rule_Index_Headers(index);
+    Rule_Index_Patterns(index);
+    Rule_Index_Code(index);
+
+    /* On a reload the workers are paused (Processor_Pause()),  so the old
+     * index can go.  A dynamic load happens on a worker while the others
+     * run,  so the old one is kept */
+
+    if ( SaganRuleIndex != NULL )
+        {
+
+            if ( config->sagan_reload == true )
+                {
+                    Rule_Index_Free(SaganRuleIndex);
+                }
+            else
+                {
+                    index->retired = SaganRuleIndex;
+                }
+
+        }
+
+    __atomic_store_n(&SaganRuleIndex, index, __ATOMIC_RELEASE);
+
+    if ( debug->debugload )
+        {
+
+            for ( size = 0; size <= index->mask; size++ )
+                {
+                    for ( entry = index->buckets[size]; entry != NULL; entry = entry->next )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] Program '%s' has %d rule(s).", __FILE__, __LINE__, entry->program, entry->count);
+                        }
+                }
+
+        }
+
+    Sagan_Log(S_NORMAL, "Rule index: %d program(s) and %d wildcard(s) (%d not prefix/suffix).  %d of %d rule(s) are checked against every event.", index->program_count, index->wildcard_count, index->glob_count, index->generic_count, counters->rulecount);
+    Sagan_Log(S_NORMAL, "Rule index: %d of %d rule(s) prefiltered on %d pattern(s) (%d on a pcre literal).", index->prefilter_count, counters->rulecount, index->pattern_count, index->pcre_literal_count);
+
+    if ( index->pcre_unfiltered_count != 0 )
+        {
+            Sagan_Log(S_NORMAL, "Rule index: %d rule(s) with pcre but no content have no literal to prefilter on.  Their pcre runs on every event (see '-d load').", index->pcre_unfiltered_count);
+        }
+    if ( debug->debugload )
+        {
+            Sagan_Log(S_DEBUG, "[%s, line %d] Rule index: %u op(s) (%lu bytes) and %u bytes of content.", __FILE__, __LINE__, index->code_count, (unsigned long)index->code_count * sizeof(_Rule_Index_Op), index->strings_len);
+        }
+
+    Sagan_Log(S_NORMAL, "Rule index: %d facilities,  %d priorities,  %d levels and %d tags.", index->header[RULE_INDEX_FACILITY].count, index->header[RULE_INDEX_PRIORITY].count, index->header[RULE_INDEX_LEVEL].count, index->header[RULE_INDEX_TAG].count);
+
+}
+
+/****************************************************************************
+ * Rule_Index_Add - Adds rule 'b' to the list for 'program' in a table,
+ * creating it (and counting it in 'count') if needed.  Returns the entry.
+ ****************************************************************************/
+
+static _Rule_Index_Program *Rule_Index_Add( _Rule_Index_Program **buckets, uint32_t mask, int *count, const char *program, int b )
+{
+
+    _Rule_Index_Program *entry;
+    uint32_t hash = Djb2_Hash((char *)program);
+
+    for ( entry = buckets[hash & mask]; entry != NULL; entry = entry->next )
+        {
+            if ( entry->hash == hash && !strcmp(entry->program, program) )
+                {
+                    break;
+                }
+        }
+
+    if ( entry == NULL )
+        {
+
+            entry = calloc(1, sizeof(_Rule_Index_Program));
+
+            if ( entry == NULL || ( entry->program = strdup(program) ) == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                }
+
+            entry->hash = hash;
+            entry->id = (*count)++;
+            entry->next = buckets[hash & mask];
+            buckets[hash & mask] = entry;
+        }
+
+    /* "program: sshd|sshd" */
+
+    if ( entry->count > 0 && entry->rules[entry->count - 1] == b )
+        {
+            return(entry);
+        }
+
+    if ( entry->count == entry->size )
+        {
+
+            entry->size = entry->size == 0 ? 8 : entry->size * 2;
+            entry->rules = realloc(entry->rules, entry->size * sizeof(int));
+
+            if ( entry->rules == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                }
+
+        }
+
+    entry->rules[entry->count++] = b;
+
+    return(entry);
+}
+
+/****************************************************************************
+ * Rule_Index_Add_Wildcard - Adds a wildcard "program" pattern for rule 'b'.
+ * The first time we see a pattern,  it goes in the prefix or suffix trie
+ * if it's "name*" or "*name",  otherwise on the glob list.
+ ****************************************************************************/
+
+static void Rule_Index_Add_Wildcard( _Rule_Index *index, const char *pattern, int b )
+{
+
+    _Rule_Index_Program *entry;
+    int count = index->wildcard_count;
+    size_t len = strlen(pattern);
+
+    entry = Rule_Index_Add(index->wildcard_buckets, index->wildcard_mask, &index->wildcard_count, pattern, b);
+
+    if ( index->wildcard_count == count )
+        {
+            return;
+        }
+
+    if ( pattern[len - 1] == '*' && strcspn(pattern, "*?") == len - 1 )
+        {
+            Rule_Index_Trie_Add(&index->prefix, pattern, len - 1, false, entry->id);
+        }
+
+    else if ( pattern[0] == '*' && strcspn(pattern + 1, "*?") == len - 1 )
+        {
+            Rule_Index_Trie_Add(&index->suffix, pattern + 1, len - 1, true, entry->id);
+        }
+
+    else
+        {
+
+            index->glob = realloc(index->glob, index->wildcard_count * sizeof(int));
+
+            if ( index->glob == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                }
+
+            index->glob[index->glob_count++] = entry->id;
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Index_Trie_Add - Adds the first 'len' bytes of 's' (last byte first
+ * if 'reverse' is set) to a trie,  ending at wildcard pattern 'id'
+ ****************************************************************************/
+
+static void Rule_Index_Trie_Add( _Rule_Index_Trie *trie, const char *s, size_t len, sbool reverse, int id )
+{
+
+    _Rule_Index_Trie_Node *node;
+    unsigned char c;
+    uint32_t state = 0;
+    uint32_t next;
+    size_t i;
+
+    for ( i = 0; i <= len; i++ )
+        {
+
+            /* The root is added with the first pattern */
+
+            if ( i == 0 && trie->count > 0 )
+                {
+                    continue;
+                }
+
+            if ( trie->count == trie->size )
+                {
+
+                    trie->size = trie->size == 0 ? 64 : trie->size * 2;
+                    trie->nodes = realloc(trie->nodes, trie->size * sizeof(_Rule_Index_Trie_Node));
+
+                    if ( trie->nodes == NULL )
+                        {
+                            Remove_Lock_File();
+                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                        }
+
+                }
+
+            if ( i == 0 )
+                {
+                    node = &trie->nodes[trie->count++];
+                    memset(node, 0, sizeof(_Rule_Index_Trie_Node));
+                    node->pattern = -1;
+                    continue;
+                }
+
+            c = reverse ? s[len - i] : s[i - 1];
+            next = Rule_Index_Trie_Child(trie, state, c);
+
+            if ( next == 0 )
+                {
+                    next = trie->count++;
+                    node = &trie->nodes[next];
+                    memset(node, 0, sizeof(_Rule_Index_Trie_Node));
+                    node->pattern = -1;
+                    node->c = c;
+                    node->sibling = trie->nodes[state].child;
+                    trie->nodes[state].child = next;
+                }
+
+            state = next;
+        }
+
+    trie->nodes[state].pattern = id;
+
+}
+
+/****************************************************************************
+ * Rule_Index_Trie_Child - Returns a node's child for a byte,  or 0
+ ****************************************************************************/
+
+static uint32_t Rule_Index_Trie_Child( _Rule_Index_Trie *trie, uint32_t state, unsigned char c )
+{
+
+    uint32_t next;
+
+    for ( next = trie->nodes[state].child; next != 0; next = trie->nodes[next].sibling )
+        {
+            if ( trie->nodes[next].c == c )
+                {
+                    return(next);
+                }
+        }
+
+    return(0);
+}
+
+/****************************************************************************
+ * Rule_Index_Glob - "*" and "?" matching,  without recursion.  On a
+ * mismatch we go back to the last "*" and let it eat one more byte.
+ ****************************************************************************/
+
+static sbool Rule_Index_Glob( const char *pattern, const char *text )
+{
+
+    const char *star = NULL;
+    const char *retry = NULL;
+
+    while ( *text != '\0' )
+        {
+
+            if ( *pattern == '*' )
+                {
+                    star = ++pattern;
+                    retry = text;
+                }
+
+            else if ( *pattern == '?' || *pattern == *text )
+                {
+                    pattern++;
+                    text++;
+                }
+
+            else if ( star != NULL )
+                {
+                    pattern = star;
+                    text = ++retry;
+                }
+
+            else
+                {
+                    return(false);
+                }
+        }
+
+    while ( *pattern == '*' )
+        {
+            pattern++;
+        }
+
+    return(*pattern == '\0');
+}
+
+/****************************************************************************
+ * Rule_Index_Mark - Sets the bit for every rule using wildcard 'pattern'
+ ****************************************************************************/
+
+static void Rule_Index_Mark( _Rule_Index *index, uint64_t *found, int pattern )
+{
+
+    _Rule_Index_Program *entry;
+    int i;
+
+    if ( pattern == -1 )
+        {
+            return;
+        }
+
+    entry = index->wildcard[pattern];
+
+    for ( i = 0; i < entry->count; i++ )
+        {
+            found[entry->rules[i] >> 6] |= 1ULL << ( entry->rules[i] & 63 );
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Index_Wildcard - Works out which rules have a wildcard "program"
+ * that matches.  Returns a bit set by rule number.  The set belongs to
+ * the calling thread and is reused on the next call.
+ ****************************************************************************/
+
+uint64_t *Rule_Index_Wildcard( _Rule_Index *index, const char *program )
+{
+
+    static __thread uint64_t *found = NULL;
+    static __thread int found_words = 0;
+
+    _Rule_Index_Trie *trie;
+    size_t len = strlen(program);
+    uint32_t state;
+    size_t i;
+    int words = ( index->rule_count + 63 ) / 64 + 1;
+    int g;
+
+    if ( words > found_words )
+        {
+
+            free(found);
+            found = malloc(words * sizeof(uint64_t));
+
+            if ( found == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the wildcard set. Abort!", __FILE__, __LINE__);
+                }
+
+            found_words = words;
+        }
+
+    memset(found, 0, words * sizeof(uint64_t));
+
+    /* "name*" matches at every node on the way down (the "*" can be
+     * empty).  "*name" is the same,  walking the program backwards */
+
+    trie = &index->prefix;
+
+    if ( trie->count > 0 )
+        {
+
+            state = 0;
+            Rule_Index_Mark(index, found, trie->nodes[0].pattern);
+
+            for ( i = 0; i < len; i++ )
+                {
+
+                    state = Rule_Index_Trie_Child(trie, state, program[i]);
+
+                    if ( state == 0 )
+                        {
+                            break;
+                        }
+
+                    Rule_Index_Mark(index, found, trie->nodes[state].pattern);
+                }
+        }
+
+    trie = &index->suffix;
+
+    if ( trie->count > 0 )
+        {
+
+            state = 0;
+            Rule_Index_Mark(index, found, trie->nodes[0].pattern);
+
+            for ( i = len; i > 0; i-- )
+                {
+
+                    state = Rule_Index_Trie_Child(trie, state, program[i - 1]);
+
+                    if ( state == 0 )
+                        {
+                            break;
+                        }
+
+                    Rule_Index_Mark(index, found, trie->nodes[state].pattern);
+                }
+        }
+
+    for ( g = 0; g < index->glob_count; g++ )
+        {
+            if ( Rule_Index_Glob(index->wildcard[index->glob[g]]->program, program) == true )
+                {
+                    Rule_Index_Mark(index, found, index->glob[g]);
+                }
+        }
+
+    return(found);
+}
+
+/****************************************************************************
+ * Rule_Index_Header_Value - Returns a rule's "|" separated list for a
+ * RULE_INDEX_* header field
+ ****************************************************************************/
+
+static const char *Rule_Index_Header_Value( int b, int h )
+{
+
+    switch ( h )
+        {
+
+        case RULE_INDEX_FACILITY:
+            return(rulestruct[b].s_facility);
+
+        case RULE_INDEX_PRIORITY:
+            return(rulestruct[b].s_syspri);
+
+        case RULE_INDEX_LEVEL:
+            return(rulestruct[b].s_level);
+
+        }
+
+    return(rulestruct[b].s_tag);
+}
+
+/****************************************************************************
+ * Rule_Index_Headers - Numbers every facility,  priority,  level and tag
+ * named by a rule,  then turns each rule's lists into bit sets.  The engine
+ * numbers the event's fields once (Rule_Index_Event()) and each rule check
+ * becomes a bit test,  rather than a strtok_r()/strcmp() loop.
+ ****************************************************************************/
+
+static void Rule_Index_Headers( _Rule_Index *index )
+{
+
+    _Rule_Index_Header *header;
+
+    char value[64];
+    const char *list;
+    char *ptmp;
+    char *tok = NULL;
+
+    uint32_t size;
+    int values;
+    int words;
+    int id;
+    int b;
+    int h;
+
+    for ( h = 0; h < RULE_INDEX_HEADER_COUNT; h++ )
+        {
+
+            header = &index->header[h];
+
+            /* Size the table for the most values we could see */
+
+            values = 0;
+
+            for ( b = 0; b < counters->rulecount; b++ )
+                {
+
+                    list = Rule_Index_Header_Value(b, h);
+
+                    if ( list[0] != '\0' )
+                        {
+
+                            values++;
+
+                            while ( ( list = strchr(list, '|') ) != NULL )
+                                {
+                                    values++;
+                                    list++;
+                                }
+                        }
+                }
+
+            size = 16;
+
+            while ( size < (uint32_t)values * 2 )
+                {
+                    size <<= 1;
+                }
+
+            header->buckets = calloc(size, sizeof(_Rule_Index_Value *));
+
+            if ( header->buckets == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                }
+
+            header->mask = size - 1;
+
+            /* Number the values... */
+
+            for ( b = 0; b < counters->rulecount; b++ )
+                {
+
+                    list = Rule_Index_Header_Value(b, h);
+
+                    if ( list[0] == '\0' )
+                        {
+                            continue;
+                        }
+
+                    strlcpy(value, list, sizeof(value));
+                    ptmp = strtok_r(value, "|", &tok);
+
+                    while ( ptmp != NULL )
+                        {
+                            Rule_Index_Intern(header, ptmp, true);
+                            ptmp = strtok_r(NULL, "|", &tok);
+                        }
+                }
+
+            /* ... then build each rule's bit set now we know how big they are */
+
+            words = ( header->count + 63 ) / 64;
+
+            for ( b = 0; b < counters->rulecount; b++ )
+                {
+
+                    list = Rule_Index_Header_Value(b, h);
+
+                    if ( list[0] == '\0' )
+                        {
+                            continue;
+                        }
+
+                    index->rules[b].header[h] = calloc(words, sizeof(uint64_t));
+
+                    if ( index->rules[b].header[h] == NULL )
+                        {
+                            Remove_Lock_File();
+                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                        }
+
+                    index->rules[b].checks_header = true;
+
+                    strlcpy(value, list, sizeof(value));
+                    ptmp = strtok_r(value, "|", &tok);
+
+                    while ( ptmp != NULL )
+                        {
+                            id = Rule_Index_Intern(header, ptmp, false);
+                            index->rules[b].header[h][id >> 6] |= 1ULL << ( id & 63 );
+                            ptmp = strtok_r(NULL, "|", &tok);
+                        }
+                }
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Index_Intern - Returns the number for a header value.  If 'add' is
+ * set,  values we haven't seen get the next number.  Otherwise returns -1
+ * for them.
+ ****************************************************************************/
+
+static int Rule_Index_Intern( _Rule_Index_Header *header, const char *value, sbool add )
+{
+
+    _Rule_Index_Value *entry;
+    uint32_t hash = Djb2_Hash((char *)value);
+
+    for ( entry = header->buckets[hash & header->mask]; entry != NULL; entry = entry->next )
+        {
+            if ( entry->hash == hash && !strcmp(entry->value, value) )
+                {
+                    return(entry->id);
+                }
+        }
+
+    if ( add == false )
+        {
+            return(-1);
+        }
+
+    entry = calloc(1, sizeof(_Rule_Index_Value));
+
+    if ( entry == NULL || ( entry->value = strdup(value) ) == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+        }
+
+    entry->hash = hash;
+    entry->id = header->count++;
+    entry->next = header->buckets[hash & header->mask];
+    header->buckets[hash & header->mask] = entry;
+
+    return(entry->id);
+}
+
+/****************************************************************************
+ * Rule_Index_Sample - Counts how many lines of the "fast-pattern-sample"
+ * log each positive content appears in.  'ids' gets a number for each
+ * rule's contents (rulecount * MAX_CONTENT) which indexes the returned
+ * counts.  Returns NULL if the sample can't be read.
+ ****************************************************************************/
+
+static uint32_t *Rule_Index_Sample( int *ids, int *lines )
+{
+
+    _Aho_Corasick *ac;
+    _Aho_Corasick *ac_nocase;
+
+    FILE *sample;
+    char line[MAX_SYSLOGMSG];
+
+    uint32_t *counts;
+    uint64_t *found;
+    uint64_t bits;
+    int words;
+    int b;
+    int z;
+    int w;
+
+    if (( sample = fopen(config->fast_pattern_sample, "r" )) == NULL )
+        {
+            Sagan_Log(S_WARN, "[%s, line %d] Cannot open fast-pattern-sample '%s' (%s).  Using the longest content.", __FILE__, __LINE__, config->fast_pattern_sample, strerror(errno));
+            return(NULL);
+        }
+
+    ac = Aho_Corasick_New(false, 0);
+
+    for ( b = 0; b < counters->rulecount; b++ )
+        {
+            for ( z = 0; z < rulestruct[b].content_count; z++ )
+                {
+                    if ( rulestruct[b].content_not[z] == false && rulestruct[b].s_nocase[z] == false )
+                        {
+                            ids[b * MAX_CONTENT + z] = Aho_Corasick_Add(ac, rulestruct[b].s_content[z]);
+                        }
+                }
+        }
+
+    ac_nocase = Aho_Corasick_New(true, ac->pattern_count);
+
+    for ( b = 0; b < counters->rulecount; b++ )
+        {
+            for ( z = 0; z < rulestruct[b].content_count; z++ )
+                {
+                    if ( rulestruct[b].content_not[z] == false && rulestruct[b].s_nocase[z] == true )
+                        {
+                            ids[b * MAX_CONTENT + z] = Aho_Corasick_Add(ac_nocase, rulestruct[b].s_content[z]);
+                        }
+                }
+        }
+
+    Aho_Corasick_Compile(ac);
+    Aho_Corasick_Compile(ac_nocase);
+
+    words = ( ac->pattern_count + ac_nocase->pattern_count + 63 ) / 64 + 1;
+
+    counts = calloc(ac->pattern_count + ac_nocase->pattern_count + 1, sizeof(uint32_t));
+    found = malloc(words * sizeof(uint64_t));
+
+    if ( counts == NULL || found == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the fast-pattern-sample. Abort!", __FILE__, __LINE__);
+        }
+
+    *lines = 0;
+
+    while ( *lines < RULE_INDEX_SAMPLE_LINES && fgets(line, sizeof(line), sample) != NULL )
+        {
+
+            memset(found, 0, words * sizeof(uint64_t));
+
+            Aho_Corasick_Search(ac, line, found);
+            Aho_Corasick_Search(ac_nocase, line, found);
+
+            for ( w = 0; w < words; w++ )
+                {
+                    for ( bits = found[w]; bits != 0; bits &= bits - 1 )
+                        {
+                            counts[w * 64 + __builtin_ctzll(bits)]++;
+                        }
+                }
+
+            (*lines)++;
+        }
+
+    fclose(sample);
+    free(found);
+
+    Aho_Corasick_Free(ac);
+    Aho_Corasick_Free(ac_nocase);
+
+    Sagan_Log(S_NORMAL, "Read %d line(s) from fast-pattern-sample '%s'.", *lines, config->fast_pattern_sample);
+
+    return(counts);
+}
+
+/****************************************************************************
+ * Rule_Index_Anchor - Returns the content a rule is prefiltered on,  or -1
+ * if it has no positive content.  That's the "fast_pattern" one if there
+ * is one.  Otherwise the one seen in the fewest sample lines (if we have a
+ * sample),  then the longest.  Rules with no positive content use their
+ * pcre literal,  if there is one (RULE_INDEX_ANCHOR_PCRE).
+ ****************************************************************************/
+
+static int Rule_Index_Anchor( int b, uint32_t *counts, int *ids )
+{
+
+    int best = -1;
+    int z;
+
+    for ( z = 0; z < rulestruct[b].content_count; z++ )
+        {
+
+            if ( rulestruct[b].content_not[z] == true )
+                {
+                    continue;
+                }
+
+            if ( rulestruct[b].s_fast_pattern[z] == true )
+                {
+                    return(z);
+                }
+
+            if ( best == -1 )
+                {
+                    best = z;
+                }
+
+            else if ( counts != NULL && counts[ids[b * MAX_CONTENT + z]] != counts[ids[b * MAX_CONTENT + best]] )
+                {
+                    if ( counts[ids[b * MAX_CONTENT + z]] < counts[ids[b * MAX_CONTENT + best]] )
+                        {
+                            best = z;
+                        }
+                }
+
+            else if ( strlen(rulestruct[b].s_content[z]) > strlen(rulestruct[b].s_content[best]) )
+                {
+                    best = z;
+                }
+        }
+
+    if ( best == -1 && rulestruct[b].pcre_literal[0] != '\0' )
+        {
+            best = RULE_INDEX_ANCHOR_PCRE;
+        }
+
+    return(best);
+}
+
+/****************************************************************************
+ * Rule_Index_Anchor_String/Nocase - What a rule's anchor searches for
+ ****************************************************************************/
+
+static const char *Rule_Index_Anchor_String( int b, int anchor )
+{
+    return( anchor == RULE_INDEX_ANCHOR_PCRE ? rulestruct[b].pcre_literal : rulestruct[b].s_content[anchor] );
+}
+
+static sbool Rule_Index_Anchor_Nocase( int b, int anchor )
+{
+    return( anchor == RULE_INDEX_ANCHOR_PCRE ? rulestruct[b].pcre_literal_nocase : rulestruct[b].s_nocase[anchor] );
+}
+
+/****************************************************************************
+ * Rule_Index_Patterns - Adds each rule's anchor content to the prefilter.
+ * If that content isn't anywhere in a message,  the rule can't match it.
+ * Rules with no positive content are always evaluated.
+ ****************************************************************************/
+
+static void Rule_Index_Patterns( _Rule_Index *index )
+{
+
+    uint32_t *counts = NULL;
+    int *ids = NULL;
+    int lines = 0;
+    int keep = 0;
+    int b;
+
+    /* A dynamic load runs on a worker holding SaganRulesLoadedMutex,  so
+     * re-reading the sample there would stall every other worker that
+     * reaches a dynamic rule.  Rules already loaded keep the anchor picked
+     * at the last full load and the new ones go without the sample */
+
+    if ( SaganRuleIndex != NULL && config->sagan_reload == false )
+        {
+            keep = SaganRuleIndex->rule_count;
+        }
+
+    if ( config->fast_pattern_sample[0] != '\0' && keep == 0 )
+        {
+
+            ids = calloc((size_t)counters->rulecount * MAX_CONTENT + 1, sizeof(int));
+
+            if ( ids == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+                }
+
+            counts = Rule_Index_Sample(ids, &lines);
+        }
+
+    for ( b = 0; b < keep; b++ )
+        {
+            index->rules[b].anchor = SaganRuleIndex->rules[b].anchor;
+        }
+
+    for ( b = keep; b < counters->rulecount; b++ )
+        {
+            index->rules[b].anchor = Rule_Index_Anchor(b, counts, ids);
+        }
+
+    /* Case sensitive patterns are numbered from 0,  nocase ones after them */
+
+    index->prefilter = Aho_Corasick_New(false, 0);
+
+    for ( b = 0; b < counters->rulecount; b++ )
+        {
+
+            index->rules[b].pattern = -1;
+
+            if ( index->rules[b].anchor != -1 && Rule_Index_Anchor_Nocase(b, index->rules[b].anchor) == false )
+                {
+                    index->rules[b].pattern = Aho_Corasick_Add(index->prefilter, Rule_Index_Anchor_String(b, index->rules[b].anchor));
+                    index->prefilter_count++;
+                }
+
+            if ( index->rules[b].anchor == RULE_INDEX_ANCHOR_PCRE )
+                {
+                    index->pcre_literal_count++;
+                }
+
+            else if ( index->rules[b].anchor == -1 && rulestruct[b].pcre_count != 0 )
+                {
+                    index->pcre_unfiltered_count++;
+                }
+        }
+
+    index->prefilter_nocase = Aho_Corasick_New(true, index->prefilter->pattern_count);
+
+    for ( b = 0; b < counters->rulecount; b++ )
+        {
+            if ( index->rules[b].anchor != -1 && Rule_Index_Anchor_Nocase(b, index->rules[b].anchor) == true )
+                {
+                    index->rules[b].pattern = Aho_Corasick_Add(index->prefilter_nocase, Rule_Index_Anchor_String(b, index->rules[b].anchor));
+                    index->prefilter_count++;
+                }
+        }
+
+    Aho_Corasick_Compile(index->prefilter);
+    Aho_Corasick_Compile(index->prefilter_nocase);
+
+    index->pattern_count = index->prefilter->pattern_count + index->prefilter_nocase->pattern_count;
+
+    /* So rules that fall back to full evaluation,  or have a poor anchor,
+     * can be found and tuned */
+
+    if ( debug->debugload )
+        {
+
+            for ( b = 0; b < counters->rulecount; b++ )
+                {
+
+                    if ( index->rules[b].anchor == -1 && rulestruct[b].pcre_count != 0 )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: no positive content and no literal could be proven from its pcre.  Always evaluated.", __FILE__, __LINE__, rulestruct[b].s_sid);
+                        }
+
+                    else if ( index->rules[b].anchor == -1 )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: no positive content.  Always evaluated.", __FILE__, __LINE__, rulestruct[b].s_sid);
+                        }
+
+                    else if ( index->rules[b].anchor == RULE_INDEX_ANCHOR_PCRE )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: prefilter on \"%s\" (pcre literal%s).", __FILE__, __LINE__, rulestruct[b].s_sid, rulestruct[b].pcre_literal, rulestruct[b].pcre_literal_nocase ? ",  nocase" : "");
+                        }
+
+                    else if ( rulestruct[b].s_fast_pattern[index->rules[b].anchor] == true )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: prefilter on \"%s\" (fast_pattern).", __FILE__, __LINE__, rulestruct[b].s_sid, rulestruct[b].s_content[index->rules[b].anchor]);
+                        }
+
+                    else if ( b < keep )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: prefilter on \"%s\" (kept from the last full load).", __FILE__, __LINE__, rulestruct[b].s_sid, rulestruct[b].s_content[index->rules[b].anchor]);
+                        }
+
+                    else if ( counts != NULL )
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: prefilter on \"%s\" (in %u of %d sample lines).", __FILE__, __LINE__, rulestruct[b].s_sid, rulestruct[b].s_content[index->rules[b].anchor], counts[ids[b * MAX_CONTENT + index->rules[b].anchor]], lines);
+                        }
+
+                    else
+                        {
+                            Sagan_Log(S_DEBUG, "[%s, line %d] sid %s: prefilter on \"%s\" (longest).", __FILE__, __LINE__, rulestruct[b].s_sid, rulestruct[b].s_content[index->rules[b].anchor]);
+                        }
+                }
+
+        }
+
+    free(counts);
+    free(ids);
+
+}
+
+/****************************************************************************
+ * Rule_Index_Prefilter - Searches a message for every rule's prefilter
+ * pattern.  Returns a bit set (by pattern) of those found.  The set
+ * belongs to the calling thread and is reused on the next call.
+ ****************************************************************************/
+
+uint64_t *Rule_Index_Prefilter( _Rule_Index *index, const char *message )
+{
+
+    static __thread uint64_t *found = NULL;
+    static __thread int found_words = 0;
+
+    int words = ( index->pattern_count + 63 ) / 64 + 1;
+
+    if ( words > found_words )
+        {
+
+            free(found);
+            found = malloc(words * sizeof(uint64_t));
+
+            if ( found == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the prefilter. Abort!", __FILE__, __LINE__);
+                }
+
+            found_words = words;
+        }
+
+    memset(found, 0, words * sizeof(uint64_t));
+
+    Aho_Corasick_Search(index->prefilter, message, found);
+    Aho_Corasick_Search(index->prefilter_nocase, message, found);
+
+    return(found);
+}
+
+/****************************************************************************
+ * Rule_Index_Event - Numbers an event's facility,  priority,  level and tag
+ * (see Rule_Index_Headers()).  'id' has RULE_INDEX_HEADER_COUNT entries.
+ ****************************************************************************/
+
+void Rule_Index_Event( _Rule_Index *index, struct _Sagan_Proc_Syslog *SaganProcSyslog, int *id )
+{
+
+    id[RULE_INDEX_FACILITY] = Rule_Index_Intern(&index->header[RULE_INDEX_FACILITY], SaganProcSyslog->syslog_facility, false);
+    id[RULE_INDEX_PRIORITY] = Rule_Index_Intern(&index->header[RULE_INDEX_PRIORITY], SaganProcSyslog->syslog_priority, false);
+    id[RULE_INDEX_LEVEL] = Rule_Index_Intern(&index->header[RULE_INDEX_LEVEL], SaganProcSyslog->syslog_level, false);
+    id[RULE_INDEX_TAG] = Rule_Index_Intern(&index->header[RULE_INDEX_TAG], SaganProcSyslog->syslog_tag, false);
+
+}
+
+/****************************************************************************
+ * Rule_Index_Lookup - Returns the rules for an exact program,  or NULL
+ ****************************************************************************/
+
+_Rule_Index_Program *Rule_Index_Lookup( _Rule_Index *index, const char *program )
+{
+
+    _Rule_Index_Program *entry;
+    uint32_t hash = Djb2_Hash((char *)program);
+
+    for ( entry = index->buckets[hash & index->mask]; entry != NULL; entry = entry->next )
+        {
+            if ( entry->hash == hash && !strcmp(entry->program, program) )
+                {
+                    return(entry);
+                }
+        }
+
+    return(NULL);
+}
+
+/****************************************************************************
+ * Rule_Index_Code - Compiles each rule's content,  pcre and meta_content
+ * checks into ops,  one rule after another in a single array,  with the
+ * content strings packed into 'strings'.  The engine runs these rather
+ * than reading rulestruct,  which is large and mostly alert data,  so a
+ * rule that doesn't match costs a few cache lines.  rulestruct is only
+ * read once a rule has matched.
+ ****************************************************************************/
+
+static void Rule_Index_Code( _Rule_Index *index )
+{
+
+    _Rule_Index_Op *op;
+    uint32_t strings_size = 0;
+    uint32_t code_size = 0;
+    size_t len;
+    int b;
+    int i;
+
+    for ( b = 0; b < index->rule_count; b++ )
+        {
+
+            code_size += rulestruct[b].content_count + rulestruct[b].pcre_count + rulestruct[b].meta_content_count;
+
+            for ( i = 0; i < rulestruct[b].content_count; i++ )
+                {
+                    strings_size += strlen(rulestruct[b].s_content[i]) + 1;
+                }
+        }
+
+    index->code = malloc((code_size + 1) * sizeof(_Rule_Index_Op));
+    index->strings = malloc(strings_size + 1);
+
+    if ( index->code == NULL || index->strings == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for the rule index. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( b = 0; b < index->rule_count; b++ )
+        {
+
+            index->rules[b].dynamic = rulestruct[b].type == DYNAMIC_RULE;
+            index->rules[b].code = index->code_count;
+            index->rules[b].code_count = rulestruct[b].content_count + rulestruct[b].pcre_count + rulestruct[b].meta_content_count;
+            index->rules[b].op_count[RULE_OP_CONTENT] = rulestruct[b].content_count;
+            index->rules[b].op_count[RULE_OP_PCRE] = rulestruct[b].pcre_count;
+            index->rules[b].op_count[RULE_OP_META_CONTENT] = rulestruct[b].meta_content_count;
+
+            /* In the order the engine has always run them: content,  pcre,
+             * then meta_content */
+
+            for ( i = 0; i < rulestruct[b].content_count; i++ )
+                {
+
+                    op = &index->code[index->code_count++];
+                    memset(op, 0, sizeof(_Rule_Index_Op));
+
+                    op->type = RULE_OP_CONTENT;
+                    op->index = i;
+                    op->nocase = rulestruct[b].s_nocase[i];
+                    op->not = rulestruct[b].content_not[i];
+                    op->offset = rulestruct[b].s_offset[i];
+                    op->depth = rulestruct[b].s_depth[i];
+                    op->distance = rulestruct[b].s_distance[i];
+                    op->prev_depth = i > 0 ? rulestruct[b].s_depth[i-1] : 0;
+                    op->within = rulestruct[b].s_within[i];
+
+                    len = strlen(rulestruct[b].s_content[i]) + 1;
+                    op->string = index->strings_len;
+                    memcpy(index->strings + index->strings_len, rulestruct[b].s_content[i], len);
+                    index->strings_len += len;
+                }
+
+            for ( i = 0; i < rulestruct[b].pcre_count; i++ )
+                {
+
+                    op = &index->code[index->code_count++];
+                    memset(op, 0, sizeof(_Rule_Index_Op));
+
+                    op->type = RULE_OP_PCRE;
+                    op->index = i;
+                }
+
+            for ( i = 0; i < rulestruct[b].meta_content_count; i++ )
+                {
+
+                    op = &index->code[index->code_count++];
+                    memset(op, 0, sizeof(_Rule_Index_Op));
+
+                    op->type = RULE_OP_META_CONTENT;
+                    op->index = i;
+                    op->nocase = rulestruct[b].meta_nocase[i];
+                    op->not = rulestruct[b].meta_content_not[i];
+                    op->offset = rulestruct[b].meta_offset[i];
+                    op->depth = rulestruct[b].meta_depth[i];
+                    op->distance = rulestruct[b].meta_distance[i];
+                    op->prev_depth = i > 0 ? rulestruct[b].meta_depth[i-1] : 0;
+                    op->within = rulestruct[b].meta_within[i];
+                }
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Index_Free - Frees an index and any it retired
+ ****************************************************************************/
+
+static void Rule_Index_Free( _Rule_Index *index )
+{
+
+    _Rule_Index *retired;
+    _Rule_Index_Program *entry;
+    _Rule_Index_Program *next;
+    _Rule_Index_Value *value;
+    _Rule_Index_Value *next_value;
+    uint32_t i;
+    int h;
+    int b;
+
+    while ( index != NULL )
+        {
+
+            for ( i = 0; i <= index->mask; i++ )
+                {
+
+                    for ( entry = index->buckets[i]; entry != NULL; entry = next )
+                        {
+                            next = entry->next;
+                            free(entry->program);
+                            free(entry->rules);
+                            free(entry);
+                        }
+
+                    for ( entry = index->wildcard_buckets[i]; entry != NULL; entry = next )
+                        {
+                            next = entry->next;
+                            free(entry->program);
+                            free(entry->rules);
+                            free(entry);
+                        }
+                }
+
+            free(index->wildcard_buckets);
+            free(index->wildcard);
+            free(index->prefix.nodes);
+            free(index->suffix.nodes);
+            free(index->glob);
+
+            for ( h = 0; h < RULE_INDEX_HEADER_COUNT; h++ )
+                {
+
+                    for ( i = 0; i <= index->header[h].mask && index->header[h].buckets != NULL; i++ )
+                        {
+                            for ( value = index->header[h].buckets[i]; value != NULL; value = next_value )
+                                {
+                                    next_value = value->next;
+                                    free(value->value);
+                                    free(value);
+                                }
+                        }
+
+                    free(index->header[h].buckets);
+
+                    for ( b = 0; b < index->rule_count; b++ )
+                        {
+                            free(index->rules[b].header[h]);
+                        }
+                }
+
+            retired = index->retired;
+
+            Aho_Corasick_Free(index->prefilter);
+            Aho_Corasick_Free(index->prefilter_nocase);
+
+            free(index->code);
+            free(index->strings);
+            free(index->rules);
+            free(index->buckets);
+            free(index->generic);
+            free(index);
+
+            index = retired;
+        }
+
+}
+
@@ -0,0 +1,211 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+
+#include "aho-corasick.h"
+
+/* Most lines read from "fast-pattern-sample" */
+
+#define RULE_INDEX_SAMPLE_LINES	1000000
+
+/* Rules that name exact programs,  by program.  Lists are in rule order */
+
+typedef struct _Rule_Index_Program _Rule_Index_Program;
+struct _Rule_Index_Program
+{
+    char *program;
+    uint32_t hash;
+    int id;
+    int *rules;
+    int count;
+    int size;
+    _Rule_Index_Program *next;
+};
+
+/* "program" patterns with a wildcard.  "name*" and "*name" go in a trie
+ * that's walked forwards or backwards over the event's program,  so one
+ * walk checks all of them.  Anything else is matched on its own */
+
+typedef struct _Rule_Index_Trie_Node _Rule_Index_Trie_Node;
+struct _Rule_Index_Trie_Node
+{
+    uint32_t child;
+    uint32_t sibling;
+    int32_t pattern;			/* Wildcard pattern ending here,  or -1 */
+    unsigned char c;
+};
+
+typedef struct _Rule_Index_Trie _Rule_Index_Trie;
+struct _Rule_Index_Trie
+{
+    _Rule_Index_Trie_Node *nodes;
+    uint32_t count;
+    uint32_t size;
+};
+
+/* Header fields a rule can be limited to (facility:,  level:,  etc) */
+
+#define RULE_INDEX_FACILITY	0
+#define RULE_INDEX_PRIORITY	1
+#define RULE_INDEX_LEVEL	2
+#define RULE_INDEX_TAG		3
+
+#define RULE_INDEX_HEADER_COUNT	4
+
+/* Every value named by any rule for one header field gets a number.  A
+ * rule's list of values becomes a bit set of those numbers */
+
+typedef struct _Rule_Index_Value _Rule_Index_Value;
+struct _Rule_Index_Value
+{
+    char *value;
+    uint32_t hash;
+    int id;
+    _Rule_Index_Value *next;
+};
+
+typedef struct _Rule_Index_Header _Rule_Index_Header;
+struct _Rule_Index_Header
+{
+    _Rule_Index_Value **buckets;
+    uint32_t mask;
+    int count;
+};
+
+/* A rule's content,  pcre and meta_content checks,  compiled into a
+ * short run of ops (see Rule_Index_Code()).  An op has what the engine
+ * needs to run the check,  so matching doesn't go through rulestruct */
+
+#define RULE_OP_CONTENT		0
+#define RULE_OP_PCRE		1
+#define RULE_OP_META_CONTENT	2
+
+#define RULE_OP_TYPES		3
+
+typedef struct _Rule_Index_Op _Rule_Index_Op;
+struct _Rule_Index_Op
+{
+    uint8_t type;			/* RULE_OP_* */
+    uint8_t index;			/* Which content/pcre/meta_content of the rule */
+    sbool nocase;
+    sbool not;				/* content: ! */
+
+    /* Search window (see Sagan_Engine_Window()) */
+
+    int offset;
+    int depth;
+    int distance;
+    int prev_depth;			/* depth of the one before,  which distance is from */
+    int within;
+
+    uint32_t string;			/* content: offset into 'strings' */
+};
+
+/* Per rule.  'header' is NULL for fields the rule doesn't check.  This
+ * and the ops are all the engine reads until a rule matches */
+
+typedef struct _Rule_Index_Rule _Rule_Index_Rule;
+struct _Rule_Index_Rule
+{
+    uint64_t *header[RULE_INDEX_HEADER_COUNT];
+
+    int pattern;			/* Prefilter pattern.  -1 if the rule has no positive content */
+    int anchor;				/* What it came from (see Rule_Index_Anchor()) */
+
+    uint32_t code;			/* First op */
+    uint8_t code_count;
+    uint8_t op_count[RULE_OP_TYPES];	/* ... of each type */
+
+    sbool wildcard;			/* Has a wildcard "program" (see Rule_Index_Wildcard()) */
+    sbool checks_header;
+    sbool dynamic;			/* Only checked when dynamic rules are being looked for */
+};
+
+/* Is value 'id' (from Rule_Index_Event(),  -1 if no rule names it) in
+ * the bit set? */
+
+#define RULE_INDEX_HEADER_MATCH(bits, id)	( (id) >= 0 && ( (bits)[(id) >> 6] & ( 1ULL << ( (id) & 63 ) ) ) )
+
+/* Is bit 'n' set in a prefilter or wildcard result? */
+
+#define RULE_INDEX_BIT(bits, n)		( (bits)[(n) >> 6] & ( 1ULL << ( (n) & 63 ) ) )
+
+typedef struct _Rule_Index _Rule_Index;
+struct _Rule_Index
+{
+
+    _Rule_Index_Program **buckets;
+    uint32_t mask;
+    int program_count;
+
+    /* Rules with no "program",  or with a wildcard in it.  These are
+     * checked against every event */
+
+    int *generic;
+    int generic_count;
+
+    _Rule_Index_Program **wildcard_buckets;
+    _Rule_Index_Program **wildcard;	/* By id */
+    uint32_t wildcard_mask;
+    int wildcard_count;
+
+    _Rule_Index_Trie prefix;		/* "name*" */
+    _Rule_Index_Trie suffix;		/* "*name",  stored backwards */
+    int *glob;				/* Everything else */
+    int glob_count;
+
+    _Rule_Index_Header header[RULE_INDEX_HEADER_COUNT];
+    _Rule_Index_Rule *rules;
+    int rule_count;
+
+    /* One content from each rule,  searched for all at once.  Case
+     * sensitive patterns are numbered first,  then nocase ones */
+
+    _Aho_Corasick *prefilter;
+    _Aho_Corasick *prefilter_nocase;
+    int pattern_count;
+    int prefilter_count;		/* Rules with a pattern */
+    int pcre_literal_count;		/* ... where it came from a pcre */
+    int pcre_unfiltered_count;		/* pcre only rules with no literal we could prove */
+
+    /* Every rule's ops,  one after another,  and the content strings
+     * they search for */
+
+    _Rule_Index_Op *code;
+    uint32_t code_count;
+    char *strings;
+    uint32_t strings_len;
+
+    _Rule_Index *retired;		/* Older indexes a worker may still be using */
+
+};
+
+void Rule_Index_Build( void );
+_Rule_Index_Program *Rule_Index_Lookup( _Rule_Index *, const char * );
+void Rule_Index_Event( _Rule_Index *, struct _Sagan_Proc_Syslog *, int * );
+uint64_t *Rule_Index_Prefilter( _Rule_Index *, const char * );
+uint64_t *Rule_Index_Wildcard( _Rule_Index *, const char * );
+
@@ -41,7 +41,6 @@
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
-#include <pcre.h>
 
 #include "version.h"
 
@@ -53,6 +52,8 @@
 #include "lockfile.h"
 #include "classifications.h"
 #include "rules.h"
+#include "rule-pool.h"
+#include "util-pcre.h"
 #include "sagan-config.h"
 #include "parsers/parsers.h"
 
@@ -90,6 +91,14 @@ int liblognorm_count;
 struct _Rule_Struct *rulestruct = NULL;
 struct _Class_Struct *classstruct = NULL;
 
+/* The rule being parsed (see Rule_Pack()) */
+
+static _Rule_Parse rule_parse;
+
+static void Rule_Pack( _Rule_Struct * );
+static void *Rule_Pack_Array( const void *, size_t, int, int );
+static char **Rule_Pack_Strings( const char *, size_t, int, int );
+
 void Load_Rules( const char *ruleset )
 {
 
@@ -98,7 +107,7 @@ void Load_Rules( const char *ruleset )
     sbool found = 0;
     sbool bad_rule = 0;
 
-    const char *error;
+    char error[256];
     int erroffset;
 
     FILE *rulesfile;
@@ -139,6 +148,8 @@ void Load_Rules( const char *ruleset )
     char rulestr[RULEBUF];
     char rulebuf[RULEBUF];
     char pcrerule[MAX_PCRE_SIZE];
+    char pcre_literal[PCRE_LITERAL_SIZE];
+    sbool pcre_literal_nocase = false;
 
     char tmp4[MAX_CHECK_FLOWS * 10];
     char tmp3[MAX_CHECK_FLOWS * 21];
@@ -244,6 +255,7 @@ void Load_Rules( const char *ruleset )
                         }
 
                     memset(&rulestruct[counters->rulecount], 0, sizeof(struct _Rule_Struct));
+                    memset(&rule_parse, 0, sizeof(_Rule_Parse));
 
                 }
 
@@ -462,7 +474,7 @@ void Load_Rules( const char *ruleset )
 
                                             f1++;
 
-                                            is_masked = Netaddr_To_Range(tok_help, (unsigned char *)&rulestruct[counters->rulecount].flow_1[flow_1_count].range);
+                                            is_masked = Netaddr_To_Range(tok_help, (unsigned char *)&rule_parse.flow_1[flow_1_count].range);
 
                                             if(strchr(tmptoken, '/'))
                                                 {
@@ -470,23 +482,23 @@ void Load_Rules( const char *ruleset )
                                                     if( !strncmp(tmptoken, "!", 1) || !strncmp("not", tmptoken, 3))
                                                         {
 
-                                                            rulestruct[counters->rulecount].flow_1_type[f1] = is_masked ? 0 : 2; /* 0 = not in group, 2 == IP not range */
+                                                            rule_parse.flow_1_type[f1] = is_masked ? 0 : 2; /* 0 = not in group, 2 == IP not range */
                                                         }
                                                     else
                                                         {
 
-                                                            rulestruct[counters->rulecount].flow_1_type[f1] = is_masked ? 1 : 3; /* 1 = in group, 3 == IP not range */
+                                                            rule_parse.flow_1_type[f1] = is_masked ? 1 : 3; /* 1 = in group, 3 == IP not range */
                                                         }
                                                 }
                                             else if( !strncmp(tmptoken, "!", 1) || !strncmp("not", tmptoken, 3))
                                                 {
 
-                                                    rulestruct[counters->rulecount].flow_1_type[f1] = 2; /* 2 = not match ip */
+                                                    rule_parse.flow_1_type[f1] = 2; /* 2 = not match ip */
                                                 }
                                             else
                                                 {
 
-                                                    rulestruct[counters->rulecount].flow_1_type[f1] = 3; /* 3 = match ip */
+                                                    rule_parse.flow_1_type[f1] = 3; /* 3 = match ip */
                                                 }
                                             flow_1_count++;
                                             if( flow_1_count > 49 )
@@ -519,7 +531,7 @@ void Load_Rules( const char *ruleset )
                                             g1++;
                                             if (Is_Numeric(nettmp))
                                                 {
-                                                    rulestruct[counters->rulecount].port_1[port_1_count].lo = atoi(nettmp);          /* If it's a number (see Var_To_Value),  then set to that */
+                                                    rule_parse.port_1[port_1_count].lo = atoi(nettmp);          /* If it's a number (see Var_To_Value),  then set to that */
                                                 }
 
                                             if (!strncmp(tmptoken,"!", 1) || !strncmp("not", tmptoken, 3))
@@ -527,16 +539,16 @@ void Load_Rules( const char *ruleset )
                                                     if(strchr(tok_help2,':'))
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_1_type[g1] = 0; /* 0 = not in group */
+                                                            rule_parse.port_1[port_1_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
+                                                            rule_parse.port_1[port_1_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
+                                                            rule_parse.port_1_type[g1] = 0; /* 0 = not in group */
 
                                                         }
                                                     else
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].lo = atoi(tok_help2);
-                                                            rulestruct[counters->rulecount].port_1_type[g1] = 2; /* This was a single port, not a range */
+                                                            rule_parse.port_1[port_1_count].lo = atoi(tok_help2);
+                                                            rule_parse.port_1_type[g1] = 2; /* This was a single port, not a range */
 
                                                         }
                                                 }
@@ -545,16 +557,16 @@ void Load_Rules( const char *ruleset )
                                                     if(strchr(tok_help2, ':'))
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_1_type[g1] = 1; /* 1 = in group */
+                                                            rule_parse.port_1[port_1_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
+                                                            rule_parse.port_1[port_1_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
+                                                            rule_parse.port_1_type[g1] = 1; /* 1 = in group */
 
                                                         }
                                                     else
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_1[port_1_count].lo = atoi(tok_help2);
-                                                            rulestruct[counters->rulecount].port_1_type[g1] = 3; /* This was a single port, not a range */
+                                                            rule_parse.port_1[port_1_count].lo = atoi(tok_help2);
+                                                            rule_parse.port_1_type[g1] = 3; /* This was a single port, not a range */
 
                                                         }
 
@@ -625,26 +637,26 @@ void Load_Rules( const char *ruleset )
                                                     Sagan_Log(S_WARN,"[%s, line %d] Value is not a valid IP '%s'", __FILE__, __LINE__, tok_help);
                                                 }
                                             f2++;
-                                            is_masked = Netaddr_To_Range(tok_help, (unsigned char *)&rulestruct[counters->rulecount].flow_2[flow_2_count].range);
+                                            is_masked = Netaddr_To_Range(tok_help, (unsigned char *)&rule_parse.flow_2[flow_2_count].range);
 
                                             if(strchr(tmptoken, '/'))
                                                 {
                                                     if( !strncmp(tmptoken, "!", 1) || !strncmp("not", tmptoken, 3))
                                                         {
-                                                            rulestruct[counters->rulecount].flow_2_type[f2] = is_masked ? 0 : 2; /* 0 = not in group, 2 == IP not range */
+                                                            rule_parse.flow_2_type[f2] = is_masked ? 0 : 2; /* 0 = not in group, 2 == IP not range */
                                                         }
                                                     else
                                                         {
-                                                            rulestruct[counters->rulecount].flow_2_type[f2] = is_masked ? 1 : 3; /* 1 = in group, 3 == IP not range */
+                                                            rule_parse.flow_2_type[f2] = is_masked ? 1 : 3; /* 1 = in group, 3 == IP not range */
                                                         }
                                                 }
                                             else if( !strncmp(tmptoken, "!", 1) || !strncmp("not", tmptoken, 3))
                                                 {
-                                                    rulestruct[counters->rulecount].flow_2_type[f2] = 2; /* 2 = not match ip */
+                                                    rule_parse.flow_2_type[f2] = 2; /* 2 = not match ip */
                                                 }
                                             else
                                                 {
-                                                    rulestruct[counters->rulecount].flow_2_type[f2] = 3; /* 3 = match ip */
+                                                    rule_parse.flow_2_type[f2] = 3; /* 3 = match ip */
                                                 }
                                             if( flow_2_count > 49 )
                                                 {
@@ -676,7 +688,7 @@ void Load_Rules( const char *ruleset )
                                             g2++;
                                             if (Is_Numeric(nettmp))
                                                 {
-                                                    rulestruct[counters->rulecount].port_2[port_2_count].lo = atoi(nettmp);          /* If it's a number (see Var_To_Value),  then set to that */
+                                                    rule_parse.port_2[port_2_count].lo = atoi(nettmp);          /* If it's a number (see Var_To_Value),  then set to that */
                                                 }
 
                                             if (!strncmp(tmptoken,"!", 1) || !strncmp("not", tmptoken, 3))
@@ -684,16 +696,16 @@ void Load_Rules( const char *ruleset )
                                                     if(strchr(tok_help2,':'))
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_2_type[g2] = 0; /* 0 = not in group */
+                                                            rule_parse.port_2[port_2_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
+                                                            rule_parse.port_2[port_2_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
+                                                            rule_parse.port_2_type[g2] = 0; /* 0 = not in group */
 
                                                         }
                                                     else
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].lo = atoi(tok_help2);
-                                                            rulestruct[counters->rulecount].port_2_type[g2] = 2; /* This was a single port, not a range */
+                                                            rule_parse.port_2[port_2_count].lo = atoi(tok_help2);
+                                                            rule_parse.port_2_type[g2] = 2; /* This was a single port, not a range */
 
                                                         }
                                                 }
@@ -702,16 +714,16 @@ void Load_Rules( const char *ruleset )
                                                     if(strchr(tok_help2, ':'))
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
-                                                            rulestruct[counters->rulecount].port_2_type[g2] = 1; /* 1 = in group */
+                                                            rule_parse.port_2[port_2_count].lo = atoi(strtok_r(tok_help2, ":", &saveptrportrange));
+                                                            rule_parse.port_2[port_2_count].hi = atoi(strtok_r(NULL, ":", &saveptrportrange));
+                                                            rule_parse.port_2_type[g2] = 1; /* 1 = in group */
 
                                                         }
                                                     else
                                                         {
 
-                                                            rulestruct[counters->rulecount].port_2[port_2_count].lo = atoi(tok_help2);
-                                                            rulestruct[counters->rulecount].port_2_type[g2] = 3; /* This was a single port, not a range */
+                                                            rule_parse.port_2[port_2_count].lo = atoi(tok_help2);
+                                                            rule_parse.port_2_type[g2] = 3; /* This was a single port, not a range */
 
                                                         }
 
@@ -997,13 +1009,13 @@ void Load_Rules( const char *ruleset )
 
                                     rulestruct[counters->rulecount].xbit_flag = 1; 				/* We have xbit in the rule! */
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 1;		/* set */
+                                    rule_parse.xbit_type[xbit_count]  = 1;		/* set */
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
-                                    rulestruct[counters->rulecount].xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
+                                    rule_parse.xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
 
-                                    if ( rulestruct[counters->rulecount].xbit_timeout[xbit_count] == 0 )
+                                    if ( rule_parse.xbit_timeout[xbit_count] == 0 )
                                         {
                                             bad_rule = true;
                                             Sagan_Log(S_WARN, "[%s, line %d] Expected xbit valid expire time for \"set\" at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset_fullname);
@@ -1031,11 +1043,11 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Spaces(tmptoken);
 
-                                    rulestruct[counters->rulecount].xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
+                                    rule_parse.xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
 
                                     rulestruct[counters->rulecount].xbit_flag = 1;               			/* We have xbit in the rule! */
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 2;                	/* unset */
+                                    rule_parse.xbit_type[xbit_count]  = 2;                	/* unset */
 
                                     tmptoken = strtok_r(NULL, ",", &saveptrrule2);
 
@@ -1048,7 +1060,7 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Spaces(tmptoken);
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
                                     xbit_count++;
 
@@ -1070,10 +1082,10 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Spaces(tmptoken);
 
-                                    rulestruct[counters->rulecount].xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
+                                    rule_parse.xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
 
                                     rulestruct[counters->rulecount].xbit_flag = 1;               			/* We have xbit in the rule! */
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 3;               	/* isset */
+                                    rule_parse.xbit_type[xbit_count]  = 3;               	/* isset */
 
                                     tmptoken = strtok_r(NULL, ",", &saveptrrule2);
 
@@ -1086,7 +1098,7 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Spaces(tmptoken);
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
                                     /* If we have multiple xbit conditions (bit1&bit2),
                                      * we alter the xbit_conditon_count to reflect that.
@@ -1094,8 +1106,8 @@ void Load_Rules( const char *ruleset )
                                      * xbits matched or not!
                                      */
 
-                                    if ( Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "&") &&
-                                            Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "|") )
+                                    if ( Sagan_strstr(rule_parse.xbit_name[xbit_count], "&") &&
+                                            Sagan_strstr(rule_parse.xbit_name[xbit_count], "|") )
                                         {
 
                                             bad_rule = true;
@@ -1103,10 +1115,10 @@ void Load_Rules( const char *ruleset )
                                             continue;
                                         }
 
-                                    if (Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "&"))
+                                    if (Sagan_strstr(rule_parse.xbit_name[xbit_count], "&"))
                                         {
 
-                                            rulestruct[counters->rulecount].xbit_condition_count = Character_Count(rulestruct[counters->rulecount].xbit_name[xbit_count], "&") + 1;
+                                            rulestruct[counters->rulecount].xbit_condition_count = Character_Count(rule_parse.xbit_name[xbit_count], "&") + 1;
 
                                         }
                                     else
@@ -1135,10 +1147,10 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Spaces(tmptoken);
 
-                                    rulestruct[counters->rulecount].xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
+                                    rule_parse.xbit_direction[xbit_count] = Xbit_Type(tmptoken, linecount, ruleset_fullname);
 
                                     rulestruct[counters->rulecount].xbit_flag = 1;                               	/* We have xbit in the rule! */
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 4;               	/* isnotset */
+                                    rule_parse.xbit_type[xbit_count]  = 4;               	/* isnotset */
 
                                     tmptoken = strtok_r(NULL, ",", &saveptrrule2);
 
@@ -1151,7 +1163,7 @@ void Load_Rules( const char *ruleset )
 
                                     Remove_Return(tmptoken);
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
                                     /* If we have multiple xbit conditions (bit1&bit2),
                                      * we alter the xbit_conditon_count to reflect that.
@@ -1160,8 +1172,8 @@ void Load_Rules( const char *ruleset )
                                      */
 
 
-                                    if ( Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "&") &&
-                                            Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "|") )
+                                    if ( Sagan_strstr(rule_parse.xbit_name[xbit_count], "&") &&
+                                            Sagan_strstr(rule_parse.xbit_name[xbit_count], "|") )
                                         {
 
                                             bad_rule = true;
@@ -1170,10 +1182,10 @@ void Load_Rules( const char *ruleset )
                                         }
 
 
-                                    if (Sagan_strstr(rulestruct[counters->rulecount].xbit_name[xbit_count], "&"))
+                                    if (Sagan_strstr(rule_parse.xbit_name[xbit_count], "&"))
                                         {
 
-                                            rulestruct[counters->rulecount].xbit_condition_count = Character_Count(rulestruct[counters->rulecount].xbit_name[xbit_count], "&") + 1;
+                                            rulestruct[counters->rulecount].xbit_condition_count = Character_Count(rule_parse.xbit_name[xbit_count], "&") + 1;
 
                                         }
                                     else
@@ -1205,13 +1217,13 @@ void Load_Rules( const char *ruleset )
 
                                     rulestruct[counters->rulecount].xbit_flag = 1; 				/* We have xbit in the rule! */
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 5;		/* set_srcport */
+                                    rule_parse.xbit_type[xbit_count]  = 5;		/* set_srcport */
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
-                                    rulestruct[counters->rulecount].xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
+                                    rule_parse.xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
 
-                                    if ( rulestruct[counters->rulecount].xbit_timeout[xbit_count] == 0 )
+                                    if ( rule_parse.xbit_timeout[xbit_count] == 0 )
                                         {
                                             bad_rule = true;
                                             Sagan_Log(S_WARN, "[%s, line %d] Expected xbit valid expire time for \"set\" at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset_fullname);
@@ -1241,13 +1253,13 @@ void Load_Rules( const char *ruleset )
 
                                     rulestruct[counters->rulecount].xbit_flag = 1; 				/* We have xbit in the rule! */
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 6;		/* set_dstport */
+                                    rule_parse.xbit_type[xbit_count]  = 6;		/* set_dstport */
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
-                                    rulestruct[counters->rulecount].xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
+                                    rule_parse.xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
 
-                                    if ( rulestruct[counters->rulecount].xbit_timeout[xbit_count] == 0 )
+                                    if ( rule_parse.xbit_timeout[xbit_count] == 0 )
                                         {
                                             bad_rule = true;
                                             Sagan_Log(S_WARN, "[%s, line %d] Expected xbit valid expire time for \"set\" at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset);
@@ -1277,13 +1289,13 @@ void Load_Rules( const char *ruleset )
 
                                     rulestruct[counters->rulecount].xbit_flag = 1; 				/* We have xbit in the rule! */
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 7;		/* set_ports */
+                                    rule_parse.xbit_type[xbit_count]  = 7;		/* set_ports */
 
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
-                                    rulestruct[counters->rulecount].xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
+                                    rule_parse.xbit_timeout[xbit_count] = atoi(strtok_r(NULL, ",", &saveptrrule2));
 
-                                    if ( rulestruct[counters->rulecount].xbit_timeout[xbit_count] == 0 )
+                                    if ( rule_parse.xbit_timeout[xbit_count] == 0 )
                                         {
                                             bad_rule = true;
                                             Sagan_Log(S_WARN, "[%s, line %d] Expected xbit valid expire time for \"set\" at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset);
@@ -1323,19 +1335,19 @@ void Load_Rules( const char *ruleset )
                                     if ( !strcmp(tmptoken, "by_src") )
                                         {
 
-                                            rulestruct[counters->rulecount].xbit_direction[xbit_count] = 2;
+                                            rule_parse.xbit_direction[xbit_count] = 2;
 
                                         }
                                     else
                                         {
 
-                                            rulestruct[counters->rulecount].xbit_direction[xbit_count] = 3;
+                                            rule_parse.xbit_direction[xbit_count] = 3;
 
                                         }
 
                                     rulestruct[counters->rulecount].xbit_flag = 1;
                                     rulestruct[counters->rulecount].xbit_set_count++;
-                                    rulestruct[counters->rulecount].xbit_type[xbit_count]  = 8;         /* count */
+                                    rule_parse.xbit_type[xbit_count]  = 8;         /* count */
 
                                     tmptoken = strtok_r(NULL, ",", &saveptrrule2);
 
@@ -1347,7 +1359,7 @@ void Load_Rules( const char *ruleset )
                                         }
 
                                     Remove_Spaces(tmptoken);
-                                    strlcpy(rulestruct[counters->rulecount].xbit_name[xbit_count], tmptoken, sizeof(rulestruct[counters->rulecount].xbit_name[xbit_count]));
+                                    strlcpy(rule_parse.xbit_name[xbit_count], tmptoken, sizeof(rule_parse.xbit_name[xbit_count]));
 
                                     tmptoken = strtok_r(NULL, ",", &saveptrrule2);
 
@@ -1373,19 +1385,19 @@ void Load_Rules( const char *ruleset )
 
                                     if ( tmp1[0] == '>' )
                                         {
-                                            rulestruct[counters->rulecount].xbit_count_gt_lt[xbit_count] = 0;
+                                            rule_parse.xbit_count_gt_lt[xbit_count] = 0;
                                             tmptoken = strtok_r(tmp1, ">", &saveptrrule3);
                                         }
 
                                     else if ( tmp1[0] == '<' )
                                         {
-                                            rulestruct[counters->rulecount].xbit_count_gt_lt[xbit_count] = 1;
+                                            rule_parse.xbit_count_gt_lt[xbit_count] = 1;
                                             tmptoken = strtok_r(tmp1, "<", &saveptrrule3);
                                         }
 
                                     else if ( tmp1[0] == '=' )
                                         {
-                                            rulestruct[counters->rulecount].xbit_count_gt_lt[xbit_count] = 2;
+                                            rule_parse.xbit_count_gt_lt[xbit_count] = 2;
                                             tmptoken = strtok_r(tmp1, "=", &saveptrrule3);
                                         }
 
@@ -1397,7 +1409,7 @@ void Load_Rules( const char *ruleset )
                                         }
 
                                     Remove_Spaces(tmptoken);
-                                    rulestruct[counters->rulecount].xbit_count_counter[xbit_count] = atoi(tmptoken);
+                                    rule_parse.xbit_count_counter[xbit_count] = atoi(tmptoken);
                                     rulestruct[counters->rulecount].xbit_count_flag = true;
 
                                     xbit_count++;
@@ -1570,7 +1582,7 @@ void Load_Rules( const char *ruleset )
 
                             Content_Pipe(tmp2, linecount, ruleset_fullname, rule_tmp, sizeof(rule_tmp));
 
-                            strlcpy(rulestruct[counters->rulecount].meta_content_help[meta_content_count], rule_tmp, sizeof(rulestruct[counters->rulecount].meta_content_help[meta_content_count]));
+                            strlcpy(rule_parse.meta_content_help[meta_content_count], rule_tmp, sizeof(rule_parse.meta_content_help[meta_content_count]));
 
                             tmptoken = strtok_r(NULL, ";", &saveptrrule2);           /* Grab Search data */
 
@@ -1592,15 +1604,15 @@ void Load_Rules( const char *ruleset )
                             while (ptmp != NULL)
                                 {
 
-                                    Replace_Sagan(rulestruct[counters->rulecount].meta_content_help[meta_content_count], ptmp, tmp_help, sizeof(tmp_help));
-                                    strlcpy(rulestruct[counters->rulecount].meta_content_containers[meta_content_count].meta_content_converted[meta_content_converted_count], tmp_help, sizeof(rulestruct[counters->rulecount].meta_content_containers[meta_content_count].meta_content_converted[meta_content_converted_count]));
+                                    Replace_Sagan(rule_parse.meta_content_help[meta_content_count], ptmp, tmp_help, sizeof(tmp_help));
+                                    strlcpy(rule_parse.meta_content_containers[meta_content_count].meta_content_converted[meta_content_converted_count], tmp_help, sizeof(rule_parse.meta_content_containers[meta_content_count].meta_content_converted[meta_content_converted_count]));
 
                                     meta_content_converted_count++;
 
                                     ptmp = strtok_r(NULL, ",", &tok);
                                 }
 
-                            rulestruct[counters->rulecount].meta_content_containers[meta_content_count].meta_counter = meta_content_converted_count;
+                            rule_parse.meta_content_containers[meta_content_count].meta_counter = meta_content_converted_count;
 
                             rulestruct[counters->rulecount].meta_content_flag = true;
 
@@ -1617,9 +1629,6 @@ void Load_Rules( const char *ruleset )
                         {
                             strtok_r(NULL, ":", &saveptrrule2);
                             rulestruct[counters->rulecount].meta_content_case[meta_content_count-1] = 1;
-                            To_LowerC(rulestruct[counters->rulecount].meta_content[meta_content_count-1]);
-                            strlcpy(tolower_tmp, rulestruct[counters->rulecount].meta_content[meta_content_count-1], sizeof(tolower_tmp));
-                            strlcpy(rulestruct[counters->rulecount].meta_content[meta_content_count-1], tolower_tmp, sizeof(rulestruct[counters->rulecount].meta_content[meta_content_count-1]));
                         }
 
 
@@ -1687,6 +1696,13 @@ void Load_Rules( const char *ruleset )
                             Var_To_Value(arg, tmp1, sizeof(tmp1));
                             Remove_Spaces(tmp1);
 
+                            if ( strlen(tmp1) >= sizeof(rulestruct[counters->rulecount].s_program) )
+                                {
+                                    bad_rule = true;
+                                    Sagan_Log(S_WARN, "[%s, line %d] The \"program\" list is too long at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset_fullname);
+                                    continue;
+                                }
+
                             strlcpy(rulestruct[counters->rulecount].s_program, tmp1, sizeof(rulestruct[counters->rulecount].s_program));
 
                         }
@@ -1703,7 +1719,7 @@ void Load_Rules( const char *ruleset )
                                 }
 
                             Remove_Spaces(arg);
-                            strlcpy(rulestruct[counters->rulecount].s_reference[ref_count], arg, sizeof(rulestruct[counters->rulecount].s_reference[ref_count]));
+                            strlcpy(rule_parse.s_reference[ref_count], arg, sizeof(rule_parse.s_reference[ref_count]));
                             rulestruct[counters->rulecount].ref_count=ref_count;
                             ref_count++;
                         }
@@ -1887,7 +1903,7 @@ void Load_Rules( const char *ruleset )
                             Content_Pipe(tmp2, linecount, ruleset_fullname, rule_tmp, sizeof(rule_tmp));
                             strlcpy(final_content, rule_tmp, sizeof(final_content));
 
-                            strlcpy(rulestruct[counters->rulecount].s_content[content_count], final_content, sizeof(rulestruct[counters->rulecount].s_content[content_count]));
+                            strlcpy(rule_parse.s_content[content_count], final_content, sizeof(rule_parse.s_content[content_count]));
                             final_content[0] = '\0';
                             content_count++;
                             rulestruct[counters->rulecount].content_count=content_count;
@@ -1899,12 +1915,35 @@ void Load_Rules( const char *ruleset )
                         {
                             strtok_r(NULL, ":", &saveptrrule2);
                             rulestruct[counters->rulecount].s_nocase[content_count - 1] = 1;
-                            To_LowerC(rulestruct[counters->rulecount].s_content[content_count - 1]);
-                            strlcpy(tolower_tmp, rulestruct[counters->rulecount].s_content[content_count - 1], sizeof(tolower_tmp));
-                            strlcpy(rulestruct[counters->rulecount].s_content[content_count-1], tolower_tmp, sizeof(rulestruct[counters->rulecount].s_content[content_count-1]));
+                            To_LowerC(rule_parse.s_content[content_count - 1]);
+                            strlcpy(tolower_tmp, rule_parse.s_content[content_count - 1], sizeof(tolower_tmp));
+                            strlcpy(rule_parse.s_content[content_count-1], tolower_tmp, sizeof(rule_parse.s_content[content_count-1]));
 
                         }
 
+                    /* Single option.  Pins the content the rule is prefiltered on */
+
+                    if (!strcmp(rulesplit, "fast_pattern"))
+                        {
+                            strtok_r(NULL, ":", &saveptrrule2);
+
+                            if ( content_count == 0 )
+                                {
+                                    bad_rule = true;
+                                    Sagan_Log(S_WARN, "[%s, line %d] \"fast_pattern\" must follow a \"content\" at line %d in %s, skipping rule", __FILE__, __LINE__, linecount, ruleset_fullname);
+                                    continue;
+                                }
+
+                            if ( rulestruct[counters->rulecount].content_not[content_count - 1] == true )
+                                {
+                                    Sagan_Log(S_WARN, "[%s, line %d] \"fast_pattern\" can't be used on a negated \"content\" at line %d in %s, ignoring", __FILE__, __LINE__, linecount, ruleset_fullname);
+                                }
+                            else
+                                {
+                                    rulestruct[counters->rulecount].s_fast_pattern[content_count - 1] = true;
+                                }
+                        }
+
                     if (!strcmp(rulesplit, "offset"))
                         {
                             arg = strtok_r(NULL, ":", &saveptrrule2);
@@ -2042,6 +2081,7 @@ void Load_Rules( const char *ruleset )
                                 }
 
                             pcreflag=0;
+                            pcreoptions=0;
                             memset(pcrerule, 0, sizeof(pcrerule));
 
                             for ( i = 1; i < strlen(tmp2); i++)
@@ -2067,25 +2107,25 @@ void Load_Rules( const char *ruleset )
                                                 {
 
                                                 case 'i':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_CASELESS;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_CASELESS;
                                                     break;
                                                 case 's':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_DOTALL;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_DOTALL;
                                                     break;
                                                 case 'm':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_MULTILINE;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_MULTILINE;
                                                     break;
                                                 case 'x':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_EXTENDED;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_EXTENDED;
                                                     break;
                                                 case 'A':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_ANCHORED;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_ANCHORED;
                                                     break;
                                                 case 'E':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_DOLLAR_ENDONLY;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_DOLLAR_ENDONLY;
                                                     break;
                                                 case 'G':
-                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_UNGREEDY;
+                                                    if ( pcreflag == 1 ) pcreoptions |= PCRE_OPT_UNGREEDY;
                                                     break;
 
 
@@ -2121,43 +2161,29 @@ void Load_Rules( const char *ruleset )
                                 }
 
 
-                            /* We store the compiled/study results.  This saves us some CPU time during searching - Champ Clark III - 02/01/2011 */
+                            /* We store the compiled (and JIT compiled) results.  This saves us some CPU time during searching - Champ Clark III - 02/01/2011 */
 
-                            rulestruct[counters->rulecount].re_pcre[pcre_count] =  pcre_compile( pcrerule, pcreoptions, &error, &erroffset, NULL );
-
-#ifdef PCRE_HAVE_JIT
-
-                            if ( config->pcre_jit == 1 )
+                            if ( PCRE_Compile( counters->rulecount, pcre_count, pcrerule, pcreoptions, error, sizeof(error), &erroffset ) == false )
                                 {
-                                    pcreoptions |= PCRE_STUDY_JIT_COMPILE;
+                                    bad_rule = true;
+                                    Remove_Lock_File();
+                                    Sagan_Log(S_WARN, "[%s, line %d] PCRE failure at %d: %s, skipping rule", __FILE__, __LINE__, erroffset, error);
+                                    continue;
                                 }
-#endif
 
-                            rulestruct[counters->rulecount].pcre_extra[pcre_count] = pcre_study( rulestruct[counters->rulecount].re_pcre[pcre_count], pcreoptions, &error);
-
-#ifdef PCRE_HAVE_JIT
-
-                            if ( config->pcre_jit == 1 )
+                            if ( config->pcre_jit == true && rulestruct[counters->rulecount].pcre_jit[pcre_count] == false )
                                 {
-                                    int jit = 0;
-                                    rc = 0;
-
-                                    rc = pcre_fullinfo(rulestruct[counters->rulecount].re_pcre[pcre_count], rulestruct[counters->rulecount].pcre_extra[pcre_count], PCRE_INFO_JIT, &jit);
-
-                                    if (rc != 0 || jit != 1)
-                                        {
-                                            Sagan_Log(S_WARN, "[%s, line %d] PCRE JIT does not support regexp in %s at line %d (pcre: \"%s\"). Continuing without PCRE JIT enabled for this rule.", __FILE__, __LINE__, ruleset_fullname, linecount, pcrerule);
-                                        }
+                                    Sagan_Log(S_WARN, "[%s, line %d] PCRE JIT does not support regexp in %s at line %d (pcre: \"%s\"). Continuing without PCRE JIT enabled for this rule.", __FILE__, __LINE__, ruleset_fullname, linecount, pcrerule);
                                 }
 
-#endif
+                            /* Every pcre has to match,  so the longest literal from any
+                             * of them can be used by the prefilter */
 
-                            if (  rulestruct[counters->rulecount].re_pcre[pcre_count]  == NULL )
+                            if ( PCRE_Literal( pcrerule, pcreoptions, pcre_literal, sizeof(pcre_literal), &pcre_literal_nocase ) == true &&
+                                    strlen(pcre_literal) > strlen(rulestruct[counters->rulecount].pcre_literal) )
                                 {
-                                    bad_rule = true;
-                                    Remove_Lock_File();
-                                    Sagan_Log(S_WARN, "[%s, line %d] PCRE failure at %d: %s, skipping rule", __FILE__, __LINE__, erroffset, error);
-                                    continue;
+                                    strlcpy(rulestruct[counters->rulecount].pcre_literal, pcre_literal, sizeof(rulestruct[counters->rulecount].pcre_literal));
+                                    rulestruct[counters->rulecount].pcre_literal_nocase = pcre_literal_nocase;
                                 }
 
                             pcre_count++;
@@ -2921,6 +2947,18 @@ void Load_Rules( const char *ruleset )
                     continue;
                 }
 
+            Rule_Pack(&rulestruct[counters->rulecount]);
+
+            if ( config->pcre_perf_map == true )
+                {
+
+                    for (i=0; i<rulestruct[counters->rulecount].pcre_count; i++)
+                        {
+                            PCRE_Perf_Map(counters->rulecount, i);
+                        }
+
+                }
+
             /* Some new stuff (normalization) stuff needs to be added */
 
             if ( debug->debugload )
@@ -2949,12 +2987,12 @@ void Load_Rules( const char *ruleset )
 
                     for (i=0; i<content_count; i++)
                         {
-                            Sagan_Log(S_DEBUG, "= [%d] content: \"%s\"", i, rulestruct[counters->rulecount].s_content[i]);
+                            Sagan_Log(S_DEBUG, "= [%d] content: \"%s\"", i, rule_parse.s_content[i]);
                         }
 
                     for (i=0; i<ref_count; i++)
                         {
-                            Sagan_Log(S_DEBUG, "= [%d] reference: \"%s\"", i,  rulestruct[counters->rulecount].s_reference[i]);
+                            Sagan_Log(S_DEBUG, "= [%d] reference: \"%s\"", i,  rule_parse.s_reference[i]);
                         }
                 }
 
@@ -2964,3 +3002,120 @@ void Load_Rules( const char *ruleset )
 
     fclose(rulesfile);
 }
+
+/****************************************************************************
+ * Rule_Pack - Moves the parts of a rule that vary in length from
+ * rule_parse into the rule pool,  sized to what the rule uses.  Counts
+ * are what the readers (check-flow.c,  references.c,  etc) index up to
+ ****************************************************************************/
+
+static void Rule_Pack( _Rule_Struct *rule )
+{
+
+    int i;
+
+    rule->s_content = Rule_Pack_Strings(rule_parse.s_content[0], sizeof(rule_parse.s_content[0]), rule->content_count, MAX_CONTENT);
+    rule->s_reference = Rule_Pack_Strings(rule_parse.s_reference[0], sizeof(rule_parse.s_reference[0]), rule->ref_count + 1, MAX_REFERENCE);
+
+    if ( rule->meta_content_count != 0 )
+        {
+
+            rule->meta_content_containers = Rule_Pool_Alloc(rule->meta_content_count * sizeof(struct meta_content_conversion));
+
+            for ( i = 0; i < rule->meta_content_count && i < MAX_META_CONTENT; i++ )
+                {
+                    rule->meta_content_containers[i].meta_counter = rule_parse.meta_content_containers[i].meta_counter;
+                    rule->meta_content_containers[i].meta_content_converted = Rule_Pack_Strings(rule_parse.meta_content_containers[i].meta_content_converted[0],
+                            sizeof(rule_parse.meta_content_containers[i].meta_content_converted[0]),
+                            rule_parse.meta_content_containers[i].meta_counter, MAX_META_CONTENT);
+                }
+        }
+
+    /* flow_1_type/flow_2_type are numbered from 1,  and the flow loops go
+     * one past the counter */
+
+    if ( rule->flow_1_var != 0 )
+        {
+            rule->flow_1 = Rule_Pack_Array(rule_parse.flow_1, sizeof(struct arr_flow_1), rule->flow_1_counter + 1, MAX_CHECK_FLOWS);
+            rule->flow_1_type = Rule_Pack_Array(rule_parse.flow_1_type, sizeof(int), rule->flow_1_counter + 2, MAX_CHECK_FLOWS);
+        }
+
+    if ( rule->flow_2_var != 0 )
+        {
+            rule->flow_2 = Rule_Pack_Array(rule_parse.flow_2, sizeof(struct arr_flow_2), rule->flow_2_counter + 1, MAX_CHECK_FLOWS);
+            rule->flow_2_type = Rule_Pack_Array(rule_parse.flow_2_type, sizeof(int), rule->flow_2_counter + 2, MAX_CHECK_FLOWS);
+        }
+
+    if ( rule->port_1_var != 0 )
+        {
+            rule->port_1 = Rule_Pack_Array(rule_parse.port_1, sizeof(struct arr_port_1), rule->port_1_counter + 1, MAX_CHECK_FLOWS);
+            rule->port_1_type = Rule_Pack_Array(rule_parse.port_1_type, sizeof(int), rule->port_1_counter + 1, MAX_CHECK_FLOWS);
+        }
+
+    if ( rule->port_2_var != 0 )
+        {
+            rule->port_2 = Rule_Pack_Array(rule_parse.port_2, sizeof(struct arr_port_2), rule->port_2_counter + 1, MAX_CHECK_FLOWS);
+            rule->port_2_type = Rule_Pack_Array(rule_parse.port_2_type, sizeof(int), rule->port_2_counter + 1, MAX_CHECK_FLOWS);
+        }
+
+    if ( rule->xbit_count != 0 )
+        {
+            rule->xbit_type = Rule_Pack_Array(rule_parse.xbit_type, sizeof(unsigned char), rule->xbit_count, MAX_XBITS);
+            rule->xbit_direction = Rule_Pack_Array(rule_parse.xbit_direction, sizeof(unsigned char), rule->xbit_count, MAX_XBITS);
+            rule->xbit_timeout = Rule_Pack_Array(rule_parse.xbit_timeout, sizeof(int), rule->xbit_count, MAX_XBITS);
+            rule->xbit_name = Rule_Pack_Strings(rule_parse.xbit_name[0], sizeof(rule_parse.xbit_name[0]), rule->xbit_count, MAX_XBITS);
+            rule->xbit_count_gt_lt = Rule_Pack_Array(rule_parse.xbit_count_gt_lt, sizeof(unsigned char), rule->xbit_count, MAX_XBITS);
+            rule->xbit_count_counter = Rule_Pack_Array(rule_parse.xbit_count_counter, sizeof(int), rule->xbit_count, MAX_XBITS);
+        }
+
+}
+
+/****************************************************************************
+ * Rule_Pack_Array - Copies 'count' entries of 'size' bytes into the pool.
+ * Past 'max',  entries are zero
+ ****************************************************************************/
+
+static void *Rule_Pack_Array( const void *array, size_t size, int count, int max )
+{
+
+    void *copy = NULL;
+
+    if ( count <= 0 )
+        {
+            return(NULL);
+        }
+
+    copy = Rule_Pool_Alloc(count * size);
+    memcpy(copy, array, ( count < max ? count : max ) * size);
+
+    return(copy);
+
+}
+
+/****************************************************************************
+ * Rule_Pack_Strings - Copies the first 'count' strings of a
+ * char [max][width] array into the pool.  Returns an array of pointers
+ * to them.  Past 'max',  they are empty
+ ****************************************************************************/
+
+static char **Rule_Pack_Strings( const char *strings, size_t width, int count, int max )
+{
+
+    char **copy = NULL;
+    int i;
+
+    if ( count <= 0 )
+        {
+            return(NULL);
+        }
+
+    copy = Rule_Pool_Alloc(count * sizeof(char *));
+
+    for ( i = 0; i < count; i++ )
+        {
+            copy[i] = Rule_Pool_Strdup( i < max ? strings + i * width : "" );
+        }
+
+    return(copy);
+
+}
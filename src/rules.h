@@ -68,27 +68,73 @@ struct arr_port_2
 
 typedef struct meta_content_conversion meta_content_conversion;
 struct meta_content_conversion
+{
+    char **meta_content_converted;
+    int  meta_counter;
+};
+
+/* A rule's variable length parts,  at their maximum size,  while the rule
+ * is parsed.  Rule_Pack() (rules.c) then copies what was used into the
+ * rule pool (see rule-pool.c) */
+
+typedef struct _Rule_Parse_Meta_Content _Rule_Parse_Meta_Content;
+struct _Rule_Parse_Meta_Content
 {
     char meta_content_converted[MAX_META_CONTENT][256];
     int  meta_counter;
 };
 
+typedef struct _Rule_Parse _Rule_Parse;
+struct _Rule_Parse
+{
+    char s_content[MAX_CONTENT][256];
+    char s_reference[MAX_REFERENCE][256];
+
+    char meta_content_help[MAX_META_CONTENT][CONFBUF];
+    struct _Rule_Parse_Meta_Content meta_content_containers[MAX_META_CONTENT];
+
+    struct arr_flow_1 flow_1[MAX_CHECK_FLOWS];
+    struct arr_flow_2 flow_2[MAX_CHECK_FLOWS];
+    struct arr_port_1 port_1[MAX_CHECK_FLOWS];
+    struct arr_port_2 port_2[MAX_CHECK_FLOWS];
+
+    int flow_1_type[MAX_CHECK_FLOWS];
+    int flow_2_type[MAX_CHECK_FLOWS];
+    int port_1_type[MAX_CHECK_FLOWS];
+    int port_2_type[MAX_CHECK_FLOWS];
+
+    unsigned char xbit_type[MAX_XBITS];
+    unsigned char xbit_direction[MAX_XBITS];
+    int xbit_timeout[MAX_XBITS];
+    char xbit_name[MAX_XBITS][64];
+    unsigned char xbit_count_gt_lt[MAX_XBITS];
+    int xbit_count_counter[MAX_XBITS];
+};
+
 typedef struct _Rule_Struct _Rule_Struct;
 struct _Rule_Struct
 {
     unsigned s_size_rule;
     char s_msg[256];
 
+#ifdef HAVE_LIBPCRE2
+    pcre2_code *re_pcre[MAX_PCRE];
+#else
     pcre *re_pcre[MAX_PCRE];
     pcre_extra *pcre_extra[MAX_PCRE];
+#endif
+    sbool pcre_jit[MAX_PCRE];			/* JIT compiled (see util-pcre.c) */
 
-    char s_content[MAX_CONTENT][256];
-    char s_reference[MAX_REFERENCE][256];
+    /* content,  meta_content,  references,  flows and xbits point into the
+     * rule pool and are only as long as the rule needs */
+
+    char **s_content;				/* content_count */
+    char **s_reference;				/* ref_count + 1 */
     char s_classtype[32];
     char s_sid[32];
     char s_rev[5];
     int  s_pri;
-    char s_program[256];
+    char s_program[1024];
     char s_facility[50];
     char s_syspri[25];
     char s_level[25];
@@ -101,13 +147,13 @@ struct _Rule_Struct
     char  dynamic_ruleset[MAXPATH];
 
     /* Check Flow */
-    struct arr_flow_1 flow_1[MAX_CHECK_FLOWS];
-    struct arr_flow_2 flow_2[MAX_CHECK_FLOWS];
+    struct arr_flow_1 *flow_1;			/* flow_1_counter + 1 */
+    struct arr_flow_2 *flow_2;
 
-    struct arr_port_1 port_1[MAX_CHECK_FLOWS];
-    struct arr_port_2 port_2[MAX_CHECK_FLOWS];
+    struct arr_port_1 *port_1;			/* port_1_counter + 1 */
+    struct arr_port_2 *port_2;
 
-    struct meta_content_conversion meta_content_containers[MAX_META_CONTENT];
+    struct meta_content_conversion *meta_content_containers;	/* meta_content_count */
 
     int direction;
 
@@ -118,17 +164,18 @@ struct _Rule_Struct
 
     sbool has_flow;
 
-    int flow_1_type[MAX_CHECK_FLOWS];
-    int flow_2_type[MAX_CHECK_FLOWS];
+    int *flow_1_type;				/* Numbered from 1.  flow_1_counter + 2 */
+    int *flow_2_type;
     int flow_1_counter;
     int flow_2_counter;
 
-    int port_1_type[MAX_CHECK_FLOWS];
-    int port_2_type[MAX_CHECK_FLOWS];
+    int *port_1_type;				/* Numbered from 1.  port_1_counter + 1 */
+    int *port_2_type;
     int port_1_counter;
     int port_2_counter;
 
     sbool s_nocase[MAX_CONTENT];
+    sbool s_fast_pattern[MAX_CONTENT];		/* Prefilter on this content (see rules-index.c) */
     int s_offset[MAX_CONTENT];
     int s_depth[MAX_CONTENT];
     int s_distance[MAX_CONTENT];
@@ -141,6 +188,8 @@ struct _Rule_Struct
     int meta_within[MAX_META_CONTENT];
 
     unsigned char pcre_count;
+    char pcre_literal[PCRE_LITERAL_SIZE];	/* In every match of a pcre.  Prefilters pcre only rules */
+    sbool pcre_literal_nocase;
     unsigned char content_count;
     unsigned char meta_content_count;
     unsigned char meta_content_converted_count;
@@ -154,15 +203,17 @@ struct _Rule_Struct
     sbool xbit_noalert;                         /* Do we want to suppress "alerts" from xbits in ALL output plugins? */
     sbool xbit_nounified2;                      /* Do we want to suppress "unified2" from xbits in unified2 output */
 
-    unsigned char xbit_type[MAX_XBITS];         /* 1 == set, 2 == unset, 3 == isset, 4 == isnotset, 5 == set_srcport,
+    /* Each of these is xbit_count long */
+
+    unsigned char *xbit_type;                   /* 1 == set, 2 == unset, 3 == isset, 4 == isnotset, 5 == set_srcport,
 						   6 == set_dstport, 7 == set_ports, 8 == count */
 
-    unsigned char xbit_direction[MAX_XBITS];    /* 0 == none, 1 == both, 2 == by_src, 3 == by_dst */
-    int xbit_timeout[MAX_XBITS];                /* How long a xbit is to stay alive (seconds) */
-    char xbit_name[MAX_XBITS][64];              /* Name of the xbit */
+    unsigned char *xbit_direction;              /* 0 == none, 1 == both, 2 == by_src, 3 == by_dst */
+    int *xbit_timeout;                          /* How long a xbit is to stay alive (seconds) */
+    char **xbit_name;                           /* Name of the xbit */
 
-    unsigned char xbit_count_gt_lt[MAX_XBITS];  	/* 0 == Greater, 1 == Less than, 2 == Equals. */
-    int xbit_count_counter[MAX_XBITS];        /* The amount the user is looking for */
+    unsigned char *xbit_count_gt_lt;            	/* 0 == Greater, 1 == Less than, 2 == Equals. */
+    int *xbit_count_counter;                  /* The amount the user is looking for */
     sbool xbit_count_flag;
 
     int ref_count;
@@ -205,9 +256,6 @@ struct _Rule_Struct
     sbool meta_content_case[MAX_META_CONTENT];
     sbool meta_content_not[MAX_META_CONTENT];
 
-    char meta_content[MAX_META_CONTENT][CONFBUF];
-    char meta_content_help[MAX_META_CONTENT][CONFBUF];
-
     sbool alert_time_flag;
     unsigned char alert_days;
     sbool aetas_next_day;
@@ -87,15 +87,39 @@ struct _SaganConfig
 
     int          max_processor_threads;
 
+    int          sagan_queue_depth;                     /* Work queue between reader(s) and workers */
+    int          sagan_queue_batch;                     /* Max events a worker takes per dequeue */
+    sbool        sagan_queue_block;                     /* Block reader rather than drop when full */
+    char         fast_pattern_sample[MAXPATH];          /* Log used to find each rule's rarest content */
+    int          sagan_queue_shard;                     /* INPUT_FIELD_* giving each worker a queue,  or -1 */
+
+    sbool        replay_flag;                           /* Clock comes from the logs (-R) */
+    double       replay_speed;                          /* Multiple of real time.  0 is flat out */
+
+    sbool        parallel_flag;                         /* Files are mmap()'ed and split (-P) */
+    sbool        parallel_by_host;                      /* ... by host rather than by chunk */
+    sbool        parallel_ordered;                      /* Alerts in input order (-O) */
+
     sbool        sagan_external_output_flag;            /* For calling external commands */
     char         sagan_external_command[MAXPATH];
 
     int          sagan_port;
     sbool        disable_dns_warnings;
     sbool        syslog_src_lookup;
+    int          dns_cache_size;                        /* Max hosts in the DNS cache */
+    int          dns_cache_ttl;                         /* Seconds a lookup is cached */
+    int          dns_negative_ttl;                      /* Seconds a failed lookup is cached */
+    int          dns_threads;                           /* Resolver threads */
+    int          dns_wait;                              /* Milliseconds to wait on a lookup */
     int          sagan_proto;
 
     sbool	 pcre_jit; 				/* For PCRE JIT support testing */
+    sbool	 pcre_perf_map;				/* Write JIT symbols to /tmp/perf-<pid>.map */
+
+    sbool	 rule_profiling;			/* Per rule counters/timing (see rule-profile.c) */
+    int		 rule_profiling_top;			/* Rules in the report.  0 is all of them */
+
+    sbool	 rule_adaptive;				/* Reorder content/pcre/meta_content checks (see rule-adaptive.c) */
 
     sbool        endian;
 
@@ -59,6 +59,8 @@ typedef void json_object;
 #define MAXLEVEL		15		/* Max syslog 'level' length */
 
 #define MAX_PCRE_SIZE		1024		/* Max pcre length in a rule */
+#define PCRE_LITERAL_SIZE	64		/* Max literal pulled from a pcre for the prefilter */
+#define PCRE_LITERAL_MIN	3		/* Shorter ones are in most messages */
 
 #define MAX_FIFO_SIZE		1048576		/* Max pipe/FIFO size in bytes/pages */
 
@@ -114,6 +116,16 @@ typedef void json_object;
 /* defaults if the user doesn't define */
 
 #define MAX_PROCESSOR_THREADS   100
+#define DEFAULT_QUEUE_DEPTH	1024		/* Slots in the reader -> worker queue */
+#define DEFAULT_QUEUE_BATCH	16		/* Events a worker pulls per dequeue */
+#define DEFAULT_INPUT_ADDRESS	"0.0.0.0"	/* UDP/TCP inputs listen on all interfaces */
+#define DEFAULT_INPUT_PORT	514
+
+#define DEFAULT_DNS_CACHE_SIZE	4096		/* Hosts kept by the "source-lookup" cache */
+#define DEFAULT_DNS_CACHE_TTL	3600		/* Seconds */
+#define DEFAULT_DNS_NEGATIVE_TTL	300	/* Seconds */
+#define DEFAULT_DNS_THREADS	2
+#define DEFAULT_DNS_WAIT	100		/* Milliseconds */
 
 #define SUNDAY			1
 #define MONDAY			2
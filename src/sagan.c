@@ -42,7 +42,6 @@
 #include <getopt.h>
 #include <time.h>
 #include <signal.h>
-#include <pcre.h>
 #include <limits.h>
 #include <stdint.h>
 #include <inttypes.h>
@@ -68,6 +67,11 @@
 #include "usage.h"
 #include "stats.h"
 #include "ipc.h"
+#include "work-queue.h"
+#include "input.h"
+#include "input-net.h"
+#include "dns-cache.h"
+#include "util-pcre.h"
 #include "parsers/parsers.h"
 
 #ifdef HAVE_SYS_PRCTL_H
@@ -98,6 +102,7 @@ struct _SaganCounters *counters;
 struct _Rule_Struct *rulestruct;
 struct _SaganConfig *config;
 struct _SaganDebug *debug;
+struct _Sagan_Input *SaganInputs;
 
 #ifdef WITH_BLUEDOT
 #include <curl/curl.h>
@@ -109,20 +114,20 @@ struct _SaganDebug *debug;
 #include "redis.h"
 #endif
 
-struct _Sagan_Proc_Syslog *SaganProcSyslog = NULL;
+struct _Sagan_Work_Queue **SaganWorkQueues = NULL;
+int work_queue_count = 0;
 
-int proc_msgslot = 0;
 int proc_running = 0;
 
 unsigned char dynamic_rule_flag = 0;
 sbool reload_rules = false;
 
-pthread_cond_t SaganProcDoWork=PTHREAD_COND_INITIALIZER;
-
 pthread_mutex_t SaganProcWorkMutex=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t SaganMalformedCounter=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t SaganRulesLoadedMutex=PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t SaganDynamicFlag=PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t SaganInputMutex=PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t SaganDNSCacheMutex=PTHREAD_MUTEX_INITIALIZER;
 
 /* ########################################################################
  * Start of main() thread
@@ -145,11 +150,14 @@ int main(int argc, char **argv)
         { "log",          required_argument,    NULL,   'l' },
         { "file",	  required_argument,    NULL,   'F' },
         { "quiet", 	  no_argument, 		NULL, 	'Q' },
+        { "replay",	  required_argument,	NULL,	'R' },
+        { "parallel",	  required_argument,	NULL,	'P' },
+        { "ordered",	  no_argument,		NULL,	'O' },
         {0, 0, 0, 0}
     };
 
     static const char *short_options =
-        "l:f:u:F:d:c:pDhCQ";
+        "l:f:u:F:d:c:R:P:pDhCQO";
 
     int option_index = 0;
 
@@ -186,6 +194,8 @@ int main(int argc, char **argv)
     /* Various local variables						        */
     /****************************************************************************/
 
+    char pcre_version_string[64] = { 0 };
+
     /* Block all signals,  we create a signal handling thread */
 
     sigset_t signal_set;
@@ -207,30 +217,13 @@ int main(int argc, char **argv)
     pthread_attr_init(&ct_report_thread_attr);
     pthread_attr_setdetachstate(&ct_report_thread_attr,  PTHREAD_CREATE_DETACHED);
 
-    char src_dns_lookup[20] = { 0 };
-
-    sbool dns_flag = false;
-    sbool fifoerr = false;
-
-    char *syslog_host=NULL;
-    char *syslog_facility=NULL;
-    char *syslog_priority=NULL;
-    char *syslog_level=NULL;
-    char *syslog_tag=NULL;
-    char *syslog_date=NULL;
-    char *syslog_time=NULL;
-    char *syslog_program=NULL;
-    char *syslog_msg=NULL;
-
-    char *psyslogstring = NULL;
-    char syslogstring[MAX_SYSLOGMSG];
-
     signed char c;
     int rc=0;
 
     int i;
+    int processor_threads;
 
-    int dynamic_line_count = 0;
+    uint64_t queue_depth;
 
     time_t t;
     struct tm *run;
@@ -259,16 +252,6 @@ int main(int argc, char **argv)
 
     memset(config, 0, sizeof(_SaganConfig));
 
-    struct _SaganDNSCache *dnscache;
-    dnscache = malloc(sizeof(_SaganDNSCache));
-
-    if ( dnscache == NULL )
-        {
-            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for dnscache. Abort!", __FILE__, __LINE__);
-        }
-
-    memset(dnscache, 0, sizeof(_SaganDNSCache));
-
     counters = malloc(sizeof(_SaganCounters));
 
     if ( counters == NULL )
@@ -488,6 +471,43 @@ int main(int argc, char **argv)
                     strlcpy(config->sagan_config,optarg,sizeof(config->sagan_config) - 1);
                     break;
 
+                case 'P':
+                    config->parallel_flag = true;
+
+                    if (!strcasecmp(optarg, "host"))
+                        {
+                            config->parallel_by_host = true;
+                        }
+
+                    else if (strcasecmp(optarg, "chunk"))
+                        {
+                            fprintf(stderr, "Invalid parallel mode '%s'.  Use 'host' or 'chunk'.\n", optarg);
+                            exit(1);
+                        }
+
+                    break;
+
+                case 'O':
+                    config->parallel_ordered = true;
+                    break;
+
+                case 'R':
+                    config->replay_flag = true;
+
+                    if ( strcasecmp(optarg, "fast") )
+                        {
+
+                            config->replay_speed = atof(optarg);
+
+                            if ( config->replay_speed <= 0 )
+                                {
+                                    fprintf(stderr, "Invalid replay speed '%s'.  Use 'fast' or a multiple of real time (for example, 60).\n", optarg);
+                                    exit(1);
+                                }
+                        }
+
+                    break;
+
                 case 'l':
                     strlcpy(config->sagan_log_filepath,optarg,sizeof(config->sagan_log_filepath) - 1);
                     break;
@@ -602,36 +622,73 @@ int main(int argc, char **argv)
         }
 
 
-#ifdef PCRE_HAVE_JIT
-
     /* We test if pages will support RWX before loading rules.  If it doesn't due to the OS,
        we want to disable PCRE JIT now.  This prevents confusing warnings of PCRE JIT during
        rule load */
 
-    config->pcre_jit = true;
+    config->pcre_jit = PCRE_JIT_Supported();
 
-    if (PageSupportsRWX() == false)
+    if ( config->pcre_jit == true && PageSupportsRWX() == false)
         {
             Sagan_Log(S_WARN, "The operating system doens't allow RWX pages.  Disabling PCRE JIT.");
             config->pcre_jit = false;
         }
 
-#endif
-
     pthread_mutex_lock(&SaganRulesLoadedMutex);
     Load_YAML_Config(config->sagan_config);
     pthread_mutex_unlock(&SaganRulesLoadedMutex);
 
+    /* Thresholds, "after" and xbits depend on the order events are seen in,
+     * so a replay uses one worker to give the same answer every time.  That
+     * only holds with one input.  More than one,  or a network input,  and
+     * the order depends on when each reader gets to the queue */
+
+    if ( config->replay_flag )
+        {
+
+            if ( counters->input_count != 1 || SaganInputs[0].type == INPUT_TYPE_UDP || SaganInputs[0].type == INPUT_TYPE_TCP )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] -R/--replay needs exactly one input,  and it has to be a file or FIFO. Abort!", __FILE__, __LINE__);
+                }
+
+            config->max_processor_threads = 1;
+
+            if ( config->replay_speed > 0 )
+                {
+                    Sagan_Log(S_NORMAL, "Replay mode: clock taken from the logs at %g times real time.", config->replay_speed);
+                }
+            else
+                {
+                    Sagan_Log(S_NORMAL, "Replay mode: clock taken from the logs,  as fast as possible.");
+                }
+        }
+
     Sagan_Engine_Init();
 
-    SaganProcSyslog = malloc(config->max_processor_threads * sizeof(struct _Sagan_Proc_Syslog));
+    /* With "queue-shard",  each worker gets its own queue and queue-depth
+     * is split between them */
 
-    if ( SaganProcSyslog == NULL )
+    work_queue_count = config->sagan_queue_shard != -1 ? config->max_processor_threads : 1;
+    queue_depth = config->sagan_queue_depth / work_queue_count;
+
+    if ( queue_depth < (uint64_t)config->sagan_queue_batch * 2 )
         {
-            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for SaganProcSyslog. Abort!", __FILE__, __LINE__);
+            queue_depth = (uint64_t)config->sagan_queue_batch * 2;
         }
 
-    memset(SaganProcSyslog, 0, sizeof(struct _Sagan_Proc_Syslog));
+    SaganWorkQueues = malloc(work_queue_count * sizeof(struct _Sagan_Work_Queue *));
+
+    if ( SaganWorkQueues == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for SaganWorkQueues. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( i = 0; i < work_queue_count; i++ )
+        {
+            SaganWorkQueues[i] = Work_Queue_Init(queue_depth, (uint64_t)( config->max_processor_threads / work_queue_count ) * config->sagan_queue_batch);
+        }
 
     pthread_t processor_id[config->max_processor_threads];
     pthread_attr_t thread_processor_attr;
@@ -653,15 +710,11 @@ int main(int argc, char **argv)
     Sagan_Log(S_NORMAL, "Out of %d rules, %d xbit(s) are in use.", counters->rulecount, counters->xbit_total_counter);
     Sagan_Log(S_NORMAL, "Out of %d rules, %d dynamic rule(s) are loaded.", counters->rulecount, counters->dynamic_rule_count);
 
-#ifdef PCRE_HAVE_JIT
-
     if ( config->pcre_jit )
         {
             Sagan_Log(S_NORMAL, "PCRE JIT is enabled.");
         }
 
-#endif
-
     Sagan_Log(S_NORMAL, "");
     Sagan_Log(S_NORMAL, "Sagan version %s is firing up on '%s'!", VERSION, config->sagan_sensor_name);
     Sagan_Log(S_NORMAL, "");
@@ -692,6 +745,8 @@ int main(int argc, char **argv)
 #endif
 
 
+    Input_Listen();          /* Bind UDP/TCP inputs while we still can */
+
     Droppriv();              /* Become the Sagan user */
     Sagan_Log(S_NORMAL, "---------------------------------------------------------------------------");
 
@@ -870,12 +925,14 @@ int main(int argc, char **argv)
      * Continue with normal startup!
      ***************************************************************************/
 
+    PCRE_Version(pcre_version_string, sizeof(pcre_version_string));
+
     Sagan_Log(S_NORMAL, "");
     Sagan_Log(S_NORMAL, " ,-._,-. 	-*> Sagan! <*-");
     Sagan_Log(S_NORMAL, " \\/)\"(\\/	Version %s", VERSION);
     Sagan_Log(S_NORMAL, "  (_o_)	Champ Clark III & The Quadrant InfoSec Team [quadrantsec.com]");
     Sagan_Log(S_NORMAL, "  /   \\/)	Copyright (C) 2009-2017 Quadrant Information Security, et al.");
-    Sagan_Log(S_NORMAL, " (|| ||) 	Using PCRE version: %s", pcre_version());
+    Sagan_Log(S_NORMAL, " (|| ||) 	Using PCRE version: %s", pcre_version_string);
     Sagan_Log(S_NORMAL, "  oo-oo     Sagan is processing events.....");
     Sagan_Log(S_NORMAL, "");
 
@@ -950,9 +1007,42 @@ int main(int argc, char **argv)
 
 #endif
 
-    Sagan_Log(S_NORMAL, "Spawning %d Processor Threads.", config->max_processor_threads);
+    if ( config->syslog_src_lookup )
+        {
+            DNS_Cache_Init();
+        }
+
+    if ( work_queue_count > 1 )
+        {
+            Sagan_Log(S_NORMAL, "Work queue sharded by %s: %d queues with a depth of %" PRIu64 " and a batch size of %d (%s when full).", Input_Field_Name(config->sagan_queue_shard), work_queue_count, SaganWorkQueues[0]->depth, config->sagan_queue_batch, config->sagan_queue_block ? "block" : "drop");
+        }
+    else
+        {
+            Sagan_Log(S_NORMAL, "Work queue depth is %" PRIu64 " with a batch size of %d (%s when full).", SaganWorkQueues[0]->depth, config->sagan_queue_batch, config->sagan_queue_block ? "block" : "drop");
+        }
+    /* With -P,  files are run by their own workers.  Processor threads are
+     * only needed for anything else that feeds the queue */
+
+    processor_threads = config->max_processor_threads;
+
+    if ( config->parallel_flag )
+        {
+
+            processor_threads = 0;
+
+            for (i = 0; i < counters->input_count; i++)
+                {
+                    if ( SaganInputs[i].type != INPUT_TYPE_FILE )
+                        {
+                            processor_threads = config->max_processor_threads;
+                            break;
+                        }
+                }
+        }
+
+    Sagan_Log(S_NORMAL, "Spawning %d Processor Threads.", processor_threads);
 
-    for (i = 0; i < config->max_processor_threads; i++)
+    for (i = 0; i < processor_threads; i++)
         {
 
             rc = pthread_create ( &processor_id[i], &thread_processor_attr, (void *)Processor, NULL );
@@ -992,441 +1082,9 @@ int main(int argc, char **argv)
 
     Sagan_Log(S_NORMAL, "");
 
-    if ( !config->sagan_is_file )
-        {
-
-            Sagan_Log(S_NORMAL, "Attempting to open syslog FIFO (%s).", config->sagan_fifo);
-
-        }
-    else
-        {
-
-            Sagan_Log(S_NORMAL, "Attempting to open syslog FILE (%s).", config->sagan_fifo);
-
-        }
-
-
-
-    while(true)
-        {
-
-            FILE *fd;
-
-            if (( fd = fopen(config->sagan_fifo, "r" )) == NULL )
-                {
-
-                    if ( config->sagan_is_file == false )
-                        {
-
-                            /* try to create it */
-
-                            Sagan_Log(S_NORMAL, "Fifo not found, creating it (%s).", config->sagan_fifo);
-
-                            if (mkfifo(config->sagan_fifo, 0700) == -1)
-                                {
-                                    Sagan_Log(S_ERROR, "Could not create FIFO '%s'. Abort!", config->sagan_fifo);
-                                }
-
-                            fd = fopen(config->sagan_fifo, "r");
-
-                            if ( fd == NULL )
-                                {
-                                    Sagan_Log(S_ERROR, "Error opening %s. Abort!", config->sagan_fifo);
-                                }
-
-                        }
-                    else
-                        {
-
-                            Sagan_Log(S_ERROR, "Could not open file '%s'. Abort!", config->sagan_fifo);
-                        }
-
-                }
-
-            if ( config->sagan_is_file == false )
-                {
-                    Sagan_Log(S_NORMAL, "Successfully opened FIFO (%s).", config->sagan_fifo);
-
-#if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
-
-                    Set_Pipe_Size(fd);
-
-#endif
-
-                }
-            else
-                {
-                    Sagan_Log(S_NORMAL, "Successfully opened FILE (%s) and processing events.....", config->sagan_fifo);
-                }
-
-            while(fd != NULL)
-                {
-
-
-                    while(fgets(syslogstring, sizeof(syslogstring), fd) != NULL)
-                        {
-                            psyslogstring = syslogstring;
-
-                            /* If the FIFO was in a error state,  let user know the FIFO writer has resumed */
-
-                            if ( fifoerr == true )
-                                {
-
-                                    Sagan_Log(S_NORMAL, "FIFO writer has restarted. Processing events.");
-
-#if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
-
-                                    Set_Pipe_Size(fd);
-
-#endif
-                                    fifoerr = false;
-                                }
-
-                            counters->sagantotal++;
-
-                            /* If Dynamic rules are loaded,  keep track of line count */
-
-                            if ( config->dynamic_load_flag == true )
-                                {
-
-                                    dynamic_line_count++;
-                                }
-
-                            syslog_host = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-
-                            /* If we're using DNS (and we shouldn't be!),  we start DNS checks and lookups
-                             * here.  We cache both good and bad lookups to not over load our DNS server(s).
-                             * The only way DNS cache can be cleared is to restart Sagan */
-
-                            if (config->syslog_src_lookup )
-                                {
-
-                                    if ( !Is_IP(syslog_host) )   	/* Is inbound a valid IP? */
-                                        {
-                                            dns_flag = false;
-
-                                            for(i=0; i <= counters->dns_cache_count ; i++)  			/* Check cache first */
-                                                {
-                                                    if (!strcmp( dnscache[i].hostname, syslog_host))
-                                                        {
-                                                            syslog_host = dnscache[i].src_ip;
-                                                            dns_flag = true;
-                                                        }
-                                                }
-
-                                            /* If entry was not found in cache,  look it up */
-
-                                            if ( dns_flag == false )
-                                                {
-
-                                                    /* Do a DNS lookup */
-
-                                                    rc = DNS_Lookup(syslog_host, src_dns_lookup, sizeof(src_dns_lookup));
-
-                                                    /* Invalid lookups get the config->sagan_host value */
-
-                                                    if ( rc == -1 )
-                                                        {
-
-                                                            strlcpy(src_dns_lookup, config->sagan_host, sizeof(src_dns_lookup));
-                                                            counters->dns_miss_count++;
-
-                                                        }
-
-
-                                                    /* Add entry to DNS Cache */
-
-                                                    dnscache = (_SaganDNSCache *) realloc(dnscache, (counters->dns_cache_count+1) * sizeof(_SaganDNSCache));
-
-                                                    if ( dnscache == NULL )
-                                                        {
-
-                                                            Sagan_Log(S_ERROR, "[%s, line %d] Failed to reallocate memory for dnscache. Abort!", __FILE__, __LINE__);
-
-                                                        }
-
-                                                    strlcpy(dnscache[counters->dns_cache_count].hostname, syslog_host, sizeof(dnscache[counters->dns_cache_count].hostname));
-                                                    strlcpy(dnscache[counters->dns_cache_count].src_ip, src_dns_lookup, sizeof(dnscache[counters->dns_cache_count].src_ip));
-                                                    counters->dns_cache_count++;
-                                                    syslog_host = src_dns_lookup;
-
-                                                }
-                                        }
-
-                                }
-                            else
-                                {
-
-                                    /* We check to see if values from our FIFO are valid.  If we aren't doing DNS related
-                                    * stuff (above),  we start basic check with the syslog_host */
-
-                                    if (syslog_host == NULL || !Is_IP(syslog_host) )
-                                        {
-                                            syslog_host = config->sagan_host;
-
-                                            pthread_mutex_lock(&SaganMalformedCounter);
-                                            counters->malformed_host++;
-                                            pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                            if ( debug->debugmalformed )
-                                                {
-                                                    Sagan_Log(S_WARN, "Sagan received a malformed 'host': '%s' (replaced with %s)", syslog_host, config->sagan_host);
-                                                }
-                                        }
-                                }
-
-                            /* We now check the rest of the values */
-
-                            syslog_facility = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_facility == NULL )
-                                {
-
-                                    syslog_facility = "SAGAN: FACILITY ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_facility++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'facility'");
-                                        }
-                                }
-
-                            syslog_priority = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_priority == NULL )
-                                {
-
-                                    syslog_priority = "SAGAN: PRIORITY ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_priority++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'priority'");
-                                        }
-                                }
-
-                            syslog_level = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_level == NULL )
-                                {
-
-                                    syslog_level = "SAGAN: LEVEL ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_level++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'level'");
-                                        }
-                                }
-
-                            syslog_tag = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_tag == NULL )
-                                {
-
-                                    syslog_tag = "SAGAN: TAG ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_tag++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'tag'");
-                                        }
-                                }
-
-                            syslog_date = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_date == NULL )
-                                {
-
-                                    syslog_date = "SAGAN: DATE ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_date++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'date'");
-                                        }
-                                }
-
-                            syslog_time = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_time == NULL )
-                                {
-
-                                    syslog_time = "SAGAN: TIME ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_time++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'time'");
-                                        }
-                                }
-
-
-                            syslog_program = NULL != psyslogstring ? strsep(&psyslogstring, "|") : NULL;
-                            if ( syslog_program == NULL )
-                                {
-
-                                    syslog_program = "SAGAN: PROGRAM ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_program++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'program'");
-                                        }
-                                }
-                            syslog_msg = NULL != psyslogstring ? strsep(&psyslogstring, "") : NULL; /* In case the message has | in it,  we delimit on "" */
-
-                            if ( syslog_msg == NULL )
-                                {
-
-                                    syslog_msg = "SAGAN: MESSAGE ERROR";
-
-                                    pthread_mutex_lock(&SaganMalformedCounter);
-                                    counters->malformed_message++;
-                                    pthread_mutex_unlock(&SaganMalformedCounter);
-
-                                    if ( debug->debugmalformed )
-                                        {
-                                            Sagan_Log(S_WARN, "Sagan received a malformed 'message' [Syslog Host: %s]", syslog_host);
-                                        }
-
-                                    /* If the message is lost,  all is lost.  Typically,  you don't lose part of the message,
-                                     * it's more likely to lose all  - Champ Clark III 11/17/2011 */
-
-                                    counters->sagan_log_drop++;
-
-                                }
-
-                            /* Strip any \n or \r from the syslog_msg */
-
-                            if ( strcspn ( syslog_msg, "\n" ) < strlen(syslog_msg) )
-                                {
-                                    syslog_msg[strcspn ( syslog_msg, "\n" )] = '\0';
-                                }
-
-
-                            if ( proc_msgslot < config->max_processor_threads )
-                                {
-
-                                    pthread_mutex_lock(&SaganProcWorkMutex);
-
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_host, syslog_host, sizeof(SaganProcSyslog[proc_msgslot].syslog_host));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_facility, syslog_facility, sizeof(SaganProcSyslog[proc_msgslot].syslog_facility));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_priority, syslog_priority, sizeof(SaganProcSyslog[proc_msgslot].syslog_priority));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_level, syslog_level, sizeof(SaganProcSyslog[proc_msgslot].syslog_level));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_tag, syslog_tag, sizeof(SaganProcSyslog[proc_msgslot].syslog_tag));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_date, syslog_date, sizeof(SaganProcSyslog[proc_msgslot].syslog_date));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_time, syslog_time, sizeof(SaganProcSyslog[proc_msgslot].syslog_time));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_program, syslog_program, sizeof(SaganProcSyslog[proc_msgslot].syslog_program));
-                                    strlcpy(SaganProcSyslog[proc_msgslot].syslog_message, syslog_msg, sizeof(SaganProcSyslog[proc_msgslot].syslog_message));
-
-                                    if ( config->dynamic_load_flag == true && ( dynamic_line_count >= config->dynamic_load_sample_rate ) )
-                                        {
-
-                                            pthread_mutex_lock(&SaganDynamicFlag);
-                                            dynamic_rule_flag = DYNAMIC_RULE;
-                                            pthread_mutex_unlock(&SaganDynamicFlag);
-
-                                            dynamic_line_count = 0;
-                                        }
-
-
-                                    /* Thread holds here if rule load is in progress */
-
-                                    if ( config->dynamic_load_flag == true )
-                                        {
-
-                                            pthread_mutex_lock(&SaganRulesLoadedMutex);
-                                            reload_rules = true;
-                                            pthread_mutex_unlock(&SaganRulesLoadedMutex);
-
-                                        }
-
-                                    proc_msgslot++;
-
-                                    pthread_cond_signal(&SaganProcDoWork);
-                                    pthread_mutex_unlock(&SaganProcWorkMutex);
-
-                                }
-                            else
-                                {
-
-                                    counters->worker_thread_exhaustion++;
-                                    counters->sagan_log_drop++;
-                                }
-
-                            if (debug->debugthreads)
-                                {
-                                    Sagan_Log(S_DEBUG, "[%s, line %d] Current \"proc_msgslot\": %d", __FILE__, __LINE__, proc_msgslot);
-                                }
-
-                            if (debug->debugsyslog)
-                                {
-
-                                    Sagan_Log(S_DEBUG, "[%s, line %d] **[RAW Syslog]*********************************", __FILE__, __LINE__);
-                                    Sagan_Log(S_DEBUG, "[%s, line %d] Host: %s | Program: %s | Facility: %s | Priority: %s | Level: %s | Tag: %s", __FILE__, __LINE__, syslog_host, syslog_program, syslog_facility, syslog_priority, syslog_level, syslog_tag);
-                                    Sagan_Log(S_DEBUG, "[%s, line %d] Raw message: %s", __FILE__, __LINE__, syslog_msg);
-
-                                }
-
-
-                        } /* while(fgets) */
-
-                    /* fgets() has returned a error,  likely due to the FIFO writer leaving */
-
-                    /* RMEOVE LOCK */
-
-                    if ( fifoerr == false )
-                        {
-
-                            if ( config->sagan_is_file != 0 )
-                                {
-                                    Sagan_Log(S_NORMAL, "EOF reached. Waiting for threads to catch up....");
-                                    Sagan_Log(S_NORMAL, "");
-
-                                    while(proc_msgslot != 0 || proc_running != 0)
-                                        {
-                                            Sagan_Log(S_NORMAL, "Waiting on %d/%d threads....", proc_msgslot, proc_running);
-                                            sleep(1);
-                                        }
-
-                                    fclose(fd);
-                                    Statistics();
-                                    Remove_Lock_File();
-
-                                    Sagan_Log(S_NORMAL, "Exiting.");
-                                    exit(0);
-
-                                }
-                            else
-                                {
-
-                                    Sagan_Log(S_WARN, "FIFO writer closed.  Waiting for FIFO writer to restart....");
-                                    fifoerr = true; 			/* Set flag so our wile(fgets) knows */
-                                }
-                        }
-                    sleep(1);		/* So we don't eat 100% CPU */
-
-                } /* while(fd != NULL)  */
-
-            fclose(fd); 			/* ???? */
+    /* The main thread waits on the log readers */
 
-        } /* End of while(1) */
+    Input_Start();
 
 } /* End of main */
 
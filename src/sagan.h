@@ -32,7 +32,14 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
+
+#ifdef HAVE_LIBPCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#else
 #include <pcre.h>
+#endif
+
 #include <time.h>
 #include <arpa/inet.h>
 
@@ -140,7 +147,7 @@ char      *strrpbrk(const char *str, const char *accept);
 
 
 #if defined(F_GETPIPE_SZ) && defined(F_SETPIPE_SZ)
-void      Set_Pipe_Size( FILE * );
+void      Set_Pipe_Size( int );
 #endif
 
 
@@ -159,14 +166,6 @@ int       PageSupportsRWX(void);
 #endif
 
 
-typedef struct _SaganDNSCache _SaganDNSCache;
-struct _SaganDNSCache
-{
-
-    char hostname[64];
-    char src_ip[20];
-};
-
 typedef struct _Sagan_IPC_Counters _Sagan_IPC_Counters;
 struct _Sagan_IPC_Counters
 {
@@ -197,11 +196,19 @@ struct _SaganCounters
     uintmax_t after_total;
     uintmax_t sagantotal;
     uintmax_t saganfound;
+    uintmax_t event_alloc_total;		/* Heap allocations while processing events (--enable-alloc-count) */
     uintmax_t sagan_output_drop;
     uintmax_t sagan_processor_drop;
     uintmax_t sagan_log_drop;
     uintmax_t dns_cache_count;
     uintmax_t dns_miss_count;
+    uintmax_t dns_request_count;
+    uintmax_t dns_hit_count;
+    uintmax_t dns_lookup_count;
+    uintmax_t dns_timeout_count;
+    uintmax_t dns_evict_count;
+    uintmax_t dns_lookup_usec;
+    uintmax_t dns_lookup_max_usec;
     uintmax_t fwsam_count;
     uintmax_t ignore_count;
     uintmax_t blacklist_count;
@@ -257,6 +264,8 @@ struct _SaganCounters
 
     int	      rules_loaded_count;
 
+    int	      input_count;
+
     uintmax_t follow_flow_total;			/* This will only be needed if follow_flow is an option */
     uintmax_t follow_flow_drop;	     		        /* Amount of flows that did not match and were dropped */
 
@@ -373,6 +382,7 @@ struct _Sagan_Proc_Syslog
     char syslog_date[50];
     char syslog_time[50];
     char syslog_program[50];
+    time_t syslog_utime;		/* syslog_date/syslog_time,  replay mode only */
     char syslog_message[MAX_SYSLOGMSG];
 
 };
@@ -597,6 +607,14 @@ struct _Sagan_Lookup_Cache_Entry
     char ip[MAXIP];
 };
 
+/* Fields parsed out of the event being processed (see event-context.h) */
+
+struct _Sagan_Event_Context;
+
+/* A compiled rule check (see rules-index.h) */
+
+struct _Rule_Index_Op;
+
 
 /* Function that require the above arrays */
 
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include "sagan.h"
 #include "version.h"
 
@@ -36,6 +37,8 @@
 #include "gen-msg.h"
 
 #include "processors/engine.h"
+#include "input.h"
+#include "input-mmap.h"
 
 struct _SaganConfig *config;
 
@@ -44,13 +47,11 @@ void Send_Alert ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, json_object *json_n
 
     char tmp[64] = { 0 };
 
-    struct _Sagan_Event *SaganProcessorEvent = NULL;
-    SaganProcessorEvent = malloc(sizeof(struct _Sagan_Event));
+    /* Output is done with the event when we return (Input_Mmap_Defer()
+     * takes a copy),  so each thread reuses its own */
 
-    if ( SaganProcessorEvent == NULL )
-        {
-            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for SaganProcessorEvent. Abort!", __FILE__, __LINE__);
-        }
+    static __thread struct _Sagan_Event SaganProcessorEvent_Local;
+    struct _Sagan_Event *SaganProcessorEvent = &SaganProcessorEvent_Local;
 
     memset(SaganProcessorEvent, 0, sizeof(_Sagan_Event));
 
@@ -102,8 +103,12 @@ void Send_Alert ( _Sagan_Proc_Syslog *SaganProcSyslog_LOCAL, json_object *json_n
 
     SaganProcessorEvent->json_normalize     =    json_normalize;
 
-    Output ( SaganProcessorEvent );
-    free(SaganProcessorEvent);
+    /* -P/-O workers hold alerts until they can be written in input order */
+
+    if ( Input_Mmap_Defer(SaganProcessorEvent) == false )
+        {
+            Output ( SaganProcessorEvent );
+        }
 
 }
 
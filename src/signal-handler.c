@@ -53,11 +53,17 @@
 #include "lockfile.h"
 #include "signal-handler.h"
 #include "stats.h"
+#include "rule-profile.h"
+#include "rule-adaptive.h"
+#include "rule-pool.h"
 #include "gen-msg.h"
 #include "classifications.h"
 
 #include "processors/perfmon.h"
 #include "rules.h"
+#include "processor.h"
+#include "input.h"
+#include "input-mmap.h"
 #include "ignore-list.h"
 #include "check-flow.h"
 
@@ -104,8 +110,8 @@ struct _Sagan_BroIntel_Intel_User_Name *Sagan_BroIntel_Intel_User_Name;
 struct _Sagan_BroIntel_Intel_File_Name *Sagan_BroIntel_Intel_File_Name;
 struct _Sagan_BroIntel_Intel_Cert_Hash *Sagan_BroIntel_Intel_Cert_Hash;
 
-pthread_mutex_t SaganReloadMutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t SaganReloadCond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t SaganProcIdleCond = PTHREAD_COND_INITIALIZER;
 
 pthread_mutex_t SaganRulesLoadedMutex;
 
@@ -140,6 +146,7 @@ void Sig_Handler( void )
 
                     Sagan_Log(S_NORMAL, "\n\n[Received signal %d. Sagan version %s shutting down]-------\n", sig, VERSION);
                     Statistics();
+                    Rule_Profile_Report();
 
 #if defined(HAVE_DNET_H) || defined(HAVE_DUMBNET_H)
                     if ( sagan_unified2_flag )
@@ -264,9 +271,20 @@ void Sig_Handler( void )
 
                 case SIGHUP:
 
-                    config->sagan_reload = 1;				/* Only this thread can alter this */
+                    /* Wait for the workers to put the rules down.  Only this
+                     * thread can alter sagan_reload */
 
-                    pthread_mutex_lock(&SaganReloadMutex);
+                    Processor_Pause();
+
+                    /* Rules are freed below (the rule pool with them),  and
+                     * -O alerts still to be written refer to them */
+
+                    if ( Input_Mmap_Holding() )
+                        {
+                            Processor_Resume();
+                            Sagan_Log(S_WARN, "Not reloading: a file is being processed with -P/-O and its held alerts refer to the loaded rules.  Send SIGHUP again once it is done.");
+                            break;
+                        }
 
                     Sagan_Log(S_NORMAL, "[Reloading Sagan version %s.]-------", VERSION);
 
@@ -291,6 +309,7 @@ void Sig_Handler( void )
 
                     memset(rules_loaded, 0, sizeof(_Rules_Loaded));
                     memset(rulestruct, 0, sizeof(_Rule_Struct));
+                    Rule_Pool_Free();
                     memset(classstruct, 0, sizeof(_Class_Struct));
                     memset(generator, 0, sizeof(_Sagan_Processor_Generator));
                     memset(var, 0, sizeof(_SaganVar));
@@ -400,6 +419,9 @@ void Sig_Handler( void )
                     Load_YAML_Config(config->sagan_config);	/* <- RELOAD */
                     pthread_mutex_unlock(&SaganRulesLoadedMutex);
 
+                    Rule_Profile_Reset();
+                    Rule_Adaptive_Reset();
+
                     /************************************************************/
                     /* Re-load primary configuration (rules/classifictions/etc) */
                     /************************************************************/
@@ -468,10 +490,7 @@ void Sig_Handler( void )
                     Open_GeoIP2_Database();
 #endif
 
-                    pthread_cond_signal(&SaganReloadCond);
-                    pthread_mutex_unlock(&SaganReloadMutex);
-
-                    config->sagan_reload = 0;
+                    Processor_Resume();
 
                     Sagan_Log(S_NORMAL, "Configuration reloaded.");
                     break;
@@ -483,6 +502,7 @@ void Sig_Handler( void )
 
                 case SIGUSR1:
                     Statistics();
+                    Rule_Profile_Report();
                     break;
 
                 default:
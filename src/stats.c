@@ -39,12 +39,18 @@
 #include "sagan-defs.h"
 #include "stats.h"
 #include "sagan-config.h"
+#include "work-queue.h"
+#include "input.h"
 
 struct _SaganCounters *counters;
+struct _Sagan_Work_Queue **SaganWorkQueues;
+struct _Sagan_Input *SaganInputs;
 struct _Sagan_IPC_Counters *counters_ipc;
 
 struct _SaganConfig *config;
 
+int work_queue_count;			/* Comes from sagan.c */
+
 void Statistics( void )
 {
 
@@ -55,6 +61,12 @@ void Statistics( void )
     int seconds = 0;
     unsigned long total=0;
 
+    uint64_t queue_depth;
+    uint64_t queue_size;
+    uint64_t queue_high;
+    uint64_t queue_full;
+    int q;
+
     int uptime_days;
     int uptime_abovedays;
     int uptime_hours;
@@ -62,6 +74,8 @@ void Statistics( void )
     int uptime_minutes;
     int uptime_seconds;
 
+    int i;
+
 #ifdef WITH_BLUEDOT
     unsigned long bluedot_ip_total=0;
     unsigned long bluedot_hash_total=0;
@@ -111,6 +125,10 @@ void Statistics( void )
 
             Sagan_Log(S_NORMAL, "           Thread Exhaustion        : %" PRIuMAX " (%.3f%%)", counters->worker_thread_exhaustion,  CalcPct( counters->worker_thread_exhaustion, counters->sagantotal) );
 
+#ifdef WITH_ALLOC_COUNT
+            Sagan_Log(S_NORMAL, "           Heap allocations/event   : %.3f (%" PRIuMAX " total)", counters->sagantotal != 0 ? (double)counters->event_alloc_total / counters->sagantotal : 0.0, counters->event_alloc_total);
+#endif
+
 
             if (config->sagan_droplist_flag)
                 {
@@ -154,6 +172,59 @@ void Statistics( void )
                 }
 
 
+            if ( SaganWorkQueues != NULL )
+                {
+
+                    /* Sharded queues are reported as one.  The high water
+                     * mark is the deepest any one queue has been */
+
+                    queue_depth = 0;
+                    queue_size = 0;
+                    queue_high = 0;
+                    queue_full = 0;
+
+                    for ( q = 0; q < work_queue_count; q++ )
+                        {
+                            queue_depth += Work_Queue_Depth(SaganWorkQueues[q]);
+                            queue_size += SaganWorkQueues[q]->depth;
+                            queue_full += SaganWorkQueues[q]->full_count;
+
+                            if ( SaganWorkQueues[q]->high_water > queue_high )
+                                {
+                                    queue_high = SaganWorkQueues[q]->high_water;
+                                }
+                        }
+
+                    Sagan_Log(S_NORMAL, "");
+                    Sagan_Log(S_NORMAL, "          -[ Sagan Work Queue Statistics ]-");
+                    Sagan_Log(S_NORMAL, "");
+
+                    if ( work_queue_count > 1 )
+                        {
+                            Sagan_Log(S_NORMAL, "           Queues                   : %d (by %s)", work_queue_count, Input_Field_Name(config->sagan_queue_shard));
+                        }
+
+                    Sagan_Log(S_NORMAL, "           Queue Depth              : %" PRIu64 " / %" PRIu64 "", queue_depth, queue_size);
+                    Sagan_Log(S_NORMAL, "           High Water Mark          : %" PRIu64 " (%.3f%%)", queue_high, CalcPct(queue_high, SaganWorkQueues[0]->depth) );
+                    Sagan_Log(S_NORMAL, "           Queue Full               : %" PRIu64 "", queue_full);
+                }
+
+            if ( counters->input_count > 0 )
+                {
+
+                    Sagan_Log(S_NORMAL, "");
+                    Sagan_Log(S_NORMAL, "          -[ Sagan Input Statistics ]-");
+
+                    for ( i = 0; i < counters->input_count; i++ )
+                        {
+                            Sagan_Log(S_NORMAL, "");
+                            Sagan_Log(S_NORMAL, "           %-4s                     : %s", Input_Type_Name(SaganInputs[i].type), SaganInputs[i].path);
+                            Sagan_Log(S_NORMAL, "           Lines                    : %" PRIuMAX "", SaganInputs[i].lines);
+                            Sagan_Log(S_NORMAL, "           Malformed Fields         : %" PRIuMAX "", SaganInputs[i].malformed);
+                            Sagan_Log(S_NORMAL, "           Dropped                  : %" PRIuMAX " (%.3f%%)", SaganInputs[i].dropped, CalcPct(SaganInputs[i].dropped, SaganInputs[i].lines) );
+                        }
+                }
+
             Sagan_Log(S_NORMAL, "");
             Sagan_Log(S_NORMAL, "          -[ Sagan Processor Statistics ]-");
             Sagan_Log(S_NORMAL, "");
@@ -193,8 +264,14 @@ void Statistics( void )
                     Sagan_Log(S_NORMAL, "");
                     Sagan_Log(S_NORMAL, "          -[ Sagan DNS Cache Statistics ]-");
                     Sagan_Log(S_NORMAL, "");
-                    Sagan_Log(S_NORMAL, "           Cached                   : %" PRIuMAX "", counters->dns_cache_count);
-                    Sagan_Log(S_NORMAL, "           Missed                   : %" PRIuMAX " (%.3f%%)", counters->dns_miss_count, CalcPct(counters->dns_miss_count, counters->dns_cache_count));
+                    Sagan_Log(S_NORMAL, "           Cached                   : %" PRIuMAX " (max %d)", counters->dns_cache_count, config->dns_cache_size);
+                    Sagan_Log(S_NORMAL, "           Requests                 : %" PRIuMAX "", counters->dns_request_count);
+                    Sagan_Log(S_NORMAL, "           Hits                     : %" PRIuMAX " (%.3f%%)", counters->dns_hit_count, CalcPct(counters->dns_hit_count, counters->dns_request_count));
+                    Sagan_Log(S_NORMAL, "           Lookups                  : %" PRIuMAX "", counters->dns_lookup_count);
+                    Sagan_Log(S_NORMAL, "           Missed                   : %" PRIuMAX " (%.3f%%)", counters->dns_miss_count, CalcPct(counters->dns_miss_count, counters->dns_lookup_count));
+                    Sagan_Log(S_NORMAL, "           Timed Out                : %" PRIuMAX " (%.3f%%)", counters->dns_timeout_count, CalcPct(counters->dns_timeout_count, counters->dns_request_count));
+                    Sagan_Log(S_NORMAL, "           Evicted                  : %" PRIuMAX "", counters->dns_evict_count);
+                    Sagan_Log(S_NORMAL, "           Lookup Time (avg/max)    : %.3f / %.3f ms", counters->dns_lookup_count ? (double)counters->dns_lookup_usec / counters->dns_lookup_count / 1000 : 0, (double)counters->dns_lookup_max_usec / 1000);
                 }
 
             Sagan_Log(S_NORMAL, "");
@@ -35,6 +35,7 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "sagan-config.h"
 #include "rules.h"
 #include "threshold.h"
@@ -67,8 +68,6 @@ sbool Thresh_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bit
 {
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     sbool thresh_log_flag = false;
 
@@ -76,9 +75,7 @@ sbool Thresh_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bit
 
     int i;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array for matching src / sid */
 
@@ -101,14 +98,14 @@ sbool Thresh_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bit
                     pthread_mutex_lock(&Thresh_By_Src_Mutex);
 
                     threshbysrc_ipc[i].count++;
-                    thresh_oldtime = atol(timet) - threshbysrc_ipc[i].utime;
+                    thresh_oldtime = t - threshbysrc_ipc[i].utime;
 
-                    threshbysrc_ipc[i].utime = atol(timet);
+                    threshbysrc_ipc[i].utime = t;
 
                     if ( thresh_oldtime > rulestruct[rule_position].threshold_seconds )
                         {
                             threshbysrc_ipc[i].count=1;
-                            threshbysrc_ipc[i].utime = atol(timet);
+                            threshbysrc_ipc[i].utime = t;
                             thresh_log_flag = false;
                         }
 
@@ -144,7 +141,7 @@ sbool Thresh_By_Src ( int rule_position, char *ip_src, unsigned char *ip_src_bit
             strlcpy(threshbysrc_ipc[counters_ipc->thresh_count_by_src].sid, rulestruct[rule_position].s_sid, sizeof(threshbysrc_ipc[counters_ipc->thresh_count_by_src].sid));
             NULL == selector ? threshbysrc_ipc[counters_ipc->thresh_count_by_src].selector[0] = '\0' : strlcpy(threshbysrc_ipc[counters_ipc->thresh_count_by_src].selector, selector, MAXSELECTOR);
             threshbysrc_ipc[counters_ipc->thresh_count_by_src].count = 1;
-            threshbysrc_ipc[counters_ipc->thresh_count_by_src].utime = atol(timet);
+            threshbysrc_ipc[counters_ipc->thresh_count_by_src].utime = t;
             threshbysrc_ipc[counters_ipc->thresh_count_by_src].expire = rulestruct[rule_position].threshold_seconds;
 
             counters_ipc->thresh_count_by_src++;
@@ -164,8 +161,6 @@ sbool Thresh_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bit
 {
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     sbool thresh_log_flag = false;
 
@@ -173,9 +168,7 @@ sbool Thresh_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bit
 
     int i;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array for matching dst / sid */
 
@@ -198,15 +191,15 @@ sbool Thresh_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bit
                     pthread_mutex_lock(&Thresh_By_Dst_Mutex);
 
                     threshbydst_ipc[i].count++;
-                    thresh_oldtime = atol(timet) - threshbydst_ipc[i].utime;
+                    thresh_oldtime = t - threshbydst_ipc[i].utime;
 
-                    threshbydst_ipc[i].utime = atol(timet);
+                    threshbydst_ipc[i].utime = t;
 
                     if ( thresh_oldtime > rulestruct[rule_position].threshold_seconds )
                         {
 
                             threshbydst_ipc[i].count=1;
-                            threshbydst_ipc[i].utime = atol(timet);
+                            threshbydst_ipc[i].utime = t;
                             thresh_log_flag = false;
 
                         }
@@ -243,7 +236,7 @@ sbool Thresh_By_Dst ( int rule_position, char *ip_dst, unsigned char *ip_dst_bit
             strlcpy(threshbydst_ipc[counters_ipc->thresh_count_by_dst].sid, rulestruct[rule_position].s_sid, sizeof(threshbydst_ipc[counters_ipc->thresh_count_by_dst].sid));
             NULL == selector ? threshbydst_ipc[counters_ipc->thresh_count_by_dst].selector[0] = '\0' : strlcpy(threshbydst_ipc[counters_ipc->thresh_count_by_dst].selector, selector, MAXSELECTOR);
             threshbydst_ipc[counters_ipc->thresh_count_by_dst].count = 1;
-            threshbydst_ipc[counters_ipc->thresh_count_by_dst].utime = atol(timet);
+            threshbydst_ipc[counters_ipc->thresh_count_by_dst].utime = t;
             threshbydst_ipc[counters_ipc->thresh_count_by_dst].expire = rulestruct[rule_position].threshold_seconds;
 
             counters_ipc->thresh_count_by_dst++;
@@ -263,8 +256,6 @@ sbool Thresh_By_Username( int rule_position, char *normalize_username, char *sel
 {
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     sbool thresh_log_flag = false;
 
@@ -272,9 +263,7 @@ sbool Thresh_By_Username( int rule_position, char *normalize_username, char *sel
 
     int i;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array fror matching username / sid */
 
@@ -297,13 +286,13 @@ sbool Thresh_By_Username( int rule_position, char *normalize_username, char *sel
                     pthread_mutex_lock(&Thresh_By_Username_Mutex);
 
                     threshbyusername_ipc[rule_position].count++;
-                    thresh_oldtime = atol(timet) - threshbyusername_ipc[rule_position].utime;
-                    threshbyusername_ipc[rule_position].utime = atol(timet);
+                    thresh_oldtime = t - threshbyusername_ipc[rule_position].utime;
+                    threshbyusername_ipc[rule_position].utime = t;
 
                     if ( thresh_oldtime > rulestruct[rule_position].threshold_seconds )
                         {
                             threshbyusername_ipc[rule_position].count=1;
-                            threshbyusername_ipc[rule_position].utime = atol(timet);
+                            threshbyusername_ipc[rule_position].utime = t;
                             thresh_log_flag = false;
                         }
 
@@ -340,7 +329,7 @@ sbool Thresh_By_Username( int rule_position, char *normalize_username, char *sel
             strlcpy(threshbyusername_ipc[counters_ipc->thresh_count_by_username].sid, rulestruct[rule_position].s_sid, sizeof(threshbyusername_ipc[counters_ipc->thresh_count_by_username].sid));
             NULL == selector ? threshbyusername_ipc[counters_ipc->thresh_count_by_username].selector[0] = '\0' : strlcpy(threshbyusername_ipc[counters_ipc->thresh_count_by_username].selector, selector, MAXSELECTOR);
             threshbyusername_ipc[counters_ipc->thresh_count_by_username].count = 1;
-            threshbyusername_ipc[counters_ipc->thresh_count_by_username].utime = atol(timet);
+            threshbyusername_ipc[counters_ipc->thresh_count_by_username].utime = t;
             threshbyusername_ipc[counters_ipc->thresh_count_by_username].expire = rulestruct[rule_position].threshold_seconds;
 
             counters_ipc->thresh_count_by_username++;
@@ -360,8 +349,6 @@ sbool Thresh_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *selec
 {
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     sbool thresh_log_flag = false;
 
@@ -369,9 +356,7 @@ sbool Thresh_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *selec
 
     int i;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array for matching dst port / sid */
 
@@ -394,14 +379,14 @@ sbool Thresh_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *selec
                     pthread_mutex_lock(&Thresh_By_Dst_Port_Mutex);
 
                     threshbydstport_ipc[rule_position].count++;
-                    thresh_oldtime = atol(timet) - threshbydstport_ipc[rule_position].utime;
-                    threshbydstport_ipc[rule_position].utime = atol(timet);
+                    thresh_oldtime = t - threshbydstport_ipc[rule_position].utime;
+                    threshbydstport_ipc[rule_position].utime = t;
 
                     if ( thresh_oldtime > rulestruct[rule_position].threshold_seconds )
                         {
 
                             threshbydstport_ipc[rule_position].count=1;
-                            threshbydstport_ipc[rule_position].utime = atol(timet);
+                            threshbydstport_ipc[rule_position].utime = t;
                             thresh_log_flag = false;
                         }
 
@@ -438,7 +423,7 @@ sbool Thresh_By_DstPort( int rule_position, uint32_t ip_dstport_u32, char *selec
             strlcpy(threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].sid, rulestruct[rule_position].s_sid, sizeof(threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].sid));
             NULL == selector ? threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].selector[0] = '\0' : strlcpy(threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].selector, selector, MAXSELECTOR);
             threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].count = 1;
-            threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].utime = atol(timet);
+            threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].utime = t;
             threshbydstport_ipc[counters_ipc->thresh_count_by_dstport].expire = rulestruct[rule_position].threshold_seconds;
 
             counters_ipc->thresh_count_by_dstport++;
@@ -458,8 +443,6 @@ sbool Thresh_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *selec
 {
 
     time_t t;
-    struct tm *now;
-    char  timet[20];
 
     sbool thresh_log_flag = false;
 
@@ -467,9 +450,7 @@ sbool Thresh_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *selec
 
     int i;
 
-    t = time(NULL);
-    now=localtime(&t);
-    strftime(timet, sizeof(timet), "%s",  now);
+    t = Sagan_Time();
 
     /* Check array for matching src port / sid */
 
@@ -492,14 +473,14 @@ sbool Thresh_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *selec
                     pthread_mutex_lock(&Thresh_By_Src_Port_Mutex);
 
                     threshbysrcport_ipc[rule_position].count++;
-                    thresh_oldtime = atol(timet) - threshbysrcport_ipc[rule_position].utime;
-                    threshbysrcport_ipc[rule_position].utime = atol(timet);
+                    thresh_oldtime = t - threshbysrcport_ipc[rule_position].utime;
+                    threshbysrcport_ipc[rule_position].utime = t;
 
                     if ( thresh_oldtime > rulestruct[rule_position].threshold_seconds )
                         {
 
                             threshbysrcport_ipc[rule_position].count=1;
-                            threshbysrcport_ipc[rule_position].utime = atol(timet);
+                            threshbysrcport_ipc[rule_position].utime = t;
                             thresh_log_flag = false;
                         }
 
@@ -536,7 +517,7 @@ sbool Thresh_By_SrcPort( int rule_position, uint32_t ip_srcport_u32, char *selec
             strlcpy(threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].sid, rulestruct[rule_position].s_sid, sizeof(threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].sid));
             NULL == selector ? threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].selector[0] = '\0' : strlcpy(threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].selector, selector, MAXSELECTOR);
             threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].count = 1;
-            threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].utime = atol(timet);
+            threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].utime = t;
             threshbysrcport_ipc[counters_ipc->thresh_count_by_srcport].expire = rulestruct[rule_position].threshold_seconds;
 
             counters_ipc->thresh_count_by_srcport++;
@@ -75,6 +75,15 @@ void Usage(void)
     fprintf(stderr, "\t\t\tfrom a FIFO.  The file must be in the Sagan format!\n");
     fprintf(stderr, "-l, --log [file]\tsagan.log location [default: %s].\n", SAGANLOG );
     fprintf(stderr, "-Q, --quiet\t\tRun Sagan in 'quiet' mode (no console output)\n");
+    fprintf(stderr, "-P, --parallel [mode]\tmmap() files and have the worker threads process them\n");
+    fprintf(stderr, "\t\t\tdirectly.  'host' keeps each host's events on one\n");
+    fprintf(stderr, "\t\t\tworker,  'chunk' is fastest.  One worker is used if\n");
+    fprintf(stderr, "\t\t\tafter/threshold/xbit/dynamic rules are loaded.\n");
+    fprintf(stderr, "-O, --ordered\t\tWith -P,  write alerts in the order of the input.\n");
+    fprintf(stderr, "-R, --replay [speed]\tTake the clock from the logs rather than the system\n");
+    fprintf(stderr, "\t\t\t(thresholds, after, xbits).  'fast' or a multiple of\n");
+    fprintf(stderr, "\t\t\treal time.  Uses one worker thread so results repeat.\n");
+    fprintf(stderr, "\t\t\tNeeds a single file or FIFO input.\n");
     fprintf(stderr, "\n");
 
 #ifdef HAVE_LIBESMTP
@@ -0,0 +1,831 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* util-pcre.c
+ *
+ * Compiling and matching "pcre:" rule options.  With PCRE2 (the default
+ * when configure finds it) patterns are JIT compiled once at load,  and
+ * each worker thread matches with its own pcre2_match_data and JIT stack.
+ * Without it,  we fall back to the legacy libpcre pcre_compile()/
+ * pcre_study()/pcre_exec().
+ *
+ * With "pcre-perf-map",  the address of each JIT compiled pattern is
+ * written to /tmp/perf-<pid>.map so "perf" can name the JIT frames.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
+#include "rules.h"
+#include "lockfile.h"
+#include "util-pcre.h"
+
+struct _Rule_Struct *rulestruct;
+struct _SaganConfig *config;
+
+#ifdef HAVE_LIBPCRE2
+
+static __thread pcre2_match_data *pcre_match_data = NULL;
+static __thread pcre2_match_context *pcre_match_context = NULL;
+static __thread pcre2_jit_stack *pcre_jit_stack = NULL;
+
+static FILE *pcre_perf_map = NULL;
+static pthread_mutex_t PCREPerfMapMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* PCRE2 doesn't hand out where a pattern's JIT code lives.  This is the
+ * start of its (private) struct for it,  which hasn't changed since
+ * 10.00.  We only trust it when the sizes add up to PCRE2_INFO_JITSIZE */
+
+struct _PCRE_JIT_Functions
+{
+    void *executable_funcs[3];
+    void *read_only_data_heads[3];
+    size_t executable_sizes[3];
+};
+
+struct _PCRE_Code_Head
+{
+    void *memctl[3];
+    const uint8_t *tables;
+    struct _PCRE_JIT_Functions *executable_jit;
+};
+
+/****************************************************************************
+ * PCRE_Thread_Init - Match data,  match context and JIT stack for the
+ * calling thread.  This happens on a thread's first pcre,  so only threads
+ * that match ever allocate them.
+ ****************************************************************************/
+
+static void PCRE_Thread_Init( void )
+{
+
+    pcre_match_data = pcre2_match_data_create(PCRE_OVECCOUNT / 3, NULL);
+    pcre_match_context = pcre2_match_context_create(NULL);
+
+    if ( pcre_match_data == NULL || pcre_match_context == NULL )
+        {
+            Remove_Lock_File();
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for PCRE2 match data. Abort!", __FILE__, __LINE__);
+        }
+
+    if ( config->pcre_jit == true )
+        {
+
+            pcre_jit_stack = pcre2_jit_stack_create(PCRE_JIT_STACK_START, PCRE_JIT_STACK_MAX, NULL);
+
+            if ( pcre_jit_stack == NULL )
+                {
+                    Remove_Lock_File();
+                    Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for a PCRE2 JIT stack. Abort!", __FILE__, __LINE__);
+                }
+
+            pcre2_jit_stack_assign(pcre_match_context, NULL, pcre_jit_stack);
+
+        }
+
+}
+
+#endif
+
+/****************************************************************************
+ * PCRE_Version - The PCRE library version,  for the banner
+ ****************************************************************************/
+
+void PCRE_Version( char *str, size_t size )
+{
+
+#ifdef HAVE_LIBPCRE2
+
+    char version[64] = { 0 };
+
+    pcre2_config(PCRE2_CONFIG_VERSION, version);
+    snprintf(str, size, "PCRE2 %s", version);
+
+#else
+
+    snprintf(str, size, "%s", pcre_version());
+
+#endif
+
+}
+
+/****************************************************************************
+ * PCRE_JIT_Supported - Was the PCRE library built with JIT?
+ ****************************************************************************/
+
+sbool PCRE_JIT_Supported( void )
+{
+
+#ifdef HAVE_LIBPCRE2
+
+    uint32_t jit = 0;
+
+    pcre2_config(PCRE2_CONFIG_JIT, &jit);
+    return(jit == 1);
+
+#elif defined(PCRE_HAVE_JIT)
+
+    return(true);
+
+#else
+
+    return(false);
+
+#endif
+
+}
+
+/****************************************************************************
+ * PCRE_Compile - Compiles (and with config->pcre_jit,  JIT compiles) a
+ * pattern into rulestruct[rule_position].re_pcre[pcre_position].  On
+ * failure,  "error" and "erroffset" say why.
+ ****************************************************************************/
+
+sbool PCRE_Compile( int rule_position, int pcre_position, const char *pattern, int options, char *error, size_t error_size, int *erroffset )
+{
+
+#ifdef HAVE_LIBPCRE2
+
+    pcre2_code *re = NULL;
+    int errorcode = 0;
+    PCRE2_SIZE offset = 0;
+
+    rulestruct[rule_position].pcre_jit[pcre_position] = false;
+
+    re = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, (uint32_t)options, &errorcode, &offset, NULL);
+
+    if ( re == NULL )
+        {
+            pcre2_get_error_message(errorcode, (PCRE2_UCHAR *)error, error_size);
+            *erroffset = (int)offset;
+            return(false);
+        }
+
+    if ( config->pcre_jit == true && pcre2_jit_compile(re, PCRE2_JIT_COMPLETE) == 0 )
+        {
+
+            rulestruct[rule_position].pcre_jit[pcre_position] = true;
+        }
+
+    rulestruct[rule_position].re_pcre[pcre_position] = re;
+
+    return(true);
+
+#else
+
+    const char *pcre_error = NULL;
+
+    rulestruct[rule_position].re_pcre[pcre_position] = pcre_compile( pattern, options, &pcre_error, erroffset, NULL );
+
+    if ( rulestruct[rule_position].re_pcre[pcre_position] == NULL )
+        {
+            strlcpy(error, pcre_error, error_size);
+            return(false);
+        }
+
+#ifdef PCRE_HAVE_JIT
+
+    rulestruct[rule_position].pcre_extra[pcre_position] = pcre_study( rulestruct[rule_position].re_pcre[pcre_position], config->pcre_jit == true ? PCRE_STUDY_JIT_COMPILE : 0, &pcre_error);
+
+    if ( config->pcre_jit == true )
+        {
+
+            int jit = 0;
+
+            if ( pcre_fullinfo(rulestruct[rule_position].re_pcre[pcre_position], rulestruct[rule_position].pcre_extra[pcre_position], PCRE_INFO_JIT, &jit) == 0 && jit == 1 )
+                {
+                    rulestruct[rule_position].pcre_jit[pcre_position] = true;
+                }
+
+        }
+
+#else
+
+    rulestruct[rule_position].pcre_extra[pcre_position] = pcre_study( rulestruct[rule_position].re_pcre[pcre_position], 0, &pcre_error);
+
+#endif
+
+    return(true);
+
+#endif
+
+}
+
+/****************************************************************************
+ * PCRE_Perf_Map - Adds the JIT code of a rule's pcre to the perf map.
+ * This is called once the whole rule is parsed,  so we know its sid.
+ ****************************************************************************/
+
+void PCRE_Perf_Map( int rule_position, int pcre_position )
+{
+
+#ifdef HAVE_LIBPCRE2
+
+    pcre2_code *re = rulestruct[rule_position].re_pcre[pcre_position];
+    struct _PCRE_JIT_Functions *jit = ((struct _PCRE_Code_Head *)re)->executable_jit;
+    size_t jit_size = 0;
+    char filename[64] = { 0 };
+    int i;
+
+    if ( rulestruct[rule_position].pcre_jit[pcre_position] == false ||
+            pcre2_pattern_info(re, PCRE2_INFO_JITSIZE, &jit_size) != 0 || jit_size == 0 || jit == NULL )
+        {
+            return;
+        }
+
+    if ( jit->executable_sizes[0] + jit->executable_sizes[1] + jit->executable_sizes[2] != jit_size )
+        {
+            Sagan_Log(S_WARN, "[%s, line %d] This PCRE2 version's JIT layout isn't known.  No perf map entry for sid %s.", __FILE__, __LINE__, rulestruct[rule_position].s_sid);
+            return;
+        }
+
+    pthread_mutex_lock(&PCREPerfMapMutex);
+
+    if ( pcre_perf_map == NULL )
+        {
+
+            snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", (int)getpid());
+
+            if (( pcre_perf_map = fopen(filename, "a" )) == NULL )
+                {
+                    pthread_mutex_unlock(&PCREPerfMapMutex);
+                    Sagan_Log(S_WARN, "[%s, line %d] Cannot open %s for writing: %s", __FILE__, __LINE__, filename, strerror(errno));
+                    config->pcre_perf_map = false;
+                    return;
+                }
+
+            Sagan_Log(S_NORMAL, "Writing PCRE JIT symbols to %s", filename);
+        }
+
+    /* One entry per compile mode (complete,  partial soft/hard).  We only
+     * use complete matching,  but a map entry costs nothing */
+
+    for ( i = 0; i < 3; i++ )
+        {
+
+            if ( jit->executable_funcs[i] != NULL && jit->executable_sizes[i] != 0 )
+                {
+                    fprintf(pcre_perf_map, "%lx %lx sagan_pcre_sid_%s_%d%s\n",
+                            (unsigned long)jit->executable_funcs[i], (unsigned long)jit->executable_sizes[i],
+                            rulestruct[rule_position].s_sid, pcre_position, i == 0 ? "" : "_partial");
+                }
+        }
+
+    fflush(pcre_perf_map);
+
+    pthread_mutex_unlock(&PCREPerfMapMutex);
+
+#else
+
+    if ( config->pcre_perf_map == true )
+        {
+            Sagan_Log(S_WARN, "[%s, line %d] 'pcre-perf-map' needs Sagan built with libpcre2.", __FILE__, __LINE__);
+            config->pcre_perf_map = false;
+        }
+
+#endif
+
+}
+
+/****************************************************************************
+ * PCRE_Literal_Append - Adds a byte to the current literal run.  A run
+ * longer than the buffer is cut short,  which is fine:  part of a string
+ * every match contains is also in every match.
+ ****************************************************************************/
+
+static void PCRE_Literal_Append( char *run, size_t *run_len, size_t size, unsigned char c )
+{
+
+    if ( *run_len < size - 1 )
+        {
+            run[(*run_len)++] = c;
+        }
+
+}
+
+/****************************************************************************
+ * PCRE_Literal_Keep - Ends the current run,  keeping it if it's the
+ * longest so far
+ ****************************************************************************/
+
+static void PCRE_Literal_Keep( char *run, size_t *run_len, char *best )
+{
+
+    if ( *run_len > strlen(best) )
+        {
+            memcpy(best, run, *run_len);
+            best[*run_len] = '\0';
+        }
+
+    *run_len = 0;
+
+}
+
+/****************************************************************************
+ * PCRE_Literal_Skip_Escape - Steps over an escape whose letter isn't a
+ * literal,  with its argument (\x41,  \p{L},  \g{-1},  \k<name>, etc).
+ * Stepping over too much is harmless since none of it is used as literal.
+ ****************************************************************************/
+
+static const char *PCRE_Literal_Skip_Escape( const char *p )
+{
+
+    char e = *p++;
+    char close = '\0';
+    int i;
+
+    if ( e == 'c' )
+        {
+            return( *p != '\0' ? p + 1 : p );
+        }
+
+    if ( *p == '{' )
+        {
+            close = '}';
+        }
+
+    else if ( ( e == 'g' || e == 'k' ) && ( *p == '<' || *p == '\'' ) )
+        {
+            close = *p == '<' ? '>' : '\'';
+        }
+
+    if ( close != '\0' )
+        {
+            p = strchr(p, close);
+            return( p == NULL ? NULL : p + 1 );
+        }
+
+    if ( e == 'x' )
+        {
+            for ( i = 0; i < 2 && isxdigit((unsigned char)*p); i++ )
+                {
+                    p++;
+                }
+        }
+
+    else if ( ( e == 'p' || e == 'P' ) && *p != '\0' )
+        {
+            p++;
+        }
+
+    else if ( e == 'g' || isdigit((unsigned char)e) )
+        {
+
+            if ( *p == '-' || *p == '+' )
+                {
+                    p++;
+                }
+
+            while ( isdigit((unsigned char)*p) )
+                {
+                    p++;
+                }
+        }
+
+    return(p);
+
+}
+
+/****************************************************************************
+ * PCRE_Literal_Sequence - Finds the longest literal every match of one
+ * (sub)pattern must contain,  up to the ')' that closes it.  A literal is
+ * a run of plain bytes,  none of which can be skipped or repeated apart
+ * from the others.  Anything we don't understand ends the run rather than
+ * joining it,  so the result is only ever too short,  never wrong.  If
+ * the sequence has a '|',  nothing in it is required.  Returns -1 for
+ * patterns we won't guess about (inline options,  (*VERBS),  conditions,
+ * recursion).
+ ****************************************************************************/
+
+static int PCRE_Literal_Sequence( const char **pattern, sbool nocase, char *best, size_t size, int depth )
+{
+
+    const char *p = *pattern;
+    char run[PCRE_LITERAL_SIZE];
+    size_t run_len = 0;
+    char group[PCRE_LITERAL_SIZE];
+    sbool alternation = false;
+    sbool literal;
+    sbool use_group;
+    unsigned char c;
+    int min;
+
+    best[0] = '\0';
+
+    while ( *p != '\0' && *p != ')' )
+        {
+
+            literal = false;
+            use_group = false;
+            c = (unsigned char)*p;
+
+            switch ( *p )
+                {
+
+                case '|':
+                    alternation = true;
+                    PCRE_Literal_Keep(run, &run_len, best);
+                    p++;
+                    continue;
+
+                case '\\':
+
+                    p++;
+
+                    if ( *p == '\0' )
+                        {
+                            return(-1);
+                        }
+
+                    if ( *p == 'E' )
+                        {
+                            p++;
+                            continue;
+                        }
+
+                    if ( *p == 'Q' )
+                        {
+                            p = strstr(p, "\\E");
+
+                            if ( p == NULL )
+                                {
+                                    return(-1);
+                                }
+
+                            p += 2;
+                            break;
+                        }
+
+                    if ( isalnum((unsigned char)*p) )
+                        {
+                            p = PCRE_Literal_Skip_Escape(p);
+
+                            if ( p == NULL )
+                                {
+                                    return(-1);
+                                }
+
+                            break;
+                        }
+
+                    c = (unsigned char)*p++;
+                    literal = true;
+                    break;
+
+                case '[':
+
+                    p++;
+
+                    if ( *p == '^' )
+                        {
+                            p++;
+                        }
+
+                    if ( *p == ']' )
+                        {
+                            p++;
+                        }
+
+                    while ( *p != ']' )
+                        {
+
+                            if ( *p == '\0' )
+                                {
+                                    return(-1);
+                                }
+
+                            if ( *p == '\\' && p[1] != '\0' )
+                                {
+                                    p += 2;
+                                }
+
+                            else if ( *p == '[' && p[1] == ':' && strstr(p + 2, ":]") != NULL )
+                                {
+                                    p = strstr(p + 2, ":]") + 2;
+                                }
+
+                            else
+                                {
+                                    p++;
+                                }
+                        }
+
+                    p++;
+                    break;
+
+                case '(':
+
+                    p++;
+
+                    if ( *p == '*' )
+                        {
+                            return(-1);
+                        }
+
+                    use_group = true;
+
+                    if ( *p == '?' )
+                        {
+
+                            p++;
+
+                            if ( *p == '#' )
+                                {
+                                    p = strchr(p, ')');
+
+                                    if ( p == NULL )
+                                        {
+                                            return(-1);
+                                        }
+
+                                    p++;
+                                    continue;
+                                }
+
+                            /* Lookarounds are parsed,  but what they need is
+                             * only around the match,  so we don't use it */
+
+                            if ( *p == '=' || *p == '!' )
+                                {
+                                    use_group = false;
+                                    p++;
+                                }
+
+                            else if ( *p == '<' && ( p[1] == '=' || p[1] == '!' ) )
+                                {
+                                    use_group = false;
+                                    p += 2;
+                                }
+
+                            else if ( *p == '<' || *p == '\'' || ( *p == 'P' && p[1] == '<' ) )
+                                {
+                                    p = strchr(p + 1, *p == '\'' ? '\'' : '>');
+
+                                    if ( p == NULL )
+                                        {
+                                            return(-1);
+                                        }
+
+                                    p++;
+                                }
+
+                            else if ( *p == ':' || *p == '>' || *p == '|' )
+                                {
+                                    p++;
+                                }
+
+                            else
+                                {
+                                    return(-1);
+                                }
+                        }
+
+                    if ( PCRE_Literal_Sequence(&p, nocase, group, sizeof(group), depth + 1) == -1 || *p != ')' )
+                        {
+                            return(-1);
+                        }
+
+                    p++;
+                    break;
+
+                case '.':
+                case '^':
+                case '$':
+                case '{':
+                case '*':
+                case '+':
+                case '?':
+                    p++;
+                    break;
+
+                default:
+                    p++;
+                    literal = true;
+                    break;
+                }
+
+            /* Non-ASCII bytes don't fold the way the prefilter does */
+
+            if ( literal == true && nocase == true && c >= 0x80 )
+                {
+                    literal = false;
+                }
+
+            /* What follows the atom decides if it's required */
+
+            min = 1;
+
+            if ( *p == '?' || *p == '*' )
+                {
+                    min = 0;
+                    p++;
+                }
+
+            else if ( *p == '+' )
+                {
+                    p++;
+                }
+
+            else if ( *p == '{' )
+                {
+
+                    /* Only a plain {n},  {n,} or {n,m} is trusted.  Anything
+                     * else is taken as optional and the '{' is skipped next
+                     * time around */
+
+                    if ( isdigit((unsigned char)p[1]) )
+                        {
+
+                            const char *q = p + 1;
+
+                            min = atoi(q);
+
+                            while ( isdigit((unsigned char)*q) )
+                                {
+                                    q++;
+                                }
+
+                            if ( *q == ',' )
+                                {
+                                    q++;
+
+                                    while ( isdigit((unsigned char)*q) )
+                                        {
+                                            q++;
+                                        }
+                                }
+
+                            if ( *q == '}' )
+                                {
+                                    p = q + 1;
+                                }
+                            else
+                                {
+                                    min = 0;
+                                }
+                        }
+                    else
+                        {
+                            min = 0;
+                        }
+
+                }
+
+            else
+                {
+
+                    /* Not quantified */
+
+                    if ( literal == true )
+                        {
+                            PCRE_Literal_Append(run, &run_len, sizeof(run), c);
+                            continue;
+                        }
+
+                    min = -1;
+                }
+
+            /* Lazy and possessive quantifiers */
+
+            if ( min != -1 && ( *p == '?' || *p == '+' ) )
+                {
+                    p++;
+                }
+
+            /* A repeated byte can end a run,  but the run can't go on past it */
+
+            if ( literal == true && min > 0 )
+                {
+                    PCRE_Literal_Append(run, &run_len, sizeof(run), c);
+                }
+
+            PCRE_Literal_Keep(run, &run_len, best);
+
+            if ( use_group == true && min != 0 && strlen(group) > strlen(best) )
+                {
+                    strlcpy(best, group, size);
+                }
+
+        }
+
+    PCRE_Literal_Keep(run, &run_len, best);
+
+    if ( depth == 0 && *p == ')' )
+        {
+            return(-1);
+        }
+
+    if ( alternation == true )
+        {
+            best[0] = '\0';
+        }
+
+    *pattern = p;
+
+    return(0);
+
+}
+
+/****************************************************************************
+ * PCRE_Literal - Finds a string every match of a "pcre:" pattern contains,
+ * so a rule with only pcre can still be prefiltered.  For example "Failed
+ * password for " from /Failed password for (invalid user )?\S+/.  Returns
+ * false if none (of at least PCRE_LITERAL_MIN bytes) can be proven.
+ ****************************************************************************/
+
+sbool PCRE_Literal( const char *pattern, int options, char *literal, size_t size, sbool *nocase )
+{
+
+    char best[PCRE_LITERAL_SIZE];
+    const char *p = pattern;
+
+    literal[0] = '\0';
+    *nocase = ( options & PCRE_OPT_CASELESS ) ? true : false;
+
+    /* With /x,  whitespace and comments aren't literal.  Not worth it */
+
+    if ( options & PCRE_OPT_EXTENDED )
+        {
+            return(false);
+        }
+
+    if ( PCRE_Literal_Sequence(&p, *nocase, best, sizeof(best), 0) == -1 )
+        {
+            return(false);
+        }
+
+    if ( strlen(best) < PCRE_LITERAL_MIN )
+        {
+            return(false);
+        }
+
+    strlcpy(literal, best, size);
+
+    return(true);
+
+}
+
+/****************************************************************************
+ * PCRE_Match - Runs rulestruct[rule_position].re_pcre[pcre_position] over
+ * "len" bytes of "str".  Returns what pcre2_match()/pcre_exec() does (> 0
+ * is a match).
+ ****************************************************************************/
+
+int PCRE_Match( int rule_position, int pcre_position, const char *str, size_t len )
+{
+
+#ifdef HAVE_LIBPCRE2
+
+    if ( pcre_match_data == NULL )
+        {
+            PCRE_Thread_Init();
+        }
+
+    if ( rulestruct[rule_position].pcre_jit[pcre_position] == true )
+        {
+            return( pcre2_jit_match( rulestruct[rule_position].re_pcre[pcre_position], (PCRE2_SPTR)str, len, 0, 0, pcre_match_data, pcre_match_context ) );
+        }
+
+    return( pcre2_match( rulestruct[rule_position].re_pcre[pcre_position], (PCRE2_SPTR)str, len, 0, 0, pcre_match_data, pcre_match_context ) );
+
+#else
+
+    int ovector[PCRE_OVECCOUNT];
+
+    return( pcre_exec( rulestruct[rule_position].re_pcre[pcre_position], rulestruct[rule_position].pcre_extra[pcre_position], str, (int)len, 0, 0, ovector, PCRE_OVECCOUNT ) );
+
+#endif
+
+}
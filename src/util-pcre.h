@@ -0,0 +1,57 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+/* With PCRE2 each worker thread keeps its own match data and JIT stack.
+ * The stack starts small and grows to this as patterns need it */
+
+#define PCRE_JIT_STACK_START	32768
+#define PCRE_JIT_STACK_MAX	1048576
+
+/* "pcre:" modifiers,  in whichever library we're built with */
+
+#ifdef HAVE_LIBPCRE2
+#define PCRE_OPT_CASELESS	PCRE2_CASELESS
+#define PCRE_OPT_DOTALL		PCRE2_DOTALL
+#define PCRE_OPT_MULTILINE	PCRE2_MULTILINE
+#define PCRE_OPT_EXTENDED	PCRE2_EXTENDED
+#define PCRE_OPT_ANCHORED	PCRE2_ANCHORED
+#define PCRE_OPT_DOLLAR_ENDONLY	PCRE2_DOLLAR_ENDONLY
+#define PCRE_OPT_UNGREEDY	PCRE2_UNGREEDY
+#else
+#define PCRE_OPT_CASELESS	PCRE_CASELESS
+#define PCRE_OPT_DOTALL		PCRE_DOTALL
+#define PCRE_OPT_MULTILINE	PCRE_MULTILINE
+#define PCRE_OPT_EXTENDED	PCRE_EXTENDED
+#define PCRE_OPT_ANCHORED	PCRE_ANCHORED
+#define PCRE_OPT_DOLLAR_ENDONLY	PCRE_DOLLAR_ENDONLY
+#define PCRE_OPT_UNGREEDY	PCRE_UNGREEDY
+#endif
+
+void PCRE_Version( char *, size_t );
+sbool PCRE_JIT_Supported( void );
+sbool PCRE_Compile( int, int, const char *, int, char *, size_t, int * );
+void PCRE_Perf_Map( int, int );
+sbool PCRE_Literal( const char *, int, char *, size_t, sbool * );
+int PCRE_Match( int, int, const char *, size_t );
+
@@ -32,16 +32,89 @@
 #include <sys/time.h>
 #include <time.h>
 #include <string.h>
+#include <stdbool.h>
 
 #include "sagan.h"
+#include "sagan-defs.h"
+#include "sagan-config.h"
 #include "util-time.h"
 #include "parsers/strstr-asm/strstr-hook.h"
 
+struct _SaganConfig *config;
+
+/* In replay mode the clock is driven by the logs.  Each worker runs on the
+ * time of the event it is processing,  anything else (clean up,  client
+ * tracking) on the newest event time seen so far */
+
+static __thread time_t event_time = 0;
+static time_t replay_clock = 0;
+
 struct tm *Sagan_LocalTime(time_t timep, struct tm *result)
 {
     return localtime_r(&timep, result);
 }
 
+/***************************************************************************/
+/* Sagan_Time - "Now".  Used in place of time(NULL) anywhere the answer    */
+/* decides what fires (threshold, after, xbit, track-clients, aetas).      */
+/***************************************************************************/
+
+time_t Sagan_Time( void )
+{
+
+    if ( config->replay_flag == false )
+        {
+            return(time(NULL));
+        }
+
+    if ( event_time != 0 )
+        {
+            return(event_time);
+        }
+
+    return(__atomic_load_n(&replay_clock, __ATOMIC_RELAXED));
+}
+
+/***************************************************************************/
+/* Sagan_Event_Time - Sets the clock for the event this thread is working  */
+/* on (replay mode only).                                                  */
+/***************************************************************************/
+
+void Sagan_Event_Time( time_t utime )
+{
+
+    time_t clock = __atomic_load_n(&replay_clock, __ATOMIC_RELAXED);
+
+    event_time = utime;
+
+    while ( utime > clock )
+        {
+            if ( __atomic_compare_exchange_n(&replay_clock, &clock, utime, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+                {
+                    break;
+                }
+        }
+
+}
+
+/***************************************************************************/
+/* Sagan_Event_Timeval - Alert time stamp.  In replay mode it is the time  */
+/* of the event,  so the same logs always give the same output.            */
+/***************************************************************************/
+
+void Sagan_Event_Timeval( struct timeval *tp )
+{
+
+    if ( config->replay_flag == false )
+        {
+            gettimeofday(tp, 0);
+            return;
+        }
+
+    tp->tv_sec = Sagan_Time();
+    tp->tv_usec = 0;
+}
+
 /***************************************************************************/
 /* CreateTimeString - Used in fast.log, etc.  Based off Suricata source.   */
 /***************************************************************************/
@@ -19,6 +19,9 @@
 */
 
 struct tm *Sagan_LocalTime(time_t , struct tm *);
+time_t Sagan_Time( void );
+void Sagan_Event_Time( time_t );
+void Sagan_Event_Timeval( struct timeval * );
 void CreateTimeString (const struct timeval *, char *, size_t , sbool );
 void CreateIsoTimeString (const struct timeval *, char *, size_t );
 void Return_Date( uint32_t, char *str, size_t size );
@@ -1157,10 +1157,9 @@ void Open_Log_File( sbool state, int type )
 
 #if defined(HAVE_GETPIPE_SZ) && defined(HAVE_SETPIPE_SZ)
 
-void Set_Pipe_Size ( FILE *fd )
+void Set_Pipe_Size ( int fd_int )
 {
 
-    int fd_int;
     int current_fifo_size;
     int fd_results;
 
@@ -1168,7 +1167,6 @@ void Set_Pipe_Size ( FILE *fd )
     if ( config->sagan_fifo_size != 0 )
         {
 
-            fd_int = fileno(fd);
             current_fifo_size = fcntl(fd_int, F_GETPIPE_SZ);
 
             if ( current_fifo_size == config->sagan_fifo_size )
@@ -1483,7 +1481,6 @@ sbool Check_Content_Not( char *s )
  * Djd2_Hash - creates a hash based off a string.  This code is from Dan
  * Bernstein.  See http://www.cse.yorku.ca/~oz/hash.html.
  ***************************************************************************/
-/*
 uint32_t Djb2_Hash(char *str)
 {
 
@@ -1495,7 +1492,6 @@ uint32_t Djb2_Hash(char *str)
 
     return(hash);
 }
-*/
 
 char *strrpbrk(const char *str, const char *accept)
 {
@@ -0,0 +1,451 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* work-queue.c
+ *
+ * Bounded multi-producer/multi-consumer ring buffer that sits between the
+ * log readers and the Processor() threads.  Producers and consumers claim
+ * slots with a compare-and-swap on their position and hand the slot over
+ * with a per-slot sequence number,  so no lock is taken while there is
+ * work to do.  The mutex/conditions are only used to park idle workers and
+ * any reader that has out run the workers and asked to wait for room.
+ *
+ * Events are never copied once they are in the queue.  A reader parses a
+ * line straight into the event owned by its slot,  and a worker takes the
+ * event by swapping it for one it has already finished with.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "sagan.h"
+#include "sagan-defs.h"
+#include "work-queue.h"
+
+static sbool Work_Queue_Empty( _Sagan_Work_Queue * );
+static sbool Work_Queue_Full( _Sagan_Work_Queue * );
+
+/****************************************************************************
+ * Work_Queue_Init - Allocates the ring and the event pool.  Depth is rounded
+ * up to a power of two so a position can be turned into a slot with a mask.
+ * 'spares' are the extra events handed out by Work_Queue_Spares().
+ ****************************************************************************/
+
+_Sagan_Work_Queue *Work_Queue_Init( uint64_t depth, uint64_t spares )
+{
+
+    _Sagan_Work_Queue *queue = NULL;
+    uint64_t size = 2;
+    uint64_t i;
+
+    while ( size < depth )
+        {
+            size <<= 1;
+        }
+
+    if ( posix_memalign((void **)&queue, WORK_QUEUE_CACHE_LINE, sizeof(_Sagan_Work_Queue)) != 0 )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for work queue. Abort!", __FILE__, __LINE__);
+        }
+
+    memset(queue, 0, sizeof(_Sagan_Work_Queue));
+
+    queue->cells = malloc(size * sizeof(_Sagan_Work_Queue_Cell));
+
+    if ( queue->cells == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for work queue cells. Abort!", __FILE__, __LINE__);
+        }
+
+    queue->pool_size = size + spares;
+    queue->pool = malloc(queue->pool_size * sizeof(struct _Sagan_Proc_Syslog));
+
+    if ( queue->pool == NULL )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Failed to allocate memory for work queue event pool. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( i = 0; i < queue->pool_size; i++ )
+        {
+            queue->pool[i].syslog_message[0] = '\0';
+        }
+
+    for ( i = 0; i < size; i++ )
+        {
+            queue->cells[i].sequence = i;
+            queue->cells[i].syslog = &queue->pool[i];
+        }
+
+    queue->pool_used = size;
+
+    queue->depth = size;
+    queue->mask = size - 1;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return(queue);
+}
+
+/****************************************************************************
+ * Work_Queue_Spares - Gives a worker 'count' events of its own from the
+ * pool.  These are what it trades for full ones in Work_Queue_Dequeue().
+ ****************************************************************************/
+
+void Work_Queue_Spares( _Sagan_Work_Queue *queue, struct _Sagan_Proc_Syslog **batch, int count )
+{
+
+    uint64_t first = __atomic_fetch_add(&queue->pool_used, count, __ATOMIC_RELAXED);
+    int i;
+
+    if ( first + count > queue->pool_size )
+        {
+            Sagan_Log(S_ERROR, "[%s, line %d] Work queue event pool exhausted. Abort!", __FILE__, __LINE__);
+        }
+
+    for ( i = 0; i < count; i++ )
+        {
+            batch[i] = &queue->pool[first + i];
+        }
+
+}
+
+/****************************************************************************
+ * Work_Queue_Reserve - Claims up to 'want' consecutive free slots for a
+ * producer with a single compare-and-swap.  The caller fills the slots in
+ * place (see Work_Queue_Slot()) and then hands them to the workers with
+ * Work_Queue_Commit().  If the queue is full we either wait for a worker
+ * to free a slot ('block' is set) or return 0 so the caller can count the
+ * drop.  Returns the number of slots reserved,  starting at 'ticket'.
+ ****************************************************************************/
+
+int Work_Queue_Reserve( _Sagan_Work_Queue *queue, int want, sbool block, uint64_t *ticket )
+{
+
+    _Sagan_Work_Queue_Cell *cell;
+    uint64_t pos;
+    uint64_t seq = 0;
+    int count;
+
+    /* Nothing to reserve */
+
+    if ( want < 1 )
+        {
+            return(0);
+        }
+
+    pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+
+    for (;;)
+        {
+
+            for ( count = 0; count < want; count++ )
+                {
+
+                    cell = &queue->cells[(pos + count) & queue->mask];
+                    seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+
+                    if ( seq != pos + count )
+                        {
+                            break;
+                        }
+                }
+
+            if ( count > 0 )
+                {
+
+                    if ( __atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + count, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+                        {
+                            *ticket = pos;
+                            return(count);
+                        }
+
+                    continue;
+                }
+
+            if ( (int64_t)(seq - pos) < 0 )
+                {
+
+                    /* Queue is full */
+
+                    __atomic_add_fetch(&queue->full_count, 1, __ATOMIC_RELAXED);
+
+                    if ( block == false )
+                        {
+                            return(0);
+                        }
+
+                    pthread_mutex_lock(&queue->mutex);
+                    __atomic_add_fetch(&queue->blocked_producers, 1, __ATOMIC_SEQ_CST);
+
+                    while ( Work_Queue_Full(queue) )
+                        {
+                            pthread_cond_wait(&queue->not_full, &queue->mutex);
+                        }
+
+                    __atomic_sub_fetch(&queue->blocked_producers, 1, __ATOMIC_SEQ_CST);
+                    pthread_mutex_unlock(&queue->mutex);
+
+                }
+
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+
+}
+
+/****************************************************************************
+ * Work_Queue_Slot - Returns the event storage for a reserved ticket
+ ****************************************************************************/
+
+struct _Sagan_Proc_Syslog *Work_Queue_Slot( _Sagan_Work_Queue *queue, uint64_t ticket )
+{
+    return(queue->cells[ticket & queue->mask].syslog);
+}
+
+/****************************************************************************
+ * Work_Queue_Exchange - Puts 'syslog' into a reserved slot and returns the
+ * event that was there,  for callers that fill an event before they know
+ * which queue it goes to.  Nothing is copied.
+ ****************************************************************************/
+
+struct _Sagan_Proc_Syslog *Work_Queue_Exchange( _Sagan_Work_Queue *queue, uint64_t ticket, struct _Sagan_Proc_Syslog *syslog )
+{
+
+    _Sagan_Work_Queue_Cell *cell = &queue->cells[ticket & queue->mask];
+    struct _Sagan_Proc_Syslog *old = cell->syslog;
+
+    cell->syslog = syslog;
+
+    return(old);
+}
+
+/****************************************************************************
+ * Work_Queue_Commit - Publishes 'count' slots returned by
+ * Work_Queue_Reserve() and wakes a worker if one is sleeping.
+ ****************************************************************************/
+
+void Work_Queue_Commit( _Sagan_Work_Queue *queue, uint64_t ticket, int count )
+{
+
+    uint64_t depth;
+    uint64_t high_water;
+    int i;
+
+    for ( i = 0; i < count; i++ )
+        {
+            __atomic_store_n(&queue->cells[(ticket + i) & queue->mask].sequence, ticket + i + 1, __ATOMIC_SEQ_CST);
+        }
+
+    depth = ticket + count - __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    high_water = __atomic_load_n(&queue->high_water, __ATOMIC_RELAXED);
+
+    while ( depth > high_water && depth <= queue->depth )
+        {
+            if ( __atomic_compare_exchange_n(&queue->high_water, &high_water, depth, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+                {
+                    break;
+                }
+        }
+
+    if ( __atomic_load_n(&queue->idle_consumers, __ATOMIC_SEQ_CST) > 0 )
+        {
+            pthread_mutex_lock(&queue->mutex);
+            pthread_cond_signal(&queue->not_empty);
+            pthread_mutex_unlock(&queue->mutex);
+        }
+
+}
+
+/****************************************************************************
+ * Work_Queue_Dequeue - Hands up to 'max' events to a worker.  On the way in
+ * 'batch' holds events the worker is done with,  on the way out it holds
+ * the events to process.  The two are swapped slot by slot,  so nothing is
+ * copied and the worker owns its events until the next call.  A run of
+ * ready slots is claimed with a single compare-and-swap.  If nothing is
+ * ready, the worker sleeps until a producer commits something.  Returns
+ * the number of events (always at least one,  unless 'max' is less than
+ * one).
+ ****************************************************************************/
+
+int Work_Queue_Dequeue( _Sagan_Work_Queue *queue, struct _Sagan_Proc_Syslog **batch, int max )
+{
+
+    struct _Sagan_Proc_Syslog *event;
+
+    _Sagan_Work_Queue_Cell *cell;
+    uint64_t pos;
+    uint64_t seq = 0;
+    int count;
+    int i;
+
+    /* Nothing to hand out into */
+
+    if ( max < 1 )
+        {
+            return(0);
+        }
+
+    for (;;)
+        {
+
+            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+
+            for (;;)
+                {
+
+                    for ( count = 0; count < max; count++ )
+                        {
+
+                            cell = &queue->cells[(pos + count) & queue->mask];
+                            seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+
+                            if ( seq != pos + count + 1 )
+                                {
+                                    break;
+                                }
+                        }
+
+                    if ( count == 0 )
+                        {
+
+                            /* Either the queue is empty or another worker beat us
+                             * to the slot.  Only the latter is worth a retry. */
+
+                            if ( (int64_t)(seq - (pos + 1)) < 0 )
+                                {
+                                    break;
+                                }
+
+                            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+                            continue;
+                        }
+
+                    if ( __atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + count, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+                        {
+                            break;
+                        }
+
+                }
+
+            if ( count > 0 )
+                {
+
+                    for ( i = 0; i < count; i++ )
+                        {
+
+                            cell = &queue->cells[(pos + i) & queue->mask];
+
+                            event = cell->syslog;
+                            cell->syslog = batch[i];
+                            batch[i] = event;
+
+                            __atomic_store_n(&cell->sequence, pos + i + queue->mask + 1, __ATOMIC_SEQ_CST);
+                        }
+
+                    if ( __atomic_load_n(&queue->blocked_producers, __ATOMIC_SEQ_CST) > 0 )
+                        {
+                            pthread_mutex_lock(&queue->mutex);
+                            pthread_cond_broadcast(&queue->not_full);
+                            pthread_mutex_unlock(&queue->mutex);
+                        }
+
+                    return(count);
+                }
+
+            /* Nothing to do.  Park until a producer commits */
+
+            pthread_mutex_lock(&queue->mutex);
+            __atomic_add_fetch(&queue->idle_consumers, 1, __ATOMIC_SEQ_CST);
+
+            while ( Work_Queue_Empty(queue) )
+                {
+                    pthread_cond_wait(&queue->not_empty, &queue->mutex);
+                }
+
+            __atomic_sub_fetch(&queue->idle_consumers, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&queue->mutex);
+
+        }
+
+}
+
+/****************************************************************************
+ * Work_Queue_Done - Workers call this once a batch has been through the
+ * engine.  Used so "EOF" (-F) processing knows when the work is complete.
+ ****************************************************************************/
+
+void Work_Queue_Done( _Sagan_Work_Queue *queue, int count )
+{
+    __atomic_add_fetch(&queue->completed, count, __ATOMIC_RELEASE);
+}
+
+/****************************************************************************
+ * Work_Queue_Depth - Events waiting for a worker
+ ****************************************************************************/
+
+uint64_t Work_Queue_Depth( _Sagan_Work_Queue *queue )
+{
+
+    uint64_t enqueue_pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE);
+    uint64_t dequeue_pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE);
+
+    return( enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0 );
+}
+
+/****************************************************************************
+ * Work_Queue_Pending - Events queued or still being processed
+ ****************************************************************************/
+
+uint64_t Work_Queue_Pending( _Sagan_Work_Queue *queue )
+{
+
+    uint64_t enqueue_pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE);
+    uint64_t completed = __atomic_load_n(&queue->completed, __ATOMIC_ACQUIRE);
+
+    return( enqueue_pos > completed ? enqueue_pos - completed : 0 );
+}
+
+static sbool Work_Queue_Empty( _Sagan_Work_Queue *queue )
+{
+
+    uint64_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_SEQ_CST);
+    uint64_t seq = __atomic_load_n(&queue->cells[pos & queue->mask].sequence, __ATOMIC_SEQ_CST);
+
+    return( (int64_t)(seq - (pos + 1)) < 0 );
+}
+
+static sbool Work_Queue_Full( _Sagan_Work_Queue *queue )
+{
+
+    uint64_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_SEQ_CST);
+    uint64_t seq = __atomic_load_n(&queue->cells[pos & queue->mask].sequence, __ATOMIC_SEQ_CST);
+
+    return( (int64_t)(seq - pos) < 0 );
+}
@@ -0,0 +1,84 @@
+/*
+** Copyright (C) 2009-2017 Quadrant Information Security <quadrantsec.com>
+** Copyright (C) 2009-2017 Champ Clark III <cclark@quadrantsec.com>
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License Version 2 as
+** published by the Free Software Foundation.  You may not use, modify or
+** distribute this program under any other version of the GNU General
+** Public License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"             /* From autoconf */
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define WORK_QUEUE_CACHE_LINE	64
+
+/* A slot in the ring.  'sequence' tells producers and consumers who owns
+ * the slot for a given lap around the ring.  The event itself lives in the
+ * pool and is passed around by pointer. */
+
+typedef struct _Sagan_Work_Queue_Cell _Sagan_Work_Queue_Cell;
+struct _Sagan_Work_Queue_Cell
+{
+    uint64_t sequence;
+    struct _Sagan_Proc_Syslog *syslog;
+};
+
+typedef struct _Sagan_Work_Queue _Sagan_Work_Queue;
+struct _Sagan_Work_Queue
+{
+
+    _Sagan_Work_Queue_Cell *cells;
+    uint64_t mask;
+    uint64_t depth;
+
+    /* Every event buffer is allocated once,  up front.  One per cell,  plus
+     * the spares each worker holds while it runs the engine */
+
+    struct _Sagan_Proc_Syslog *pool;
+    uint64_t pool_size;
+    uint64_t pool_used;
+
+    /* Producer and consumer positions live on their own cache lines */
+
+    uint64_t enqueue_pos __attribute__ ((aligned (WORK_QUEUE_CACHE_LINE)));
+    uint64_t dequeue_pos __attribute__ ((aligned (WORK_QUEUE_CACHE_LINE)));
+
+    uint64_t completed __attribute__ ((aligned (WORK_QUEUE_CACHE_LINE)));
+    uint64_t high_water;			/* Deepest the queue has been */
+    uint64_t full_count;			/* Times a producer found the queue full */
+
+    /* Only used to park idle threads.  The fast path never touches these */
+
+    int idle_consumers;
+    int blocked_producers;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+
+};
+
+_Sagan_Work_Queue *Work_Queue_Init( uint64_t, uint64_t );
+void Work_Queue_Spares( _Sagan_Work_Queue *, struct _Sagan_Proc_Syslog **, int );
+int Work_Queue_Reserve( _Sagan_Work_Queue *, int, sbool, uint64_t * );
+struct _Sagan_Proc_Syslog *Work_Queue_Slot( _Sagan_Work_Queue *, uint64_t );
+struct _Sagan_Proc_Syslog *Work_Queue_Exchange( _Sagan_Work_Queue *, uint64_t, struct _Sagan_Proc_Syslog * );
+void Work_Queue_Commit( _Sagan_Work_Queue *, uint64_t, int );
+int Work_Queue_Dequeue( _Sagan_Work_Queue *, struct _Sagan_Proc_Syslog **, int );
+void Work_Queue_Done( _Sagan_Work_Queue *, int );
+uint64_t Work_Queue_Depth( _Sagan_Work_Queue * );
+uint64_t Work_Queue_Pending( _Sagan_Work_Queue * );
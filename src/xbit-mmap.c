@@ -38,6 +38,7 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "ipc.h"
 #include "xbit-mmap.h"
 #include "rules.h"
@@ -78,7 +79,7 @@ sbool Xbit_Condition_MMAP(int rule_position, char *ip_src_char, char *ip_dst_cha
     sbool xbit_match = false;
     int xbit_total_match = 0;
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(timet, sizeof(timet), "%s",  now);
 
@@ -1036,7 +1037,7 @@ void Xbit_Set_MMAP(int rule_position, char *ip_src_char, char *ip_dst_char, int
     sbool has_ip_src = IP2Bit(ip_src_char, ip_src);
     sbool has_ip_dst = IP2Bit(ip_dst_char, ip_dst);
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(timet, sizeof(timet), "%s",  now);
 
@@ -1874,7 +1875,7 @@ void Xbit_Cleanup_MMAP(void)
     struct tm *now;
     char  timet[20];
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(timet, sizeof(timet), "%s",  now);
 
@@ -31,6 +31,7 @@
 
 #include "sagan.h"
 #include "sagan-defs.h"
+#include "util-time.h"
 #include "sagan-config.h"
 
 #include "rules.h"
@@ -99,7 +100,7 @@ sbool Xbit_Condition_Redis(int rule_position, char *ip_src_char, char *ip_dst_ch
 
     uint32_t djb2_hash;
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(timet, sizeof(timet), "%s",  now);
 
@@ -425,7 +426,7 @@ void Xbit_Set_Redis(int rule_position, char *ip_src_char, char *ip_dst_char, int
     char fullsyslog_orig[400 + MAX_SYSLOGMSG] = { 0 };
     char altered_syslog[ (400*2) + (MAX_SYSLOGMSG*2)] = { 0 };
 
-    t = time(NULL);
+    t = Sagan_Time();
     now=localtime(&t);
     strftime(timet, sizeof(timet), "%s",  now);
 